@@ -0,0 +1,64 @@
+/*
+ * 分配计数（通过 LD_PRELOAD 加载，仅 glibc）
+ * 统计进程内 malloc/calloc/realloc 的调用次数，包括 libcurl、ncurses 和 libc 内部的分配，
+ * 进程退出时连同峰值 RSS 写入环境变量 VMANAGER_ALLOC_OUT 指定的文件；供 bench/scale.py 使用
+ *
+ * 峰值 RSS 取 /proc/self/status 的 VmHWM：wait4() 返回的 ru_maxrss 包含 exec 之前
+ * 父进程（python）的内存，小规模时会被掩盖
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long alloc_count;
+
+void *malloc(size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+static long peak_rss_kb(void) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (!fp) return -1;
+    
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "VmHWM:", 6) == 0) {
+            kb = strtol(line + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+__attribute__((destructor))
+static void report(void) {
+    const char *path = getenv("VMANAGER_ALLOC_OUT");
+    if (!path) return;
+    
+    // 先取值，写文件本身的分配不计入
+    unsigned long count = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    long rss = peak_rss_kb();
+    FILE *fp = fopen(path, "w");
+    if (!fp) return;
+    fprintf(fp, "allocs %lu\nhwm_kb %ld\n", count, rss);
+    fclose(fp);
+}
@@ -0,0 +1,561 @@
+/*
+ * CPU 热路径微基准
+ * 不访问网络：VM 列表来自 bench/fixtures 中录制的 /nodes/{node}/qemu 响应，
+ * 复制扩展到 10 ~ 10000 个 VM。每项先预热并校准迭代次数，再重复运行若干轮，
+ * 报告中位数 ns/op 和 allocs/op（glibc 下统计 malloc/calloc/realloc 调用次数）
+ *
+ * 用法: bench/bench [-r 轮数] [-t 每轮毫秒] [-F fixture] [-o 结果文件] [-c 基线文件] [-x 容差%] [名称过滤]
+ *   -o  把结果写入文件，作为之后比较的基线
+ *   -c  与基线比较，ns/op 超出容差（默认 20%）或 allocs/op 增加时返回失败
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../include/vmanager.h"
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+// 库代码引用的全局变量（正常情况下定义在 main.c）
+Config g_config = {0};
+Config g_clusters[MAX_CLUSTERS];
+int g_cluster_count = 0;
+ExecutionMode g_exec_mode = MODE_AUTO;
+UIMode g_ui_mode = UI_CLI;
+bool g_verbose = false;
+bool g_debug = false;
+bool g_tui_mode = false;
+bool g_hedge = false;
+int g_parallel = DEFAULT_PARALLEL;
+int g_cache_ttl = 0;
+
+#define MAX_RUNS 31
+#define MAX_RESULTS 64
+
+static const int payload_sizes[] = { 10, 100, 1000, 10000 };
+#define PAYLOAD_COUNT ((int)(sizeof(payload_sizes) / sizeof(payload_sizes[0])))
+
+// 分配计数：在可执行文件中覆盖 malloc，libc 内部（strdup、stdio 等）的分配也会被计入
+static unsigned long alloc_count;
+
+#ifdef __GLIBC__
+#define HAVE_ALLOC_COUNT 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+    alloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    alloc_count++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+#else
+#define HAVE_ALLOC_COUNT 0
+#endif
+
+typedef void (*BenchFn)(void *arg, long iters);
+
+typedef struct {
+    char name[64];
+    long iters;
+    double ns_per_op;
+    double allocs_per_op;
+} BenchResult;
+
+// 一个规模的测试数据
+typedef struct {
+    int count;
+    char *text;         // 未格式化的 JSON 响应
+    cJSON *root;
+    VMInfo *vms;
+    char *vmlist;       // 同样这些 VM 的 pmxcfs .vmlist 和 .rrd 内容
+    char *rrd;
+} Payload;
+
+static int opt_runs = 5;
+static int opt_target_ms = 100;
+static const char *opt_filter = NULL;
+
+static BenchResult results[MAX_RESULTS];
+static int result_count = 0;
+
+// 防止编译器把被测调用当作无用代码消除
+static volatile long sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t time_iters(BenchFn fn, void *arg, long iters) {
+    uint64_t start = now_ns();
+    fn(arg, iters);
+    return now_ns() - start;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_bench(const char *name, BenchFn fn, void *arg) {
+    if (opt_filter && !strstr(name, opt_filter)) return;
+    if (result_count >= MAX_RESULTS) return;
+    
+    // 先不计时运行一次（冷缓存、首次缺页），再校准：迭代次数翻倍直到单轮达到
+    // 目标时长的 1/10，然后按比例放大
+    fn(arg, 1);
+    uint64_t target = (uint64_t)opt_target_ms * 1000000ULL;
+    long iters = 1;
+    uint64_t elapsed = time_iters(fn, arg, iters);
+    while (elapsed < target / 10 && iters < (1L << 40)) {
+        iters *= 2;
+        elapsed = time_iters(fn, arg, iters);
+    }
+    if (elapsed > 0) {
+        double scaled = (double)iters * (double)target / (double)elapsed;
+        iters = scaled < 1 ? 1 : (long)scaled;
+    }
+    
+    double ns[MAX_RUNS];
+    double allocs = 0;
+    for (int r = 0; r < opt_runs; r++) {
+        unsigned long before = alloc_count;
+        ns[r] = (double)time_iters(fn, arg, iters) / (double)iters;
+        allocs = (double)(alloc_count - before) / (double)iters;
+    }
+    qsort(ns, (size_t)opt_runs, sizeof(double), cmp_double);
+    
+    BenchResult *res = &results[result_count++];
+    snprintf(res->name, sizeof(res->name), "%s", name);
+    res->iters = iters;
+    res->ns_per_op = ns[opt_runs / 2];
+    res->allocs_per_op = allocs;
+}
+
+// ---- 被测函数 ----
+
+static void bench_is_number(void *arg, long iters) {
+    (void)arg;
+    static const char *inputs[] = { "100", "90001", "100-110", "web-01" };
+    long hits = 0;
+    for (long i = 0; i < iters; i++) {
+        hits += is_number(inputs[i & 3]);
+    }
+    sink = hits;
+}
+
+static void bench_parse_vmid_range(void *arg, long iters) {
+    (void)arg;
+    static const char *inputs[] = { "100", "100-110", "100,101,102,103", "100-105,110,200-220" };
+    static int vmids[MAX_VMIDS];
+    long total = 0;
+    for (long i = 0; i < iters; i++) {
+        int count = 0;
+        parse_vmid_range(inputs[i & 3], vmids, &count);
+        total += count;
+    }
+    sink = total;
+}
+
+static void bench_format_bytes(void *arg, long iters) {
+    (void)arg;
+    static const uint64_t inputs[] = { 512, 123456789, 5368709120ULL, 1099511627776ULL };
+    char buf[FORMAT_LEN];
+    long total = 0;
+    for (long i = 0; i < iters; i++) {
+        total += format_bytes(inputs[i & 3], buf, sizeof(buf))[0];
+    }
+    sink = total;
+}
+
+// json_get_* 查找的代价取决于键在对象中的位置，分别取开头和末尾的字段
+static void bench_json_get_int(void *arg, long iters) {
+    cJSON *vm = arg;
+    long total = 0;
+    for (long i = 0; i < iters; i++) {
+        total += json_get_int(vm, "vmid", 0);
+    }
+    sink = total;
+}
+
+static void bench_json_get_double(void *arg, long iters) {
+    cJSON *vm = arg;
+    double total = 0;
+    for (long i = 0; i < iters; i++) {
+        total += json_get_double(vm, "diskwrite", 0);
+    }
+    sink = (long)total;
+}
+
+static void bench_json_get_string(void *arg, long iters) {
+    cJSON *vm = arg;
+    long total = 0;
+    for (long i = 0; i < iters; i++) {
+        total += json_get_string(vm, "tags", "")[0];
+    }
+    sink = total;
+}
+
+static void bench_json_parse(void *arg, long iters) {
+    Payload *p = arg;
+    for (long i = 0; i < iters; i++) {
+        cJSON *root = cJSON_Parse(p->text);
+        sink = cJSON_GetArraySize(cJSON_GetObjectItem(root, "data"));
+        cJSON_Delete(root);
+    }
+}
+
+static void bench_vm_list_map(void *arg, long iters) {
+    Payload *p = arg;
+    cJSON *data = cJSON_GetObjectItem(p->root, "data");
+    for (long i = 0; i < iters; i++) {
+        VMInfo *vms = NULL;
+        int count = 0;
+        api_parse_vm_list(data, "pve", &vms, &count);
+        sink = count;
+        free(vms);
+    }
+}
+
+static void bench_local_parse(void *arg, long iters) {
+    Payload *p = arg;
+    for (long i = 0; i < iters; i++) {
+        VMInfo *vms = NULL;
+        int count = 0;
+        local_parse_cluster(p->vmlist, p->rrd, &vms, &count, NULL);
+        sink = count;
+        free(vms);
+    }
+}
+
+static int null_fd = -1;
+
+// 与 vm_list 相同的列和格式
+static void bench_table_render(void *arg, long iters) {
+    Payload *p = arg;
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+    };
+    char mem[FORMAT_LEN];
+    for (long i = 0; i < iters; i++) {
+        Table table;
+        table_init(&table, columns, 5);
+        for (int k = 0; k < p->count; k++) {
+            VMInfo *vm = &p->vms[k];
+            table_cell(&table, "%d", vm->vmid);
+            table_cell(&table, "%s", vm->name);
+            table_cell(&table, "%s", vm->status);
+            table_cell(&table, "%.1f%%", vm->cpu_percent);
+            table_cell(&table, "%s", format_bytes(vm->mem, mem, sizeof(mem)));
+        }
+        sink = table_write(&table, null_fd);
+        table_free(&table);
+    }
+}
+
+// ---- 测试数据 ----
+
+static char* read_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return NULL;
+    
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    char *buf = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (buf && fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    if (buf) buf[size] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+// 循环复制录制的条目，VMID 和名称保持唯一
+static int build_payload(Payload *p, cJSON *recorded, int count) {
+    int n = cJSON_GetArraySize(recorded);
+    cJSON *root = cJSON_CreateObject();
+    cJSON *data = cJSON_AddArrayToObject(root, "data");
+    
+    for (int i = 0; i < count; i++) {
+        cJSON *vm = cJSON_Duplicate(cJSON_GetArrayItem(recorded, i % n), true);
+        cJSON_SetNumberValue(cJSON_GetObjectItem(vm, "vmid"), 100 + i);
+        
+        char name[128];
+        snprintf(name, sizeof(name), "%.100s-%d", json_get_string(vm, "name", "vm"), i / n);
+        cJSON_ReplaceItemInObject(vm, "name", cJSON_CreateString(name));
+        cJSON_AddItemToArray(data, vm);
+    }
+    
+    p->count = count;
+    p->text = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!p->text) return -1;
+    
+    p->root = cJSON_Parse(p->text);
+    int parsed = 0;
+    if (!p->root ||
+        api_parse_vm_list(cJSON_GetObjectItem(p->root, "data"), "pve", &p->vms, &parsed) != 0) {
+        return -1;
+    }
+    
+    // 按 pmxcfs 的格式生成 .vmlist 和 .rrd
+    size_t cap = (size_t)count * 256 + 64;
+    p->vmlist = malloc(cap);
+    p->rrd = malloc(cap);
+    if (!p->vmlist || !p->rrd) return -1;
+    size_t vlen = (size_t)snprintf(p->vmlist, cap, "{\n\"version\": 1,\n\"ids\": {");
+    size_t rlen = 0;
+    for (int i = 0; i < count; i++) {
+        const VMInfo *vm = &p->vms[i];
+        vlen += (size_t)snprintf(p->vmlist + vlen, cap - vlen,
+                                 "%s\n\"%d\": { \"node\": \"pve\", \"type\": \"qemu\", \"version\": 1 }",
+                                 i ? "," : "", vm->vmid);
+        rlen += (size_t)snprintf(p->rrd + rlen, cap - rlen,
+                                 "pve2.3-vm/%d:%d:%s:%s:0:1760880000:%d:%.4f:%llu:%llu:%llu:0:%llu:%llu:%llu:%llu\n",
+                                 vm->vmid, vm->uptime, vm->name, vm->status, vm->cpus, vm->cpu_percent / 100,
+                                 (unsigned long long)vm->maxmem, (unsigned long long)vm->mem,
+                                 (unsigned long long)vm->maxdisk, (unsigned long long)vm->netin,
+                                 (unsigned long long)vm->netout, (unsigned long long)vm->diskread,
+                                 (unsigned long long)vm->diskwrite);
+    }
+    snprintf(p->vmlist + vlen, cap - vlen, "}\n\n}\n");
+    return 0;
+}
+
+static void free_payload(Payload *p) {
+    free(p->text);
+    cJSON_Delete(p->root);
+    free(p->vms);
+    free(p->vmlist);
+    free(p->rrd);
+}
+
+// ---- 输出与基线比较 ----
+
+static int write_results(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "错误：无法写入 %s\n", path);
+        return -1;
+    }
+    
+    fprintf(fp, "# name\tns/op\tallocs/op\n");
+    for (int i = 0; i < result_count; i++) {
+        fprintf(fp, "%s\t%.2f\t%.2f\n", results[i].name, results[i].ns_per_op,
+                results[i].allocs_per_op);
+    }
+    fclose(fp);
+    return 0;
+}
+
+typedef struct {
+    char name[64];
+    double ns_per_op;
+    double allocs_per_op;
+} Baseline;
+
+static int load_baseline(const char *path, Baseline *base, int max) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "错误：无法读取基线 %s\n", path);
+        return -1;
+    }
+    
+    char line[256];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%63[^\t]\t%lf\t%lf", base[n].name, &base[n].ns_per_op,
+                   &base[n].allocs_per_op) == 3) {
+            n++;
+        }
+    }
+    fclose(fp);
+    return n;
+}
+
+static const Baseline* find_baseline(const Baseline *base, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(base[i].name, name) == 0) return &base[i];
+    }
+    return NULL;
+}
+
+static void print_results(const Baseline *base, int base_count, double tolerance, int *regressions) {
+    static const TableColumn columns[] = {
+        { "BENCHMARK", false },
+        { "ITERS", true },
+        { "NS/OP", true },
+        { "ALLOCS/OP", true },
+        { "BASELINE", true },
+        { "DELTA", true },
+    };
+    Table table;
+    table_init(&table, columns, base ? 6 : 4);
+    
+    *regressions = 0;
+    for (int i = 0; i < result_count; i++) {
+        const BenchResult *res = &results[i];
+        table_cell(&table, "%s", res->name);
+        table_cell(&table, "%ld", res->iters);
+        table_cell(&table, "%.1f", res->ns_per_op);
+        if (HAVE_ALLOC_COUNT) {
+            table_cell(&table, "%.2f", res->allocs_per_op);
+        } else {
+            table_cell(&table, "-");
+        }
+        if (!base) continue;
+        
+        const Baseline *b = find_baseline(base, base_count, res->name);
+        if (!b || b->ns_per_op <= 0) {
+            table_cell(&table, "-");
+            table_cell(&table, "新增");
+            continue;
+        }
+        
+        double delta = (res->ns_per_op - b->ns_per_op) * 100.0 / b->ns_per_op;
+        bool slower = delta > tolerance;
+        bool more_allocs = HAVE_ALLOC_COUNT && res->allocs_per_op > b->allocs_per_op + 0.01;
+        if (slower || more_allocs) (*regressions)++;
+        
+        table_cell(&table, "%.1f", b->ns_per_op);
+        table_cell(&table, "%+.1f%%%s", delta, more_allocs ? " (allocs)" : slower ? " !" : "");
+    }
+    
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "用法: %s [-r 轮数] [-t 每轮毫秒] [-F fixture] [-o 结果文件] "
+            "[-c 基线文件] [-x 容差%%] [名称过滤]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *fixture = "bench/fixtures/qemu-list.json";
+    const char *output = NULL;
+    const char *compare = NULL;
+    double tolerance = 20.0;
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "r:t:F:o:c:x:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                opt_runs = atoi(optarg);
+                if (opt_runs < 1) opt_runs = 1;
+                if (opt_runs > MAX_RUNS) opt_runs = MAX_RUNS;
+                break;
+            case 't':
+                opt_target_ms = atoi(optarg);
+                if (opt_target_ms < 1) opt_target_ms = 1;
+                break;
+            case 'F':
+                fixture = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'c':
+                compare = optarg;
+                break;
+            case 'x':
+                tolerance = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc) opt_filter = argv[optind];
+    
+    char *text = read_file(fixture);
+    cJSON *recorded_root = text ? cJSON_Parse(text) : NULL;
+    free(text);
+    cJSON *recorded = cJSON_GetObjectItem(recorded_root, "data");
+    if (!cJSON_IsArray(recorded) || cJSON_GetArraySize(recorded) == 0) {
+        fprintf(stderr, "错误：无法加载测试数据 %s\n", fixture);
+        cJSON_Delete(recorded_root);
+        return 1;
+    }
+    
+    Payload payloads[PAYLOAD_COUNT];
+    memset(payloads, 0, sizeof(payloads));
+    for (int i = 0; i < PAYLOAD_COUNT; i++) {
+        if (build_payload(&payloads[i], recorded, payload_sizes[i]) != 0) {
+            fprintf(stderr, "错误：无法生成 %d 个 VM 的测试数据\n", payload_sizes[i]);
+            return 1;
+        }
+    }
+    
+    null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        perror("/dev/null");
+        return 1;
+    }
+    
+    cJSON *first_vm = cJSON_GetArrayItem(recorded, 0);
+    run_bench("is_number", bench_is_number, NULL);
+    run_bench("parse_vmid_range", bench_parse_vmid_range, NULL);
+    run_bench("format_bytes", bench_format_bytes, NULL);
+    run_bench("json_get_int", bench_json_get_int, first_vm);
+    run_bench("json_get_double", bench_json_get_double, first_vm);
+    run_bench("json_get_string", bench_json_get_string, first_vm);
+    
+    char name[64];
+    for (int i = 0; i < PAYLOAD_COUNT; i++) {
+        snprintf(name, sizeof(name), "cJSON_Parse/%d", payloads[i].count);
+        run_bench(name, bench_json_parse, &payloads[i]);
+    }
+    for (int i = 0; i < PAYLOAD_COUNT; i++) {
+        snprintf(name, sizeof(name), "vm_list_map/%d", payloads[i].count);
+        run_bench(name, bench_vm_list_map, &payloads[i]);
+    }
+    for (int i = 0; i < PAYLOAD_COUNT; i++) {
+        snprintf(name, sizeof(name), "local_parse/%d", payloads[i].count);
+        run_bench(name, bench_local_parse, &payloads[i]);
+    }
+    for (int i = 0; i < PAYLOAD_COUNT; i++) {
+        snprintf(name, sizeof(name), "table_render/%d", payloads[i].count);
+        run_bench(name, bench_table_render, &payloads[i]);
+    }
+    
+    Baseline base[MAX_RESULTS];
+    int base_count = 0;
+    if (compare) {
+        base_count = load_baseline(compare, base, MAX_RESULTS);
+        if (base_count < 0) return 1;
+    }
+    
+    int regressions = 0;
+    print_results(compare ? base : NULL, base_count, tolerance, &regressions);
+    if (output && write_results(output) != 0) return 1;
+    
+    close(null_fd);
+    for (int i = 0; i < PAYLOAD_COUNT; i++) {
+        free_payload(&payloads[i]);
+    }
+    cJSON_Delete(recorded_root);
+    
+    if (regressions > 0) {
+        fprintf(stderr, "\n%d 项相对基线退化（容差 %.0f%%）\n", regressions, tolerance);
+        return 1;
+    }
+    return 0;
+}
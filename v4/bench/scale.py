@@ -0,0 +1,398 @@
+#!/usr/bin/env python3
+"""
+大规模集群压力测试
+
+在本地启动一个模拟的 PVE API（HTTPS，自签名证书），依次生成 10k / 50k / 100k 个 VM 的
+集群清单，对每个规模运行：
+  list      vmanager list
+  list-v    vmanager list -v（每个 VM 一次配置请求）
+  tui       vmanager -t，在伪终端中无头运行：等待首屏，执行移动、搜索、切换分组后退出
+记录墙钟时间（tui 为首屏时间）、峰值 RSS 和分配次数（需要 make 生成的
+bench/alloc_count.so），任一指标随 VM 数超线性增长时返回失败。
+
+用法: bench/scale.py [--sizes 10000,50000,100000] [--scenarios list,list-v,tui]
+                     [--slack 1.5] [--timeout 600] [--bin ./vmanager]
+依赖: python3、openssl 命令行
+"""
+
+import argparse
+import fcntl
+import json
+import os
+import pty
+import re
+import select
+import shutil
+import signal
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import termios
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+NODE = "pve"
+
+PREFIXES = ["web", "db", "cache", "ci", "k8s-node", "测试机"]
+POOLS = ["prod", "staging", "dev", ""]
+TAGS = ["prod;web", "db", "ci;ephemeral", "", "infra"]
+
+
+# ---- 模拟 API ----
+
+class Inventory:
+    """一个规模的集群清单；列表响应预先编码，单个 VM 的响应按需生成"""
+
+    def __init__(self, count):
+        self.count = count
+        vms = []
+        for i in range(count):
+            vmid = 100 + i
+            running = i % 3 != 0
+            vms.append({
+                "vmid": vmid,
+                "name": "%s-%06d" % (PREFIXES[i % len(PREFIXES)], i),
+                "status": "running" if running else "stopped",
+                "cpus": 2 + i % 4 * 2,
+                "maxmem": 4 << 30,
+                "mem": ((1 << 30) + i * 4096) if running else 0,
+                "maxdisk": 32 << 30,
+                "disk": 0,
+                "cpu": (i % 100) / 1000.0 if running else 0,
+                "uptime": 3600 + i if running else 0,
+                "netin": i * 1000,
+                "netout": i * 700,
+                "diskread": i * 5000,
+                "diskwrite": i * 3000,
+            })
+
+        self.qemu_list = json.dumps({"data": vms}).encode()
+
+        resources = []
+        for i, vm in enumerate(vms):
+            entry = dict(vm, type="qemu", id="qemu/%d" % vm["vmid"], node=NODE,
+                         maxcpu=vm["cpus"], tags=TAGS[i % len(TAGS)])
+            if POOLS[i % len(POOLS)]:
+                entry["pool"] = POOLS[i % len(POOLS)]
+            resources.append(entry)
+        self.resources = json.dumps({"data": resources}).encode()
+
+    def vm_config(self, vmid):
+        return {
+            "name": "vm-%d" % vmid,
+            "cores": 2,
+            "memory": 4096,
+            "net0": "virtio=BC:24:11:00:%02X:%02X,bridge=vmbr0" % (vmid >> 8 & 0xFF, vmid & 0xFF),
+            "scsi0": "local-lvm:vm-%d-disk-0,size=32G" % vmid,
+            "boot": "order=scsi0;net0",
+            "digest": "%040x" % vmid,
+        }
+
+    def contains(self, vmid):
+        return 100 <= vmid < 100 + self.count
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    # 头部和正文分两次写出，不关闭 Nagle 时每个请求都会等待延迟 ACK（约 40ms）
+    disable_nagle_algorithm = True
+    inventory = None
+
+    def log_message(self, *args):
+        pass
+
+    def send_body(self, code, body):
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def send_json(self, code, obj):
+        self.send_body(code, json.dumps(obj).encode())
+
+    def do_GET(self):
+        inv = Handler.inventory
+        path = self.path.split("?", 1)[0]
+
+        if path == "/api2/json/cluster/resources":
+            return self.send_body(200, inv.resources)
+        if path == "/api2/json/nodes/%s/qemu" % NODE:
+            return self.send_body(200, inv.qemu_list)
+        if path in ("/api2/json/cluster/tasks", "/api2/json/cluster/log"):
+            return self.send_json(200, {"data": []})
+
+        m = re.match(r"/api2/json/nodes/%s/qemu/(\d+)/(.+)$" % NODE, path)
+        if m and inv.contains(int(m.group(1))):
+            vmid, rest = int(m.group(1)), m.group(2)
+            if rest == "config":
+                return self.send_json(200, {"data": inv.vm_config(vmid)})
+            if rest == "status/current":
+                return self.send_json(200, {"data": {"vmid": vmid, "name": "vm-%d" % vmid,
+                                                     "status": "running", "cpus": 2,
+                                                     "maxmem": 4 << 30, "mem": 1 << 30,
+                                                     "uptime": 3600}})
+            if rest == "rrddata":
+                return self.send_json(200, {"data": []})
+        return self.send_json(501, {"data": None})
+
+    def do_POST(self):
+        self.send_json(501, {"data": None})
+
+
+def start_server(workdir):
+    cert = os.path.join(workdir, "cert.pem")
+    key = os.path.join(workdir, "key.pem")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                    "-subj", "/CN=localhost", "-keyout", key, "-out", cert],
+                   check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+    server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+    server.daemon_threads = True
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(cert, key)
+    server.socket = ctx.wrap_socket(server.socket, server_side=True)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+# ---- 场景 ----
+
+class Result:
+    def __init__(self, scenario, count):
+        self.scenario = scenario
+        self.count = count
+        self.wall = 0.0         # 秒
+        self.rss_kb = 0
+        self.allocs = None
+        self.error = None
+
+
+def read_shim_report(path, result):
+    """读取 alloc_count.so 的输出；没有时保留 ru_maxrss"""
+    try:
+        with open(path) as fp:
+            fields = dict(line.split() for line in fp if line.strip())
+    except (OSError, ValueError):
+        return
+    result.allocs = int(fields.get("allocs", 0))
+    if int(fields.get("hwm_kb", -1)) > 0:
+        result.rss_kb = int(fields["hwm_kb"])
+
+
+def run_cli(args, env, result, expect, timeout):
+    out_path = os.path.join(env["HOME"], "stdout")
+    err_path = os.path.join(env["HOME"], "stderr")
+    with open(out_path, "wb") as out, open(err_path, "wb") as err:
+        start = time.monotonic()
+        proc = subprocess.Popen(args, stdout=out, stderr=err, env=env)
+        deadline = start + timeout
+        while True:
+            pid, status, rusage = os.wait4(proc.pid, os.WNOHANG)
+            if pid:
+                break
+            if time.monotonic() > deadline:
+                proc.kill()
+                pid, status, rusage = os.wait4(proc.pid, 0)
+                result.error = "超时"
+                break
+            time.sleep(0.01)
+        result.wall = time.monotonic() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+
+    result.rss_kb = rusage.ru_maxrss
+    read_shim_report(env.get("VMANAGER_ALLOC_OUT", ""), result)
+    if result.error:
+        return
+    if proc.returncode != 0:
+        with open(err_path, "rb") as fp:
+            result.error = "退出码 %d: %s" % (proc.returncode,
+                                              fp.read().decode(errors="replace").strip()[:200])
+        return
+    with open(out_path, "rb") as fp:
+        if expect.encode() not in fp.read():
+            result.error = "输出中没有 '%s'" % expect
+
+
+def run_tui(args, env, result, timeout):
+    # 首屏出现后依次发送的按键：移动、增量搜索、退出搜索、切换分组、退出并确认
+    keys = [b"j" * 20, b"/", b"web", b"-00", b"12", b"\x1b", b"g", b"g", b"q", b"y"]
+    marker = re.compile(rb"(web|db|cache|ci|k8s-node)-\d{6}")
+
+    start = time.monotonic()
+    pid, fd = pty.fork()
+    if pid == 0:
+        fcntl.ioctl(sys.stdout.fileno(), termios.TIOCSWINSZ, struct.pack("HHHH", 50, 160, 0, 0))
+        os.execve(args[0], args, env)
+
+    tail = b""
+    next_key = None
+    status = rusage = None
+    while True:
+        now = time.monotonic()
+        if now - start > timeout:
+            os.kill(pid, signal.SIGKILL)
+            result.error = "超时（%s）" % ("未出现首屏" if next_key is None else "未退出")
+            break
+
+        ready, _, _ = select.select([fd], [], [], 0.05)
+        if ready:
+            try:
+                data = os.read(fd, 65536)
+            except OSError:
+                data = b""
+            if not data:
+                break
+            tail = (tail + data)[-4096:]
+            if next_key is None and marker.search(tail):
+                result.wall = time.monotonic() - start
+                next_key = time.monotonic()
+
+        # 按键间隔大于 ESC 延迟，避免 Esc 和下一个键被合并成 Alt 组合键
+        if next_key is not None and keys and time.monotonic() >= next_key:
+            os.write(fd, keys.pop(0))
+            next_key = time.monotonic() + 0.2
+
+    _, status, rusage = os.wait4(pid, 0)
+    os.close(fd)
+
+    result.rss_kb = rusage.ru_maxrss
+    read_shim_report(env.get("VMANAGER_ALLOC_OUT", ""), result)
+    code = os.waitstatus_to_exitcode(status)
+    if not result.error and code != 0:
+        result.error = "退出码 %d" % code
+
+
+# ---- 报告 ----
+
+def print_table(results):
+    header = "%-8s %8s %10s %12s %12s %10s %10s %10s" % (
+        "SCENARIO", "VMS", "WALL(s)", "PEAK RSS(MB)", "ALLOCS", "us/VM", "KB/VM", "ALLOCS/VM")
+    print("\033[1m%s\n%s\033[0m" % (header, "─" * len(header)))
+    for r in results:
+        allocs = "-" if r.allocs is None else str(r.allocs)
+        per_vm = "-" if r.allocs is None else "%.1f" % (r.allocs / r.count)
+        line = "%-8s %8d %10.3f %12.1f %12s %10.1f %10.2f %10s" % (
+            r.scenario, r.count, r.wall, r.rss_kb / 1024.0, allocs,
+            r.wall * 1e6 / r.count, r.rss_kb / r.count, per_vm)
+        if r.error:
+            line += "  ✗ " + r.error
+        print(line)
+
+
+def check_growth(results, slack):
+    """相邻规模之间，指标增长倍数不得超过 VM 数增长倍数 × slack"""
+    failures = []
+    scenarios = []
+    for r in results:
+        if r.scenario not in scenarios:
+            scenarios.append(r.scenario)
+
+    for name in scenarios:
+        rows = sorted((r for r in results if r.scenario == name and not r.error),
+                      key=lambda r: r.count)
+        for a, b in zip(rows, rows[1:]):
+            limit = b.count / a.count * slack
+            for metric, va, vb in (("wall", a.wall, b.wall),
+                                   ("rss", a.rss_kb, b.rss_kb),
+                                   ("allocs", a.allocs, b.allocs)):
+                if not va or vb is None:
+                    continue
+                growth = vb / va
+                if growth > limit:
+                    failures.append("%s %s: %d → %d 个 VM 增长 %.1f 倍（上限 %.1f 倍）" % (
+                        name, metric, a.count, b.count, growth, limit))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description="vmanager 大规模集群压力测试")
+    parser.add_argument("--sizes", default="10000,50000,100000", help="VM 数量，逗号分隔")
+    parser.add_argument("--scenarios", default="list,list-v,tui", help="要运行的场景")
+    parser.add_argument("--slack", type=float, default=1.5,
+                        help="允许的增长倍数相对线性的余量（默认 1.5）")
+    parser.add_argument("--timeout", type=float, default=600, help="单次运行超时秒数")
+    parser.add_argument("--bin", default=os.path.join(ROOT, "vmanager"))
+    opts = parser.parse_args()
+
+    sizes = sorted(int(s) for s in opts.sizes.split(",") if s.strip())
+    scenarios = [s.strip() for s in opts.scenarios.split(",") if s.strip()]
+    for s in scenarios:
+        if s not in ("list", "list-v", "tui"):
+            parser.error("未知场景: %s" % s)
+
+    if not os.access(opts.bin, os.X_OK):
+        sys.exit("错误：未找到 %s，请先运行 make" % opts.bin)
+    if not shutil.which("openssl"):
+        sys.exit("错误：需要 openssl 命令生成测试证书")
+
+    shim = os.path.join(ROOT, "bench", "alloc_count.so")
+    if not os.path.exists(shim):
+        print("提示：未找到 %s，不统计分配次数（make scale-test 会自动生成）" % shim,
+              file=sys.stderr)
+        shim = None
+
+    workdir = tempfile.mkdtemp(prefix="vmanager-scale-")
+    try:
+        server = start_server(workdir)
+        conf = os.path.join(workdir, "vmanager.conf")
+        with open(conf, "w") as fp:
+            fp.write("[server]\nhost = 127.0.0.1\nport = %d\nnode = %s\n\n"
+                     "[auth]\ntoken_id = root@pam!scale\ntoken_secret = scale\n"
+                     % (server.server_address[1], NODE))
+
+        # 独立的 HOME 和缓存目录，不读写用户自己的文件
+        env = dict(os.environ, HOME=workdir, XDG_CACHE_HOME=os.path.join(workdir, "cache"),
+                   TERM="xterm-256color")
+        env.pop("VMANAGER_CACHE_TTL", None)
+        if shim:
+            env["LD_PRELOAD"] = shim
+            env["VMANAGER_ALLOC_OUT"] = os.path.join(workdir, "allocs")
+
+        results = []
+        for count in sizes:
+            print("生成 %d 个 VM 的清单..." % count, file=sys.stderr)
+            Handler.inventory = Inventory(count)
+
+            for name in scenarios:
+                print("  运行 %s" % name, file=sys.stderr)
+                result = Result(name, count)
+                if shim:
+                    try:
+                        os.unlink(env["VMANAGER_ALLOC_OUT"])
+                    except FileNotFoundError:
+                        pass
+
+                if name == "list":
+                    run_cli([opts.bin, "-C", conf, "list"], env, result,
+                            "共 %d 个虚拟机" % count, opts.timeout)
+                elif name == "list-v":
+                    run_cli([opts.bin, "-C", conf, "list", "-v"], env, result,
+                            "共 %d 个虚拟机" % count, opts.timeout)
+                else:
+                    run_tui([opts.bin, "-C", conf, "-t"], env, result, opts.timeout)
+                results.append(result)
+
+        print()
+        print_table(results)
+
+        failures = check_growth(results, opts.slack)
+        errors = [r for r in results if r.error]
+        if failures:
+            print("\n超线性增长：")
+            for f in failures:
+                print("  ✗ " + f)
+        if errors or failures:
+            return 1
+        print("\n✓ 所有指标随 VM 数线性增长（余量 %.1f）" % opts.slack)
+        return 0
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,93 @@
+#!/bin/bash
+# 冷启动耗时基准：--version、缓存命中的 list 和 status
+#
+# 用法: bench/startup.sh [-n 次数] [-C 配置文件] [-m 上限毫秒] [VMID]
+#   -n  每项运行次数 (默认 200)
+#   -C  配置文件 (默认 ~/.vmanager.conf)；无法访问集群时只测 --version
+#   -m  任一项中位数超过该值 (毫秒) 时返回失败，用于 CI
+#   VMID 指定时额外测 status VMID
+#
+# list/status 先用 --cache-ttl 预热一次缓存，之后的运行不访问网络，
+# 测得的就是进程启动 + 配置加载 + 读缓存 + 输出的固定开销
+
+RUNS=200
+CONFIG="$HOME/.vmanager.conf"
+MAX_MS=""
+BIN="$(cd "$(dirname "$0")/.." && pwd)/vmanager"
+
+while getopts "n:C:m:" opt; do
+    case $opt in
+        n) RUNS=$OPTARG ;;
+        C) CONFIG=$OPTARG ;;
+        m) MAX_MS=$OPTARG ;;
+        *) sed -n '4,8p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+VMID=$1
+
+if [ ! -x "$BIN" ]; then
+    echo "错误：未找到 $BIN，请先运行 make" >&2
+    exit 1
+fi
+if [ -z "$EPOCHREALTIME" ]; then
+    echo "错误：需要 bash 5 (EPOCHREALTIME)" >&2
+    exit 1
+fi
+
+# 使用独立的缓存目录，不影响用户自己的缓存
+export XDG_CACHE_HOME
+XDG_CACHE_HOME=$(mktemp -d)
+trap 'rm -rf "$XDG_CACHE_HOME"' EXIT
+
+FAILED=0
+
+# bench NAME CMD...：运行 RUNS 次，输出 min / 中位数 / p95 (毫秒)
+bench() {
+    local name=$1
+    shift
+    local samples=()
+
+    for ((i = 0; i < RUNS; i++)); do
+        local start=${EPOCHREALTIME/./}
+        "$@" > /dev/null 2>&1
+        local end=${EPOCHREALTIME/./}
+        samples+=($((10#$end - 10#$start)))
+    done
+
+    local sorted
+    sorted=$(printf '%s\n' "${samples[@]}" | sort -n)
+    local min median p95
+    min=$(echo "$sorted" | sed -n '1p')
+    median=$(echo "$sorted" | sed -n "$((RUNS / 2 + 1))p")
+    p95=$(echo "$sorted" | sed -n "$((RUNS * 95 / 100 + 1))p")
+
+    awk -v name="$name" -v a="$min" -v b="$median" -v c="$p95" \
+        'BEGIN { printf "%-22s %8.2f %8.2f %8.2f\n", name, a / 1000, b / 1000, c / 1000 }'
+
+    if [ -n "$MAX_MS" ] && [ "$median" -gt $((MAX_MS * 1000)) ]; then
+        FAILED=1
+    fi
+}
+
+printf "\033[1m%-22s %8s %8s %8s\033[0m\n" "COMMAND" "MIN(ms)" "P50(ms)" "P95(ms)"
+
+# 进程创建本身的开销，作为参照
+bench "/bin/true" /bin/true
+bench "--version" "$BIN" --version
+
+if [ -f "$CONFIG" ] && "$BIN" -C "$CONFIG" --cache-ttl 3600 list > /dev/null 2>&1; then
+    bench "list (cached)" "$BIN" -C "$CONFIG" --cache-ttl 3600 list
+
+    if [ -n "$VMID" ]; then
+        if "$BIN" -C "$CONFIG" --cache-ttl 3600 status "$VMID" > /dev/null 2>&1; then
+            bench "status $VMID (cached)" "$BIN" -C "$CONFIG" --cache-ttl 3600 status "$VMID"
+        else
+            echo "跳过 status：无法获取 VM $VMID 的状态" >&2
+        fi
+    fi
+else
+    echo "跳过 list/status：无法使用配置 $CONFIG 访问集群" >&2
+fi
+
+exit $FAILED
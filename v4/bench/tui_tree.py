@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+TUI 树形视图测试
+在伪终端中对 bench/fixtures/pve（3 个节点、每个节点多个资源池分组，行数多于 VM 数的两倍）
+无头运行 vmanager -t，检查首屏中每个节点、分组和 VM 都有一行，然后退出。
+
+用法: bench/tui_tree.py [vmanager 路径]
+"""
+
+import fcntl
+import os
+import pty
+import select
+import signal
+import struct
+import sys
+import termios
+import time
+
+FIXTURE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures", "pve")
+TIMEOUT = 10
+
+# 按 user.cfg 和 .vmlist 的布局，树中应出现的节点、分组和 VM
+EXPECTED = [
+    "pve1", "pve2", "pve3",
+    "prod", "tpl", "staging", "batch", "lab", "(no pool)",
+    "web-01", "db-01", "tpl-debian", "app-01", "new-01", "batch-01", "old-01", "old-02",
+]
+
+
+def main():
+    binary = sys.argv[1] if len(sys.argv) > 1 else "./vmanager"
+    env = dict(os.environ, VMANAGER_PVE_ROOT=FIXTURE, TERM="xterm", ESCDELAY="25")
+    args = [binary, "-C", os.path.join(FIXTURE, "vmanager.conf"), "-t"]
+
+    pid, fd = pty.fork()
+    if pid == 0:
+        fcntl.ioctl(sys.stdout.fileno(), termios.TIOCSWINSZ, struct.pack("HHHH", 50, 160, 0, 0))
+        os.execve(args[0], args, env)
+
+    output = b""
+    start = time.monotonic()
+    quit_sent = False
+    while time.monotonic() - start < TIMEOUT:
+        ready, _, _ = select.select([fd], [], [], 0.05)
+        if ready:
+            try:
+                data = os.read(fd, 65536)
+            except OSError:
+                data = b""
+            if not data:
+                break
+            output += data
+        # 最后一个 VM 出现在首屏后退出并确认
+        if not quit_sent and b"old-02" in output:
+            time.sleep(0.2)
+            os.write(fd, b"q")
+            time.sleep(0.2)
+            os.write(fd, b"y")
+            quit_sent = True
+    else:
+        os.kill(pid, signal.SIGKILL)
+
+    _, status = os.waitpid(pid, 0)
+    os.close(fd)
+
+    missing = [name for name in EXPECTED if name.encode() not in output]
+    code = os.waitstatus_to_exitcode(status)
+    if missing or code != 0:
+        print("✗ TUI 树形视图: 退出码 %d，缺少 %s" % (code, ", ".join(missing) or "-"), file=sys.stderr)
+        return 1
+    print("✓ TUI tree test passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
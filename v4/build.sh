@@ -12,8 +12,8 @@ echo "Cleaning..."
 rm -f vmanager src/*.o src/core/*.o src/ui/*.o src/utils/*.o *.o
 
 # 编译标志
-CFLAGS="-Wall -Wextra -O2 -std=c11 -Iinclude"
-LDFLAGS="-lcurl -lncurses -lm"
+CFLAGS="-Wall -Wextra -O2 -std=c11 -pthread -Iinclude"
+LDFLAGS="-lncurses -lm -lpthread -ldl"
 
 # 编译源文件
 echo "Compiling cJSON.c..."
@@ -25,6 +25,15 @@ gcc $CFLAGS -c src/utils/json.c -o src/utils/json.o
 echo "Compiling src/utils/common.c..."
 gcc $CFLAGS -c src/utils/common.c -o src/utils/common.o
 
+echo "Compiling src/utils/pool.c..."
+gcc $CFLAGS -c src/utils/pool.c -o src/utils/pool.o
+
+echo "Compiling src/utils/search.c..."
+gcc $CFLAGS -c src/utils/search.c -o src/utils/search.o
+
+echo "Compiling src/utils/table.c..."
+gcc $CFLAGS -c src/utils/table.c -o src/utils/table.o
+
 echo "Compiling src/core/config.c..."
 gcc $CFLAGS -c src/core/config.c -o src/core/config.o
 
@@ -33,18 +42,69 @@ gcc $CFLAGS -c src/core/api.c -o src/core/api.o
 
 gcc $CFLAGS -c src/core/vm.c -o src/core/vm.o
 
+echo "Compiling src/core/snapshot.c..."
+gcc $CFLAGS -c src/core/snapshot.c -o src/core/snapshot.o
+
+echo "Compiling src/core/clone.c..."
+gcc $CFLAGS -c src/core/clone.c -o src/core/clone.o
+
+echo "Compiling src/core/events.c..."
+gcc $CFLAGS -c src/core/events.c -o src/core/events.o
+
+echo "Compiling src/core/cluster.c..."
+gcc $CFLAGS -c src/core/cluster.c -o src/core/cluster.o
+
+echo "Compiling src/core/confwatch.c..."
+gcc $CFLAGS -c src/core/confwatch.c -o src/core/confwatch.o
+
+echo "Compiling src/core/history.c..."
+gcc $CFLAGS -c src/core/history.c -o src/core/history.o
+
+echo "Compiling src/core/cache.c..."
+gcc $CFLAGS -c src/core/cache.c -o src/core/cache.o
+
+echo "Compiling src/core/auth.c..."
+gcc $CFLAGS -c src/core/auth.c -o src/core/auth.o
+
+echo "Compiling src/core/local.c..."
+gcc $CFLAGS -c src/core/local.c -o src/core/local.o
+
+echo "Compiling src/core/backup.c..."
+gcc $CFLAGS -c src/core/backup.c -o src/core/backup.o
+
+echo "Compiling src/core/migrate.c..."
+gcc $CFLAGS -c src/core/migrate.c -o src/core/migrate.o
+
+echo "Compiling src/core/rebalance.c..."
+gcc $CFLAGS -c src/core/rebalance.c -o src/core/rebalance.o
+
+echo "Compiling src/core/set.c..."
+gcc $CFLAGS -c src/core/set.c -o src/core/set.o
+
+echo "Compiling src/core/wait.c..."
+gcc $CFLAGS -c src/core/wait.c -o src/core/wait.o
+
 echo "Compiling src/ui/cli.c..."
 gcc $CFLAGS -c src/ui/cli.c -o src/ui/cli.o
 
 echo "Compiling src/ui/tui.c..."
 gcc $CFLAGS -c src/ui/tui.c -o src/ui/tui.o
 
+echo "Compiling src/ui/watch.c..."
+gcc $CFLAGS -c src/ui/watch.c -o src/ui/watch.o
+
+echo "Compiling src/ui/batch.c..."
+gcc $CFLAGS -c src/ui/batch.c -o src/ui/batch.o
+
+echo "Compiling src/ui/shell.c..."
+gcc $CFLAGS -c src/ui/shell.c -o src/ui/shell.o
+
 echo "Compiling src/main.c..."
 gcc $CFLAGS -c src/main.c -o src/main.o
 
 # 链接
 echo "Linking vmanager..."
-gcc $CFLAGS -o vmanager src/main.o src/core/api.o src/core/config.o src/core/vm.o src/ui/cli.o src/ui/tui.o src/utils/json.o src/utils/common.o cJSON.o $LDFLAGS
+gcc $CFLAGS -o vmanager src/main.o src/core/api.o src/core/config.o src/core/vm.o src/core/snapshot.o src/core/clone.o src/core/events.o src/core/cluster.o src/core/confwatch.o src/core/history.o src/core/cache.o src/core/auth.o src/core/local.o src/core/backup.o src/core/migrate.o src/core/rebalance.o src/core/set.o src/core/wait.o src/ui/cli.o src/ui/tui.o src/ui/watch.o src/ui/batch.o src/ui/shell.o src/utils/json.o src/utils/common.o src/utils/pool.o src/utils/search.o src/utils/table.o cJSON.o $LDFLAGS
 
 echo ""
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
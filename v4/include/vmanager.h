@@ -10,23 +10,39 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
 #include "../cJSON.h"
 
 #define VERSION "4.0.1"
 #define PROGRAM_NAME "vmanager"
-#define MAX_VMIDS 100
+#define MAX_VMIDS 4096
+#define DEFAULT_PARALLEL 8
+#define MAX_CLUSTERS 32
+#define AUTH_TICKET_LEN 1024
+#define AUTH_CSRF_LEN 256
 
 // 配置结构
 typedef struct {
+    char name[64];          // 集群名称（多集群配置）
     char host[256];
     int port;
     char node[64];
     char token_id[256];
     char token_secret[256];
+    char username[128];     // 未设置 token 时用户名密码登录（user@realm）
+    char password[256];     // 可留空，改用环境变量 VMANAGER_PASSWORD
     bool verify_ssl;
     char config_file[512];
 } Config;
 
+// guest agent 状态（来自 VM 配置的 agent 项）
+typedef enum {
+    AGENT_UNKNOWN = 0,      // 尚未读取配置
+    AGENT_DISABLED,
+    AGENT_ENABLED
+} AgentState;
+
 // VM 信息结构
 typedef struct {
     int vmid;
@@ -44,8 +60,62 @@ typedef struct {
     char storage[64];     // 存储位置
     char config_file[256]; // 配置文件路径
     int uptime;           // seconds
+    uint64_t netin;       // 累计网络接收 bytes
+    uint64_t netout;      // 累计网络发送 bytes
+    uint64_t diskread;    // 累计磁盘读 bytes
+    uint64_t diskwrite;   // 累计磁盘写 bytes
+    AgentState agent;     // guest agent 是否启用
+    char node[64];        // 所在节点
+    char pool[64];        // 资源池
+    char tags[128];       // 标签，以 ; 分隔
 } VMInfo;
 
+// 节点信息（来自 /cluster/resources?type=node）
+typedef struct {
+    char name[64];
+    bool online;
+    int maxcpu;
+    double cpu_percent;
+    uint64_t maxmem;        // bytes
+    uint64_t mem;           // bytes
+} NodeInfo;
+
+// guest agent 请求统计
+typedef struct {
+    long calls;             // 实际发出的请求
+    long failures;
+    long probes;            // 退避结束后的短超时试探
+    long skipped_disabled;  // 配置中未启用 agent
+    long skipped_backoff;   // 处于失败退避期
+} AgentStats;
+
+// 请求重试统计
+typedef struct {
+    long requests;          // 经过重试层的请求
+    long retries;           // 额外发出的重试次数
+    long recovered;         // 重试后成功，或确认操作已经生效
+    long exhausted;         // 重试次数或时限用完仍失败
+} RetryStats;
+
+// 对冲读取统计
+typedef struct {
+    long eligible;          // 样本足够、可以对冲的 GET
+    long hedged;            // 发出的对冲请求
+    long wins;              // 对冲请求先返回
+    long denied;            // 超过 p95 但超出预算
+} HedgeStats;
+
+// 每个 API 地址的自适应并发窗口
+typedef struct {
+    char host[80];          // host:port
+    double window;          // 当前允许同时在途的请求数
+    int inflight;
+    int max_inflight;       // 实际达到的最大并发
+    long requests;
+    long waits;             // 因窗口已满而等待的请求
+    long cuts;              // 拥塞后减小窗口的次数
+} HostConcurrency;
+
 // 执行模式
 typedef enum {
     MODE_AUTO,
@@ -75,30 +145,318 @@ typedef enum {
     CMD_SNAPSHOT
 } Command;
 
+// 快照操作
+typedef enum {
+    SNAP_CREATE,
+    SNAP_LIST,
+    SNAP_ROLLBACK,
+    SNAP_DELETE,
+    SNAP_PRUNE
+} SnapshotAction;
+
+// 快照选项
+typedef struct {
+    SnapshotAction action;
+    char name[64];          // create/rollback/delete 的快照名
+    char prefix[32];        // 自动命名前缀，prune 只处理此前缀的快照
+    char description[256];
+    bool vmstate;           // 同时保存内存状态
+    int keep_last;          // 保留最近 N 个
+    int keep_daily;         // 每天保留一个，共 N 天
+    int per_storage;        // 每个存储的并发上限 (<=0 不限制)
+    int timeout;            // 单个任务等待超时（秒）
+    bool dry_run;
+} SnapshotOptions;
+
+// 克隆方式
+typedef enum {
+    CLONE_AUTO,             // 支持时使用链接克隆
+    CLONE_LINKED,
+    CLONE_FULL
+} CloneMode;
+
+// 批量克隆选项
+typedef struct {
+    int source;             // 源 VM / 模板
+    int count;
+    int start_id;           // 起始 VMID (0 表示自动分配)
+    char name_pattern[128]; // 名称模式，%d 替换为序号
+    char storage[64];       // 完整克隆的目标存储
+    char target[64];        // 目标节点
+    CloneMode mode;
+    int per_storage;        // 每个存储的完整克隆并发上限
+    int timeout;            // 单个任务等待超时（秒）
+} CloneOptions;
+
+// 迁移选项
+typedef struct {
+    char target[64];        // --to 目标节点
+    char evacuate[64];      // --evacuate 清空的节点
+    int per_source;         // 每个源节点的并发迁移上限 (<=0 不限制)
+    int per_target;         // 每个目标节点的并发迁移上限 (<=0 不限制)
+    int bwlimit;            // 带宽上限 KiB/s，0 使用集群默认
+    bool with_local_disks;  // 同时迁移本地磁盘
+    int timeout;            // 单个任务等待超时（秒）
+    bool dry_run;
+} MigrateOptions;
+
+// 单个迁移
+typedef struct {
+    int vmid;
+    char name[128];
+    char source[64];
+    char target[64];
+    uint64_t maxmem;
+    bool online;            // 运行中的 VM 在线迁移
+} MigrateMove;
+
+// 备份选项
+typedef struct {
+    char storage[64];       // 目标存储，空表示使用 vzdump 默认存储
+    char mode[16];          // snapshot/suspend/stop
+    char compress[16];      // zstd/lzo/gzip/0
+    int per_storage;        // 每个目标存储的并发备份上限 (<=0 不限制)
+    int per_node;           // 每个节点的并发备份上限 (<=0 不限制)
+    int bwlimit;            // 带宽上限 KiB/s，0 使用节点默认
+    int timeout;            // 单个任务等待超时（秒）
+    bool dry_run;
+} BackupOptions;
+
+// 负载均衡选项
+typedef struct {
+    bool apply;             // 执行迁移计划，否则只打印
+    int max_moves;          // 最多迁移的 VM 数
+    char timeframe[16];     // 负载取 rrddata 平均值的时间范围 (hour/day/week)
+    int mem_limit;          // 目标节点内存使用率上限 (%)
+    MigrateOptions migrate; // 执行迁移时的并发、带宽和超时
+} RebalanceOptions;
+
+// set 命令的配置修改
+#define SET_MAX_CHANGES 32
+
+typedef struct {
+    char key[32];
+    char value[256];
+    bool remove;            // 删除该配置项（--delete KEY）
+} ConfigChange;
+
+typedef struct {
+    ConfigChange changes[SET_MAX_CHANGES];
+    int count;
+    bool dry_run;
+} SetOptions;
+
+// wait 命令的目标状态
+typedef enum {
+    WAIT_RUNNING,
+    WAIT_STOPPED,
+    WAIT_AGENT_READY        // 运行中且 guest agent 可响应
+} WaitState;
+
+// wait 选项
+typedef struct {
+    WaitState state;
+    int timeout;            // 总超时（秒）
+    bool any;               // 任一 VM 达到即返回
+} WaitOptions;
+
+// 集群变更事件
+#define EVENT_MAX_CHANGES 256
+#define EVENT_LOG_SEEN 64
+
+typedef struct {
+    int vmids[EVENT_MAX_CHANGES];   // 需要定向刷新的 VM
+    int count;
+    bool full_refresh;              // VM 集合变化或变更过多，需要重新获取列表
+    bool node_changed;              // 有 VM 迁移
+} EventChanges;
+
+typedef struct {
+    bool tasks_primed;              // 两个来源各自在第一次成功轮询时建立基线
+    bool log_primed;
+    uint64_t *tasks_seen;           // 上次看到的任务（UPID 哈希，已排序）
+    int tasks_seen_count;
+    uint64_t *tasks_done;           // 上次看到时已结束的任务
+    int tasks_done_count;
+    long log_time;                  // 已处理日志的最新时间
+    uint64_t log_seen[EVENT_LOG_SEEN];
+    int log_seen_count;
+    long polls;
+    long changes;
+} EventFeed;
+
+// 按键分组的并发上限（例如每个存储同时最多 N 个任务）
+#define LIMIT_MAX_KEYS 64
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int max_per_key;
+    int nkeys;
+    char keys[LIMIT_MAX_KEYS][64];
+    int active[LIMIT_MAX_KEYS];
+} KeyedLimit;
+
+// VM 名称/VMID 搜索索引
+// 三个字符以上的查询走小写三元组倒排表（子串匹配），更短的查询走前缀表
+typedef struct {
+    const char *text;       // 小写的 VMID 或名称（或名称中的单词）
+    int vm;
+} SearchToken;
+
+typedef struct {
+    int count;              // VM 数
+    char *arena;            // 所有小写文本
+    const char **names;     // 每个 VM 的小写名称
+    const char **ids;       // 每个 VM 的 VMID 字符串
+    uint32_t *tri_keys;     // 去重排序后的三元组
+    int *tri_start;         // tri_keys[i] 的倒排表为 tri_postings[tri_start[i] .. tri_start[i+1])
+    int *tri_postings;
+    int tri_count;
+    SearchToken *tokens;    // 按 text 排序的前缀表
+    int token_count;
+    unsigned *mark;         // 结果去重用的代数标记
+    unsigned generation;
+} SearchIndex;
+
+// VM 指标历史（TUI 迷你图），每个 VM 固定大小的环形缓冲区
+#define HISTORY_SAMPLES 60      // 每个 VM 保留的样本数
+#define HISTORY_STEP 60         // 样本间隔（秒），与 rrddata hour 视图的精度一致
+
+typedef enum {
+    METRIC_CPU,             // CPU 使用率 (%)
+    METRIC_MEM,             // 内存使用率 (%)
+    METRIC_DISK,            // 磁盘读写 (bytes/s)
+    METRIC_NET,             // 网络收发 (bytes/s)
+    METRIC_COUNT
+} MetricKind;
+
+typedef struct {
+    int vmid;
+    bool seeded;                    // 已尝试用 rrddata 补齐历史
+    int head;                       // 下一个写入位置
+    int len;                        // 有效样本数
+    time_t last_time;               // 上次采样（或建立计数器基线）的时间
+    uint64_t disk_bytes;            // 上次采样时的累计磁盘读写
+    uint64_t net_bytes;             // 上次采样时的累计网络收发
+    float samples[METRIC_COUNT][HISTORY_SAMPLES];
+} VMHistory;
+
+// 表格输出：列宽按内容的显示宽度计算，整张表一次 write()
+#define TABLE_MAX_COLUMNS 12
+
+typedef struct {
+    const char *title;
+    bool align_right;       // 数值列右对齐
+} TableColumn;
+
+typedef struct {
+    size_t offset;          // 在 arena 中的位置
+    int len;                // 字节数
+    int width;              // 显示宽度
+} TableCell;
+
+typedef struct {
+    int ncols;
+    TableColumn cols[TABLE_MAX_COLUMNS];
+    int widths[TABLE_MAX_COLUMNS];
+    char *arena;            // 所有单元格文本，以 '\0' 分隔
+    size_t arena_len;
+    size_t arena_cap;
+    TableCell *cells;       // 按行优先排列
+    int cell_count;
+    int cell_cap;
+    bool failed;            // 内存不足
+} Table;
+
+// 作用于一组 VMID 的操作（电源操作和 destroy），多集群分发和 batch 合并共用一张表
+typedef struct {
+    const char *command;    // 命令名
+    const char *action;     // api_vm_action 的操作名
+    const char *label;
+} VMAction;
+
 // 全局配置
 extern Config g_config;
+extern Config g_clusters[MAX_CLUSTERS];    // --cluster 选中的集群
+extern int g_cluster_count;                 // 大于 1 时命令并发发往所有选中集群
 extern ExecutionMode g_exec_mode;
 extern bool g_verbose;
 extern bool g_debug;
 extern bool g_tui_mode;
+extern int g_parallel;
+extern int g_cache_ttl;                     // list/status 的 GET 响应缓存秒数，0 表示不缓存
+extern bool g_hedge;                        // 慢于 p95 的 GET 发出对冲请求
 
 // core/api.c
 int api_init(Config *config);
 cJSON* api_get(const char *endpoint);
 cJSON* api_post(const char *endpoint, cJSON *data);
-int api_get_vm_list(VMInfo **vms, int *count);
-int api_get_vm_status(int vmid, VMInfo *vm);
+cJSON* api_put(const char *endpoint, cJSON *data);
+cJSON* api_delete(const char *endpoint);
+long api_last_http_code(void);
+const char* api_last_error(void);
+int api_response_upid(cJSON *response, char *upid, size_t len);
+int api_wait_task(const char *upid, int timeout_sec, char *exitstatus, size_t len);
+int api_resolve_node(int vmid, char *node, size_t len);
+bool api_vmid_exists(int vmid);
+void api_invalidate_node_cache(void);
+int api_load_node_cache(void);
+void api_use_config(Config *config);
+int api_get_vm_list(VMInfo **vms, int *count, int cache_ttl);
+int api_parse_vm_list(cJSON *data, const char *node, VMInfo **vms, int *count);
+int api_get_cluster_vms(VMInfo **vms, int *count);
+int api_get_nodes(NodeInfo **nodes, int *count);
+int api_get_vm_status(int vmid, VMInfo *vm, int cache_ttl);
 int api_vm_action(int vmid, const char *action);
-int api_get_vm_config_details(int vmid, VMInfo *vm);
-int api_get_vm_ip(int vmid, VMInfo *vm);
+void api_parse_vm_config(cJSON *data, VMInfo *vm);
+int api_get_vm_config_details(int vmid, VMInfo *vm, int cache_ttl);
+int api_get_vm_ip(int vmid, VMInfo *vm, int cache_ttl);
+int api_login(const char *username, const char *password, char *ticket, size_t ticket_len,
+              char *csrf, size_t csrf_len);
+int api_agent_ping(int vmid, const char *node);
+void api_agent_stats(AgentStats *stats);
+void api_retry_stats(RetryStats *stats);
+void api_hedge_stats(HedgeStats *stats);
+int api_concurrency_stats(HostConcurrency *stats, int max);
+void api_thread_cleanup(void);
 void api_cleanup(void);
 
+// core/auth.c
+bool auth_uses_ticket(const Config *config);
+int auth_ticket(const Config *config, char *ticket, size_t ticket_len, char *csrf, size_t csrf_len,
+                char *error, size_t error_len);
+void auth_invalidate(const Config *config);
+
+// core/backup.c
+int backup_run(const int *vmids, int count, const BackupOptions *opts);
+
+// core/cache.c
+char* cache_read(const Config *config, const char *endpoint, int ttl);
+void cache_write(const Config *config, const char *endpoint, const char *body, size_t len);
+void cache_invalidate(const Config *config);
+int cache_file_path(const Config *config, const char *name, char *path, size_t len);
+
+// core/cluster.c
+int cluster_select(const char *spec, const Config *all, int count, Config *out, int max);
+int cluster_list(Config *clusters, int count);
+int cluster_status(Config *clusters, int count, const int *vmids, int vmid_count);
+int cluster_action(Config *clusters, int count, const int *vmids, int vmid_count,
+                   const char *action, const char *label);
+
 // core/config.c
 int config_load(Config *config, const char *file);
+int config_load_clusters(const char *file, Config *clusters, int max_clusters);
 int config_save(Config *config, const char *file);
 int config_wizard(Config *config);
 bool is_on_pve_server(void);
 
+// core/local.c
+const char* local_pve_root(void);
+bool local_backend_enabled(const Config *config);
+int local_parse_cluster(const char *vmlist, const char *rrd, VMInfo **vms, int *count, int *missing);
+int local_get_cluster_vms(VMInfo **vms, int *count, bool with_config, int *missing);
+cJSON* local_read_vm_config(const char *node, int vmid);
+
 // core/vm.c
 int vm_list(bool verbose);
 int vm_status(int vmid);
@@ -110,11 +468,57 @@ int vm_resume(int vmid);
 int vm_destroy(int vmid, bool force);
 int vm_clone(int vmid, int newid, const char *name);
 
+// core/clone.c
+int clone_run(const CloneOptions *opts);
+
+// core/confwatch.c
+int confwatch_start(const Config *config);
+int confwatch_poll(EventChanges *out);
+int confwatch_details(int vmid, VMInfo *vm);
+void confwatch_stop(void);
+
+// core/events.c
+void event_feed_init(EventFeed *feed);
+int event_feed_poll(EventFeed *feed, EventChanges *out);
+void event_feed_free(EventFeed *feed);
+
+// core/history.c
+void history_init(VMHistory *h, int vmid);
+void history_sample(VMHistory *h, const VMInfo *vm, time_t now);
+int history_seed(VMHistory *h, const VMInfo *vm);
+int history_values(const VMHistory *h, MetricKind kind, float *out, int max);
+
+// core/snapshot.c
+int snapshot_run(const int *vmids, int count, const SnapshotOptions *opts);
+
+// core/migrate.c
+int migrate_run(const int *vmids, int count, const MigrateOptions *opts);
+int migrate_execute(MigrateMove *moves, int count, const MigrateOptions *opts);
+
+// core/rebalance.c
+int rebalance_run(const RebalanceOptions *opts);
+
+// core/set.c
+int set_run(const int *vmids, int count, const SetOptions *opts);
+
+// core/wait.c
+int wait_run(const int *vmids, int count, const WaitOptions *opts);
+
 // ui/cli.c
 int cli_main(int argc, char *argv[]);
+const VMAction* cli_vm_action(const char *command);
 void cli_print_vm_list(VMInfo *vms, int count, bool verbose);
 void cli_print_vm_status(VMInfo *vm);
 
+// ui/watch.c
+int watch_vm_list(double interval);
+
+// ui/batch.c
+int batch_main(int argc, char *argv[]);
+
+// ui/shell.c
+int shell_main(int argc, char *argv[]);
+
 // ui/tui.c
 int tui_main(void);
 void tui_init(void);
@@ -135,10 +539,38 @@ void log_warn(const char *fmt, ...);
 void log_error(const char *fmt, ...);
 void log_cleanup(void);
 
+// utils/search.c
+int search_index_build(SearchIndex *idx, const VMInfo *vms, int count);
+void search_index_free(SearchIndex *idx);
+int search_query(SearchIndex *idx, const char *query, int *out);
+int search_refine(SearchIndex *idx, const char *query, const int *prev, int prev_count, int *out);
+
+// utils/table.c
+int str_display_width(const char *s);
+void table_init(Table *t, const TableColumn *cols, int ncols);
+int table_cell(Table *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+int table_rows(const Table *t);
+char* table_render(const Table *t, size_t *len);
+int table_write(Table *t, int fd);
+void table_free(Table *t);
+int write_all(int fd, const char *buf, size_t len);
+
+// utils/pool.c
+int pool_run(int jobs, int workers, void (*fn)(int index, void *arg), void *arg);
+void keyed_limit_init(KeyedLimit *kl, int max_per_key);
+void keyed_limit_acquire(KeyedLimit *kl, const char *key);
+bool keyed_limit_try_acquire(KeyedLimit *kl, const char *key);
+void keyed_limit_release(KeyedLimit *kl, const char *key);
+void keyed_limit_destroy(KeyedLimit *kl);
+
 // utils/common.c
 bool is_number(const char *str);
 int parse_vmid_range(const char *range, int *vmids, int *count);
-char* format_bytes(uint64_t bytes);
-char* format_uptime(int seconds);
+#define FORMAT_LEN 32        // format_bytes/format_uptime 缓冲区大小
+char* format_bytes(uint64_t bytes, char *buf, size_t len);
+char* format_uptime(int seconds, char *buf, size_t len);
+double now_monotonic(void);
+void progress_draw(const char *label, int done, int failed, int total);
+int split_args(char *line, char *argv[], int max);
 
 #endif // VMANAGER_H
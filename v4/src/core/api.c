@@ -6,9 +6,86 @@
 #define _POSIX_C_SOURCE 200809L
 #include "../../include/vmanager.h"
 #include <curl/curl.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#define API_TIMEOUT 30              // 普通请求超时（秒）
+#define AGENT_TIMEOUT 10            // guest agent 请求超时
+#define AGENT_PROBE_TIMEOUT 3       // 退避结束后试探已知故障的 agent
+#define AGENT_BACKOFF_BASE 30       // 首次失败后的退避时间（秒），之后逐次翻倍
+#define AGENT_BACKOFF_MAX 900
+#define RETRY_MAX_ATTEMPTS 5        // 暂时性失败时的最多尝试次数（含第一次）
+#define RETRY_BASE_MS 200           // 第一次重试前最长等待，之后逐次翻倍
+#define RETRY_MAX_MS 5000
+#define RETRY_DEADLINE 60           // 含重试在内的总时长上限（秒）
+#define HEDGE_WINDOW 64             // 每类 GET 保留的最近延迟样本数
+#define HEDGE_MIN_SAMPLES 20        // 样本足够多才估计 p95 并对冲
+#define HEDGE_CLASSES 64
+#define HEDGE_MIN_DELAY_MS 20       // p95 低于此值时按此值等待，避免对冲本来就很快的请求
+#define HEDGE_BUDGET_PCT 10         // 对冲请求数不超过可对冲请求的 10%（另加 HEDGE_BURST）
+#define HEDGE_BURST 3
+#define HEDGE_MAX_HOSTS 16
+#define AIMD_INITIAL 2              // 每个 API 地址起始允许的并发请求数
+#define AIMD_MAX 64
+#define AIMD_SPIKE 2.0              // 延迟超过同类请求基线的倍数视为拥塞
+#define AIMD_SPIKE_MIN_MS 50        // 且至少高出基线这么多，避免快速请求的抖动触发退让
+#define AIMD_HOSTS (MAX_CLUSTERS + HEDGE_MAX_HOSTS)
 
 static Config *api_config = NULL;
-static CURL *curl_handle = NULL;
+static CURLSH *curl_share = NULL;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+// libcurl 在第一次真正发出请求时才通过 dlopen 加载并初始化：
+// 直接链接会让每次启动都加载整条 TLS 依赖链（约 6ms），而 --version、缓存命中的
+// list/status 根本不需要网络
+static pthread_once_t curl_once = PTHREAD_ONCE_INIT;
+static bool curl_ready = false;
+
+static struct {
+    void *handle;
+    CURLcode (*global_init)(long flags);
+    void (*global_cleanup)(void);
+    CURL* (*easy_init)(void);
+    CURLcode (*easy_setopt)(CURL *curl, CURLoption option, ...);
+    CURLcode (*easy_perform)(CURL *curl);
+    CURLcode (*easy_getinfo)(CURL *curl, CURLINFO info, ...);
+    const char* (*easy_strerror)(CURLcode code);
+    char* (*easy_escape)(CURL *curl, const char *string, int length);
+    void (*easy_cleanup)(CURL *curl);
+    void (*free)(void *p);
+    CURLSH* (*share_init)(void);
+    CURLSHcode (*share_setopt)(CURLSH *share, CURLSHoption option, ...);
+    CURLSHcode (*share_cleanup)(CURLSH *share);
+    struct curl_slist* (*slist_append)(struct curl_slist *list, const char *data);
+    void (*slist_free_all)(struct curl_slist *list);
+    // 以下为可选符号，缺少时不做对冲请求
+    CURLM* (*multi_init)(void);
+    CURLMcode (*multi_add_handle)(CURLM *multi, CURL *curl);
+    CURLMcode (*multi_remove_handle)(CURLM *multi, CURL *curl);
+    CURLMcode (*multi_perform)(CURLM *multi, int *running);
+    CURLMcode (*multi_poll)(CURLM *multi, struct curl_waitfd *fds, unsigned int nfds, int timeout_ms, int *numfds);
+    CURLMsg* (*multi_info_read)(CURLM *multi, int *msgs_in_queue);
+    CURLMcode (*multi_cleanup)(CURLM *multi);
+} lib;
+
+// 每个线程使用独立的 easy handle，连接、DNS 和 TLS 会话通过 share 复用
+static _Thread_local CURL *curl_handle = NULL;
+static _Thread_local CURL *hedge_handle = NULL;     // 对冲请求使用的第二个 handle
+static _Thread_local CURLM *hedge_multi = NULL;
+static _Thread_local long last_http_code = 0;
+static _Thread_local char last_error[256] = "";
+
+// 登录请求本身不带认证头
+static _Thread_local bool login_request = false;
+
+// 多集群并发时，工作线程各自指定要访问的集群
+static _Thread_local Config *thread_config = NULL;
+
+static Config* current_config(void) {
+    return thread_config ? thread_config : api_config;
+}
 
 // libcurl 写入回调函数
 struct MemoryStruct {
@@ -34,154 +111,1331 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return realsize;
 }
 
+// 记录状态行中的错误原因（PVE 把错误信息放在 HTTP reason phrase 中），
+// userp 指向 sizeof(last_error) 大小的缓冲区
+static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userp) {
+    char *reason = (char *)userp;
+    size_t len = size * nitems;
+    
+    if (len > 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        // 格式: HTTP/1.1 500 reason...
+        const char *p = memchr(buffer, ' ', len);
+        if (p) p = memchr(p + 1, ' ', len - (size_t)(p + 1 - buffer));
+        if (p) {
+            p++;
+            size_t n = len - (size_t)(p - buffer);
+            while (n > 0 && (p[n - 1] == '\r' || p[n - 1] == '\n')) n--;
+            if (n >= sizeof(last_error)) n = sizeof(last_error) - 1;
+            memcpy(reason, p, n);
+            reason[n] = '\0';
+        }
+    }
+    
+    return len;
+}
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp) {
+    (void)handle; (void)access; (void)userp;
+    pthread_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userp) {
+    (void)handle; (void)userp;
+    pthread_mutex_unlock(&share_locks[data]);
+}
+
+static bool load_libcurl(void) {
+    static const char *sonames[] = { "libcurl.so.4", "libcurl-gnutls.so.4", "libcurl.so" };
+    for (size_t i = 0; i < sizeof(sonames) / sizeof(sonames[0]) && !lib.handle; i++) {
+        lib.handle = dlopen(sonames[i], RTLD_NOW | RTLD_LOCAL);
+    }
+    if (!lib.handle) return false;
+    
+    const struct {
+        const char *name;
+        void **slot;
+    } symbols[] = {
+        { "curl_global_init",    (void **)&lib.global_init },
+        { "curl_global_cleanup", (void **)&lib.global_cleanup },
+        { "curl_easy_init",      (void **)&lib.easy_init },
+        { "curl_easy_setopt",    (void **)&lib.easy_setopt },
+        { "curl_easy_perform",   (void **)&lib.easy_perform },
+        { "curl_easy_getinfo",   (void **)&lib.easy_getinfo },
+        { "curl_easy_strerror",  (void **)&lib.easy_strerror },
+        { "curl_easy_escape",    (void **)&lib.easy_escape },
+        { "curl_easy_cleanup",   (void **)&lib.easy_cleanup },
+        { "curl_free",           (void **)&lib.free },
+        { "curl_share_init",     (void **)&lib.share_init },
+        { "curl_share_setopt",   (void **)&lib.share_setopt },
+        { "curl_share_cleanup",  (void **)&lib.share_cleanup },
+        { "curl_slist_append",   (void **)&lib.slist_append },
+        { "curl_slist_free_all", (void **)&lib.slist_free_all },
+    };
+    for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+        *symbols[i].slot = dlsym(lib.handle, symbols[i].name);
+        if (!*symbols[i].slot) {
+            if (g_debug) {
+                fprintf(stderr, "libcurl 缺少符号: %s\n", symbols[i].name);
+            }
+            return false;
+        }
+    }
+    
+    // curl_multi_poll 需要 7.66，更早的版本用参数相同的 curl_multi_wait
+    const struct {
+        const char *name;
+        void **slot;
+    } optional[] = {
+        { "curl_multi_init",          (void **)&lib.multi_init },
+        { "curl_multi_add_handle",    (void **)&lib.multi_add_handle },
+        { "curl_multi_remove_handle", (void **)&lib.multi_remove_handle },
+        { "curl_multi_perform",       (void **)&lib.multi_perform },
+        { "curl_multi_poll",          (void **)&lib.multi_poll },
+        { "curl_multi_info_read",     (void **)&lib.multi_info_read },
+        { "curl_multi_cleanup",       (void **)&lib.multi_cleanup },
+    };
+    bool multi = true;
+    for (size_t i = 0; i < sizeof(optional) / sizeof(optional[0]); i++) {
+        *optional[i].slot = dlsym(lib.handle, optional[i].name);
+        if (!*optional[i].slot && optional[i].slot == (void **)&lib.multi_poll) {
+            *optional[i].slot = dlsym(lib.handle, "curl_multi_wait");
+        }
+        if (!*optional[i].slot) multi = false;
+    }
+    if (!multi) lib.multi_init = NULL;
+    return true;
+}
+
+static void curl_init_once(void) {
+    if (!load_libcurl()) return;
+    if (lib.global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) return;
+    
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share_locks[i], NULL);
+    }
+    curl_share = lib.share_init();
+    if (curl_share) {
+        lib.share_setopt(curl_share, CURLSHOPT_LOCKFUNC, share_lock);
+        lib.share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        lib.share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        lib.share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        lib.share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+    curl_ready = true;
+}
+
+// 获取当前线程的 curl handle（按需创建）
+static CURL* api_handle(void) {
+    if (!curl_handle) {
+        pthread_once(&curl_once, curl_init_once);
+        if (!curl_ready) return NULL;
+        curl_handle = lib.easy_init();
+        if (curl_handle && curl_share) {
+            lib.easy_setopt(curl_handle, CURLOPT_SHARE, curl_share);
+        }
+    }
+    return curl_handle;
+}
+
+// 只记录配置；libcurl 在第一次请求时初始化
 int api_init(Config *config) {
     if (!config) return -1;
     api_config = config;
+    return 0;
+}
+
+// 将 JSON 对象编码为 application/x-www-form-urlencoded
+static char* encode_form(CURL *curl, cJSON *data) {
+    size_t cap = 256, len = 0;
+    char *out = malloc(cap);
+    if (!out) return NULL;
+    out[0] = '\0';
+    
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        char numbuf[64];
+        const char *value = NULL;
+        
+        if (cJSON_IsString(item)) {
+            value = item->valuestring;
+        } else if (cJSON_IsBool(item)) {
+            value = cJSON_IsTrue(item) ? "1" : "0";
+        } else if (cJSON_IsNumber(item)) {
+            if (item->valuedouble == (double)(long long)item->valuedouble) {
+                snprintf(numbuf, sizeof(numbuf), "%lld", (long long)item->valuedouble);
+            } else {
+                snprintf(numbuf, sizeof(numbuf), "%g", item->valuedouble);
+            }
+            value = numbuf;
+        } else {
+            continue;
+        }
+        
+        char *k = lib.easy_escape(curl, item->string, 0);
+        char *v = lib.easy_escape(curl, value, 0);
+        if (!k || !v) {
+            lib.free(k);
+            lib.free(v);
+            free(out);
+            return NULL;
+        }
+        
+        size_t need = len + strlen(k) + strlen(v) + 3;
+        if (need > cap) {
+            while (cap < need) cap *= 2;
+            char *p = realloc(out, cap);
+            if (!p) {
+                lib.free(k);
+                lib.free(v);
+                free(out);
+                return NULL;
+            }
+            out = p;
+        }
+        len += (size_t)sprintf(out + len, "%s%s=%s", len ? "&" : "", k, v);
+        
+        lib.free(k);
+        lib.free(v);
+    }
     
-    // 初始化 libcurl
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl_handle = curl_easy_init();
+    return out;
+}
+
+// 自适应并发控制（AIMD）：所有请求都按目标 API 地址限制同时在途的数量。
+// 窗口从 AIMD_INITIAL 起步，延迟平稳且窗口用满时增大（先翻倍，出现过拥塞后每轮 +1），
+// 遇到 503、超时或延迟突增时减半。pveproxy 只有少数几个 worker，
+// 并发超过它能承受的程度只会让所有请求一起变慢；--parallel 只是上限
+
+typedef enum {
+    SIGNAL_NONE,            // 不影响窗口（业务错误、被对冲取代、guest agent 请求）
+    SIGNAL_OK,
+    SIGNAL_CONGESTED,
+} LoadSignal;
+
+typedef struct {
+    HostConcurrency stats;
+    double ssthresh;        // 慢启动阈值
+    double last_cut;        // 上次减小窗口的时间，之前发出的请求不再触发减小
+} HostLimit;
+
+static HostLimit host_limits[AIMD_HOSTS];
+static int host_limit_count = 0;
+static pthread_mutex_t limit_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t limit_cond = PTHREAD_COND_INITIALIZER;
+
+// 查找或登记地址（调用方持有锁）；槽位用尽时新地址共享最后一个槽
+static HostLimit* host_limit(const char *host, int port) {
+    char key[sizeof(host_limits[0].stats.host)];
+    snprintf(key, sizeof(key), "%s:%d", host, port);
     
-    if (!curl_handle) {
-        fprintf(stderr, "错误：libcurl 初始化失败\n");
-        return -1;
+    for (int i = 0; i < host_limit_count; i++) {
+        if (strcmp(host_limits[i].stats.host, key) == 0) return &host_limits[i];
+    }
+    if (host_limit_count >= AIMD_HOSTS) return &host_limits[AIMD_HOSTS - 1];
+    
+    HostLimit *hl = &host_limits[host_limit_count++];
+    memset(hl, 0, sizeof(*hl));
+    snprintf(hl->stats.host, sizeof(hl->stats.host), "%s", key);
+    hl->stats.window = AIMD_INITIAL;
+    hl->ssthresh = AIMD_MAX;
+    return hl;
+}
+
+// 占用一个并发槽；wait 为 false 时窗口已满直接返回 NULL。
+// *full 表示这个请求用满了窗口，只有这样的请求成功才能增大窗口
+static HostLimit* host_limit_acquire(const char *host, int port, bool wait, bool *full) {
+    pthread_mutex_lock(&limit_lock);
+    HostLimit *hl = host_limit(host, port);
+    if (hl->stats.inflight >= (int)hl->stats.window) {
+        if (!wait) {
+            pthread_mutex_unlock(&limit_lock);
+            return NULL;
+        }
+        hl->stats.waits++;
+        while (hl->stats.inflight >= (int)hl->stats.window) {
+            pthread_cond_wait(&limit_cond, &limit_lock);
+        }
     }
+    hl->stats.inflight++;
+    hl->stats.requests++;
+    if (hl->stats.inflight > hl->stats.max_inflight) hl->stats.max_inflight = hl->stats.inflight;
+    *full = hl->stats.inflight >= (int)hl->stats.window;
+    pthread_mutex_unlock(&limit_lock);
+    return hl;
+}
+
+static void host_limit_release(HostLimit *hl, double started, bool full, LoadSignal signal) {
+    if (!hl) return;
+    
+    pthread_mutex_lock(&limit_lock);
+    hl->stats.inflight--;
+    HostConcurrency *st = &hl->stats;
+    if (signal == SIGNAL_CONGESTED && started > hl->last_cut) {
+        hl->ssthresh = st->window / 2 > 1 ? st->window / 2 : 1;
+        st->window = hl->ssthresh;
+        hl->last_cut = now_monotonic();
+        st->cuts++;
+        if (g_debug) {
+            fprintf(stderr, "并发 %s: 拥塞，窗口减小到 %.1f\n", st->host, st->window);
+        }
+    } else if (signal == SIGNAL_OK && full) {
+        st->window += st->window < hl->ssthresh ? 1 : 1 / st->window;
+        if (st->window > AIMD_MAX) st->window = AIMD_MAX;
+    }
+    pthread_cond_broadcast(&limit_cond);
+    pthread_mutex_unlock(&limit_lock);
+}
+
+// 返回实际登记的地址数
+int api_concurrency_stats(HostConcurrency *stats, int max) {
+    pthread_mutex_lock(&limit_lock);
+    int n = host_limit_count < max ? host_limit_count : max;
+    for (int i = 0; i < n; i++) {
+        stats[i] = host_limits[i].stats;
+    }
+    pthread_mutex_unlock(&limit_lock);
+    return n;
+}
+
+// 对冲读取：幂等 GET 超过同类请求的 p95 仍未返回时，再发一份相同的请求
+// （优先发往集群中的其他节点），哪个先完成用哪个。pveproxy 只有少数几个 worker，
+// 个别请求排在慢请求后面时，对冲可以去掉大批量读取的长尾
+
+// 一类请求的最近延迟样本（毫秒），按端点去掉节点名、VMID 等之后归类，
+// 非 GET 请求的键带上方法名。baseline 供并发控制判断延迟是否突增
+typedef struct {
+    char key[112];
+    double samples[HEDGE_WINDOW];
+    int count;
+    int next;
+    double baseline;        // 近期最低延迟，缓慢向上漂移以适应变慢的服务器
+} LatencyClass;
+
+// 集群中其他节点的 API 地址（来自 /cluster/status），每个集群一份
+typedef struct {
+    const Config *config;
+    char hosts[HEDGE_MAX_HOSTS][64];
+    bool failed[HEDGE_MAX_HOSTS];   // 连不上的地址之后不再使用
+    int count;
+    int next;
+    int state;                      // 0 未加载，1 加载中，2 已加载
+} HedgeHosts;
+
+static LatencyClass latency_classes[HEDGE_CLASSES];
+static HedgeHosts hedge_hosts[MAX_CLUSTERS + 1];
+static int hedge_hosts_count = 0;
+static HedgeStats hedge_stats;
+static pthread_mutex_t hedge_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local bool hedge_suppressed = false;    // 加载节点地址的请求本身不对冲
+
+// 端点归类：去掉查询参数，nodes/ 和 tasks/ 之后的一段换成 *，纯数字的段换成 #
+static void endpoint_class(const char *endpoint, char *out, size_t len) {
+    size_t n = 0;
+    const char *p = endpoint;
+    const char *prev = NULL;
+    size_t prev_len = 0;
+    
+    while (*p && *p != '?' && n + 2 < len) {
+        if (*p == '/') {
+            out[n++] = *p++;
+            continue;
+        }
+        size_t seg = strcspn(p, "/?");
+        bool digits = true;
+        for (size_t i = 0; i < seg; i++) {
+            if (p[i] < '0' || p[i] > '9') digits = false;
+        }
+        
+        if (prev && ((prev_len == 5 && strncmp(prev, "nodes", 5) == 0) ||
+                     (prev_len == 5 && strncmp(prev, "tasks", 5) == 0))) {
+            out[n++] = '*';
+        } else if (digits) {
+            out[n++] = '#';
+        } else {
+            size_t copy = seg < len - n - 1 ? seg : len - n - 1;
+            memcpy(out + n, p, copy);
+            n += copy;
+        }
+        prev = p;
+        prev_len = seg;
+        p += seg;
+    }
+    out[n] = '\0';
+}
+
+// 调用方持有 hedge_lock；create 为 false 时找不到返回 NULL
+static LatencyClass* latency_class(const char *key, bool create) {
+    unsigned h = 2166136261u;
+    for (const char *p = key; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+    for (int i = 0; i < HEDGE_CLASSES; i++) {
+        LatencyClass *c = &latency_classes[(h + (unsigned)i) % HEDGE_CLASSES];
+        if (c->key[0] == '\0') {
+            if (!create) return NULL;
+            snprintf(c->key, sizeof(c->key), "%s", key);
+            return c;
+        }
+        if (strcmp(c->key, key) == 0) return c;
+    }
+    return NULL;
+}
+
+// 记录一个样本，返回记录之前的基线；第一个样本返回 -1
+static double latency_record(const char *key, double ms) {
+    double baseline = -1;
+    pthread_mutex_lock(&hedge_lock);
+    LatencyClass *c = latency_class(key, true);
+    if (c) {
+        baseline = c->count > 0 ? c->baseline : -1;
+        if (c->count == 0 || ms < c->baseline) {
+            c->baseline = ms;
+        } else {
+            c->baseline += (ms - c->baseline) * 0.01;
+        }
+        c->samples[c->next] = ms;
+        c->next = (c->next + 1) % HEDGE_WINDOW;
+        if (c->count < HEDGE_WINDOW) c->count++;
+    }
+    pthread_mutex_unlock(&hedge_lock);
+    return baseline;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// 返回这类请求应在多少毫秒后对冲；样本不足时返回 -1
+static double hedge_delay(const char *key) {
+    double delay = -1;
+    pthread_mutex_lock(&hedge_lock);
+    LatencyClass *c = latency_class(key, false);
+    if (c && c->count >= HEDGE_MIN_SAMPLES) {
+        double sorted[HEDGE_WINDOW];
+        memcpy(sorted, c->samples, sizeof(double) * (size_t)c->count);
+        qsort(sorted, (size_t)c->count, sizeof(double), cmp_double);
+        delay = sorted[(c->count * 95 + 99) / 100 - 1];
+        if (delay < HEDGE_MIN_DELAY_MS) delay = HEDGE_MIN_DELAY_MS;
+        hedge_stats.eligible++;
+    }
+    pthread_mutex_unlock(&hedge_lock);
+    return delay;
+}
+
+// 预算内才允许发出对冲请求
+static bool hedge_acquire(void) {
+    pthread_mutex_lock(&hedge_lock);
+    bool ok = hedge_stats.hedged < hedge_stats.eligible * HEDGE_BUDGET_PCT / 100 + HEDGE_BURST;
+    if (ok) {
+        hedge_stats.hedged++;
+    } else {
+        hedge_stats.denied++;
+    }
+    pthread_mutex_unlock(&hedge_lock);
+    return ok;
+}
+
+static HedgeHosts* hedge_hosts_for(const Config *config) {
+    HedgeHosts *hosts = NULL;
+    pthread_mutex_lock(&hedge_lock);
+    for (int i = 0; i < hedge_hosts_count; i++) {
+        if (hedge_hosts[i].config == config) {
+            hosts = &hedge_hosts[i];
+            break;
+        }
+    }
+    if (!hosts && hedge_hosts_count < MAX_CLUSTERS + 1) {
+        hosts = &hedge_hosts[hedge_hosts_count++];
+        memset(hosts, 0, sizeof(*hosts));
+        hosts->config = config;
+    }
+    bool load = hosts && hosts->state == 0;
+    if (load) hosts->state = 1;
+    pthread_mutex_unlock(&hedge_lock);
+    if (!load) return hosts;
+    
+    // 除当前连接的节点外，其他在线节点的 IP；加载失败时对冲请求发往同一地址
+    char found[HEDGE_MAX_HOSTS][64];
+    int count = 0;
+    hedge_suppressed = true;
+    cJSON *response = api_get("/api2/json/cluster/status");
+    hedge_suppressed = false;
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        if (count >= HEDGE_MAX_HOSTS) break;
+        const char *type = json_get_string(item, "type", "");
+        const char *ip = json_get_string(item, "ip", "");
+        if (strcmp(type, "node") != 0 || !ip[0]) continue;
+        if (json_get_int(item, "local", 0) || !json_get_int(item, "online", 0)) continue;
+        snprintf(found[count++], sizeof(found[0]), "%s", ip);
+    }
+    cJSON_Delete(response);
     
-    return 0;
+    pthread_mutex_lock(&hedge_lock);
+    memcpy(hosts->hosts, found, sizeof(found));
+    hosts->count = count;
+    hosts->state = 2;
+    pthread_mutex_unlock(&hedge_lock);
+    if (g_debug) {
+        fprintf(stderr, "对冲请求可用的其他节点: %d 个\n", count);
+    }
+    return hosts;
 }
 
-// 执行 HTTP GET 请求并返回 JSON
-cJSON* api_get(const char *endpoint) {
-    if (!api_config || !endpoint || !curl_handle) return NULL;
+// 轮流选择其他节点，返回下标；没有可用节点时返回 -1（发往配置的地址）
+static int hedge_pick_host(HedgeHosts *hosts, char *host, size_t len) {
+    int picked = -1;
+    pthread_mutex_lock(&hedge_lock);
+    if (hosts && hosts->state == 2) {
+        for (int i = 0; i < hosts->count; i++) {
+            int k = (hosts->next + i) % hosts->count;
+            if (hosts->failed[k]) continue;
+            picked = k;
+            hosts->next = k + 1;
+            // IPv6 地址在 URL 中需要方括号
+            snprintf(host, len, strchr(hosts->hosts[k], ':') ? "[%s]" : "%s", hosts->hosts[k]);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&hedge_lock);
+    return picked;
+}
+
+// 按请求配置 handle（handle 会被复用，每次都需重设请求方法）
+static void setup_request(CURL *curl, const char *method, const char *url, struct curl_slist *headers,
+                          cJSON *data, struct MemoryStruct *chunk, char *reason, long timeout) {
+    lib.easy_setopt(curl, CURLOPT_URL, url);
+    lib.easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    lib.easy_setopt(curl, CURLOPT_CUSTOMREQUEST, NULL);
+    
+    bool has_body = (strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0);
+    if (has_body) {
+        char *body = data ? encode_form(curl, data) : NULL;
+        lib.easy_setopt(curl, CURLOPT_POST, 1L);
+        lib.easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, body ? body : "");
+        free(body);
+        if (strcmp(method, "PUT") == 0) {
+            lib.easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+        }
+    } else {
+        lib.easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        if (strcmp(method, "GET") != 0) {
+            lib.easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+        }
+    }
+    
+    lib.easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    lib.easy_setopt(curl, CURLOPT_WRITEDATA, (void *)chunk);
+    lib.easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    lib.easy_setopt(curl, CURLOPT_HEADERDATA, (void *)reason);
+    lib.easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    lib.easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    lib.easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+    lib.easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    lib.easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+}
+
+// 对冲执行已配置好的 GET：先只发主请求，delay_ms 后仍未完成且预算允许时
+// 用第二个 handle 发出相同请求。先成功的一方的响应写入 chunk 和 last_error，
+// 另一方被中止；*winner 为完成的 handle，*latency 为它自身的耗时（毫秒）
+static CURLcode perform_hedged(CURL *curl, const Config *config, HedgeHosts *hosts, const char *endpoint,
+                               struct curl_slist *headers, struct MemoryStruct *chunk, long timeout,
+                               double delay_ms, CURL **winner, double *latency) {
+    if (!hedge_multi) hedge_multi = lib.multi_init();
+    if (!hedge_handle) {
+        hedge_handle = lib.easy_init();
+        if (hedge_handle && curl_share) {
+            lib.easy_setopt(hedge_handle, CURLOPT_SHARE, curl_share);
+        }
+    }
+    double start = now_monotonic();
+    if (!hedge_multi || !hedge_handle ||
+        lib.multi_add_handle(hedge_multi, curl) != CURLM_OK) {
+        CURLcode res = lib.easy_perform(curl);
+        *latency = (now_monotonic() - start) * 1000;
+        return res;
+    }
+    
+    struct MemoryStruct hchunk = {0};
+    char hreason[sizeof(last_error)] = "";
+    int host_index = -1;
+    HostLimit *hedge_limit = NULL;
+    double hedge_start = 0;
+    bool primary_active = true, hedge_active = false, hedge_tried = false;
+    CURLcode primary_res = CURLE_OK;
+    CURLcode res = CURLE_OK;
+    bool hedge_won = false;
+    
+    for (;;) {
+        int running = 0;
+        lib.multi_perform(hedge_multi, &running);
+        
+        CURLMsg *msg;
+        int left;
+        bool finished = false;
+        while ((msg = lib.multi_info_read(hedge_multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL *done = msg->easy_handle;
+            CURLcode result = msg->data.result;
+            lib.multi_remove_handle(hedge_multi, done);
+            
+            if (done == curl) {
+                primary_active = false;
+                primary_res = result;
+                // 主请求有响应（包括错误响应）就采用；失败时还有对冲请求在途则继续等
+                if (result == CURLE_OK || !hedge_active) finished = true;
+            } else {
+                hedge_active = false;
+                long code = 0;
+                if (result == CURLE_OK) lib.easy_getinfo(done, CURLINFO_RESPONSE_CODE, &code);
+                if (result == CURLE_OK && code < 500) {
+                    hedge_won = true;
+                    finished = true;
+                } else {
+                    if (host_index >= 0 && (result == CURLE_COULDNT_CONNECT ||
+                                            result == CURLE_OPERATION_TIMEDOUT)) {
+                        pthread_mutex_lock(&hedge_lock);
+                        hosts->failed[host_index] = true;
+                        pthread_mutex_unlock(&hedge_lock);
+                    }
+                    if (!primary_active) finished = true;
+                }
+            }
+            if (finished) break;
+        }
+        if (finished) break;
+        
+        double elapsed = (now_monotonic() - start) * 1000;
+        if (!hedge_tried && primary_active && elapsed >= delay_ms) {
+            hedge_tried = true;
+            // 目标地址的并发窗口已满时不对冲，以免加重它的负载
+            char host[80];
+            host_index = hedge_pick_host(hosts, host, sizeof(host));
+            bool full;
+            hedge_limit = host_limit_acquire(host_index >= 0 ? host : config->host, config->port,
+                                             false, &full);
+            if (hedge_limit && !hedge_acquire()) {
+                host_limit_release(hedge_limit, 0, false, SIGNAL_NONE);
+                hedge_limit = NULL;
+            }
+            if (hedge_limit) {
+                char url[1024];
+                snprintf(url, sizeof(url), "https://%s:%d%s",
+                         host_index >= 0 ? host : config->host, config->port, endpoint);
+                hchunk.memory = malloc(1);
+                hchunk.size = 0;
+                if (hchunk.memory) hchunk.memory[0] = '\0';
+                setup_request(hedge_handle, "GET", url, headers, NULL, &hchunk, hreason, timeout);
+                if (lib.multi_add_handle(hedge_multi, hedge_handle) == CURLM_OK) {
+                    hedge_active = true;
+                    hedge_start = now_monotonic();
+                    if (g_debug) {
+                        fprintf(stderr, "对冲 GET %s (%.0fms 未返回) -> %s\n", endpoint, elapsed,
+                                host_index >= 0 ? host : config->host);
+                    }
+                }
+            }
+        }
+        
+        int wait_ms = 1000;
+        if (!hedge_tried) {
+            wait_ms = (int)(delay_ms - elapsed) + 1;
+            if (wait_ms < 1) wait_ms = 1;
+        }
+        lib.multi_poll(hedge_multi, NULL, 0, wait_ms, NULL);
+    }
+    
+    // 中止另一方：移出 multi 会关闭它的连接
+    if (primary_active) lib.multi_remove_handle(hedge_multi, curl);
+    if (hedge_active) lib.multi_remove_handle(hedge_multi, hedge_handle);
+    host_limit_release(hedge_limit, 0, false, SIGNAL_NONE);
+    
+    if (hedge_won) {
+        free(chunk->memory);
+        *chunk = hchunk;
+        snprintf(last_error, sizeof(last_error), "%s", hreason);
+        *winner = hedge_handle;
+        *latency = (now_monotonic() - hedge_start) * 1000;
+        pthread_mutex_lock(&hedge_lock);
+        hedge_stats.wins++;
+        pthread_mutex_unlock(&hedge_lock);
+        res = CURLE_OK;
+    } else {
+        free(hchunk.memory);
+        *winner = curl;
+        *latency = (now_monotonic() - start) * 1000;
+        res = primary_res;
+    }
+    return res;
+}
+
+void api_hedge_stats(HedgeStats *stats) {
+    pthread_mutex_lock(&hedge_lock);
+    *stats = hedge_stats;
+    pthread_mutex_unlock(&hedge_lock);
+}
+
+// 执行一次 HTTP 请求；返回值为 curl 结果，响应体写入 chunk
+static CURLcode api_perform(const char *method, const char *endpoint, cJSON *data,
+                            struct MemoryStruct *chunk, long timeout) {
+    CURL *curl = api_handle();
+    Config *config = current_config();
+    
+    // 按端点类别记录延迟，非 GET 的类别带上方法名；
+    // 对冲只用于 GET，需要 --hedge 且样本足够（可能先加载其他节点的地址）
+    bool is_get = strcmp(method, "GET") == 0;
+    char cls[112] = "";
+    double hedge_after = -1;
+    HedgeHosts *hosts = NULL;
+    if (endpoint) {
+        int n = is_get ? 0 : snprintf(cls, sizeof(cls), "%s ", method);
+        endpoint_class(endpoint, cls + n, sizeof(cls) - (size_t)n);
+    }
+    if (is_get && endpoint) {
+        if (g_hedge && !hedge_suppressed && curl && lib.multi_init && config) {
+            hedge_after = hedge_delay(cls);
+        }
+        // 加载地址会用到本线程的 handle，必须在配置本次请求之前
+        if (hedge_after >= 0) hosts = hedge_hosts_for(config);
+    }
+    
+    last_http_code = 0;
+    last_error[0] = '\0';
+    if (!curl) {
+        snprintf(last_error, sizeof(last_error), lib.handle ? "libcurl 初始化失败" : "无法加载 libcurl");
+        return CURLE_FAILED_INIT;
+    }
+    if (!config || !endpoint) return CURLE_FAILED_INIT;
+    
+    // 构建认证头：API token，或登录票据（修改类请求还需要 CSRF token）；
+    // 取票据可能先发出登录请求，同样必须在配置本次请求之前
+    char auth_header[AUTH_TICKET_LEN + 64] = "";
+    char csrf_header[AUTH_CSRF_LEN + 64] = "";
+    if (login_request) {
+        // 登录请求不需要认证
+    } else if (auth_uses_ticket(config)) {
+        char ticket[AUTH_TICKET_LEN], csrf[AUTH_CSRF_LEN], error[sizeof(last_error)];
+        if (auth_ticket(config, ticket, sizeof(ticket), csrf, sizeof(csrf), error, sizeof(error)) != 0) {
+            last_http_code = 0;
+            snprintf(last_error, sizeof(last_error), "%s", error);
+            return CURLE_LOGIN_DENIED;
+        }
+        snprintf(auth_header, sizeof(auth_header), "Cookie: PVEAuthCookie=%s", ticket);
+        if (!is_get) {
+            snprintf(csrf_header, sizeof(csrf_header), "CSRFPreventionToken: %s", csrf);
+        }
+        last_http_code = 0;
+        last_error[0] = '\0';
+    } else {
+        snprintf(auth_header, sizeof(auth_header),
+                 "Authorization: PVEAPIToken=%s=%s",
+                 config->token_id, config->token_secret);
+    }
     
     // 构建 URL
     char url[1024];
     snprintf(url, sizeof(url), "https://%s:%d%s",
-             api_config->host, api_config->port, endpoint);
-    
-    // 构建认证头
-    char auth_header[1024];
-    snprintf(auth_header, sizeof(auth_header),
-             "Authorization: PVEAPIToken=%s=%s",
-             api_config->token_id, api_config->token_secret);
+             config->host, config->port, endpoint);
     
     if (g_debug) {
-        fprintf(stderr, "API GET: %s\n", endpoint);
+        fprintf(stderr, "API %s: %s\n", method, endpoint);
     }
     
     // 设置 HTTP 头
     struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
+    if (auth_header[0]) headers = lib.slist_append(headers, auth_header);
+    if (csrf_header[0]) headers = lib.slist_append(headers, csrf_header);
     
     // 准备接收数据
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-    
-    // 配置 curl
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 30L);
-    
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl_handle);
+    chunk->memory = malloc(1);
+    chunk->size = 0;
+    if (chunk->memory) chunk->memory[0] = '\0';
+    
+    setup_request(curl, method, url, headers, data, chunk, last_error, timeout);
+    
+    // 执行请求（等待并发窗口的时间不计入延迟）
+    bool full;
+    HostLimit *limit = host_limit_acquire(config->host, config->port, true, &full);
+    double started = now_monotonic();
+    CURL *done = curl;
+    double latency;
+    CURLcode res;
+    if (hedge_after >= 0) {
+        res = perform_hedged(curl, config, hosts, endpoint, headers, chunk, timeout, hedge_after,
+                             &done, &latency);
+    } else {
+        double start = now_monotonic();
+        res = lib.easy_perform(curl);
+        latency = (now_monotonic() - start) * 1000;
+    }
     
-    cJSON *json = NULL;
+    // guest agent 的超时和延迟取决于虚拟机，不反映 pveproxy 的负载
+    bool agent = strstr(endpoint, "/agent/") != NULL;
+    LoadSignal signal = SIGNAL_NONE;
     if (res != CURLE_OK) {
+        snprintf(last_error, sizeof(last_error), "%s", lib.easy_strerror(res));
         if (g_debug) {
-            fprintf(stderr, "curl_easy_perform() 失败: %s\n", curl_easy_strerror(res));
+            fprintf(stderr, "curl_easy_perform() 失败: %s\n", lib.easy_strerror(res));
         }
+        if (res == CURLE_OPERATION_TIMEDOUT && !agent) signal = SIGNAL_CONGESTED;
     } else {
+        lib.easy_getinfo(done, CURLINFO_RESPONSE_CODE, &last_http_code);
+        if (last_http_code == 503) {
+            signal = SIGNAL_CONGESTED;
+        } else if (last_http_code >= 200 && last_http_code < 300) {
+            double baseline = latency_record(cls, latency);
+            if (!agent && done == curl) {
+                bool spike = baseline >= 0 && latency > baseline * AIMD_SPIKE &&
+                             latency - baseline > AIMD_SPIKE_MIN_MS;
+                signal = spike ? SIGNAL_CONGESTED : SIGNAL_OK;
+            }
+        }
+    }
+    host_limit_release(limit, started, full, signal);
+    
+    // 修改类请求成功后，该集群缓存的 GET 响应可能已过期
+    if (g_cache_ttl > 0 && !is_get && !login_request &&
+        last_http_code >= 200 && last_http_code < 300) {
+        cache_invalidate(config);
+    }
+    
+    lib.slist_free_all(headers);
+    return res;
+}
+
+// 失败的类型决定能否重试
+typedef enum {
+    FAIL_NONE,              // 成功，或不可重试的错误（4xx、PVE 返回的业务错误）
+    FAIL_NOT_SENT,          // 请求没有被服务器处理，任何请求都可以重试
+    FAIL_TRANSIENT,         // 请求可能已被处理：连接中断、超时、代理错误
+} FailureKind;
+
+// 重试策略：幂等请求任何暂时性失败都重试；非幂等请求只在确定未处理时重试，
+// 提供 applied 时先检查操作是否已经生效，未生效才重试
+typedef struct {
+    bool idempotent;
+    bool (*applied)(void *arg);
+    void *arg;
+} RetryPolicy;
+
+static RetryStats retry_stats;
+static pthread_mutex_t retry_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local unsigned retry_seed = 0;
+
+static FailureKind classify_failure(CURLcode res, long http_code, const char *reason) {
+    switch (res) {
+        case CURLE_OK:
+            break;
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_SSL_CONNECT_ERROR:
+            return FAIL_NOT_SENT;
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+            return FAIL_TRANSIENT;
+        default:
+            // 包括超时：等满超时的请求说明服务器已经很慢（或 guest agent 无响应），重试只会加重负载
+            return FAIL_NONE;
+    }
+    
+    switch (http_code) {
+        case 503:               // pveproxy 没有空闲 worker，请求未执行
+            return FAIL_NOT_SENT;
+        case 502:
+        case 504:
+        case 595:               // pveproxy 转发到其他节点失败
+        case 596:
+        case 599:
+            return FAIL_TRANSIENT;
+        case 500:
+            // PVE 的业务错误也是 500，只把没有具体原因或明显是超时/连接问题的当作暂时性失败
+            if (!reason[0] || strcmp(reason, "Internal Server Error") == 0 ||
+                strstr(reason, "timeout") || strstr(reason, "timed out") ||
+                strstr(reason, "Connection refused") || strstr(reason, "Connection reset")) {
+                return FAIL_TRANSIENT;
+            }
+            return FAIL_NONE;
+        default:
+            return FAIL_NONE;
+    }
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+// 带重试的 api_perform：指数退避加完全随机抖动，总时长不超过 RETRY_DEADLINE；
+// applied 确认操作已生效时 *applied 置为 true 并停止重试
+static CURLcode api_perform_retry(const char *method, const char *endpoint, cJSON *data,
+                                  struct MemoryStruct *chunk, long timeout,
+                                  const RetryPolicy *policy, bool *applied) {
+    if (applied) *applied = false;
+    if (retry_seed == 0) {
+        retry_seed = (unsigned)(now_monotonic() * 1e6) ^ (unsigned)(uintptr_t)&retry_seed;
+    }
+    
+    double deadline = now_monotonic() + RETRY_DEADLINE;
+    CURLcode res;
+    int attempt = 1;
+    bool recovered = false;
+    bool relogin = false;
+    for (;; attempt++) {
+        res = api_perform(method, endpoint, data, chunk, timeout);
+        
+        // 票据被服务器拒绝（已吊销，或缓存的票据来自时间不一致的机器）时重新登录一次
+        Config *config = current_config();
+        if (res == CURLE_OK && last_http_code == 401 && !relogin && !login_request &&
+            auth_uses_ticket(config)) {
+            relogin = true;
+            auth_invalidate(config);
+            free(chunk->memory);
+            chunk->memory = NULL;
+            chunk->size = 0;
+            attempt--;      // 重新登录不计入重试次数
+            continue;
+        }
+        
+        FailureKind kind = classify_failure(res, last_http_code, last_error);
+        if (kind == FAIL_NONE) {
+            recovered = attempt > 1;
+            break;
+        }
+        if (attempt >= RETRY_MAX_ATTEMPTS) break;
+        
+        if (kind == FAIL_TRANSIENT && !policy->idempotent) {
+            if (!policy->applied) break;
+            
+            // 检查会发出新的请求，保留这次失败的错误信息
+            char error[sizeof(last_error)];
+            long code = last_http_code;
+            snprintf(error, sizeof(error), "%s", last_error);
+            bool done = policy->applied(policy->arg);
+            last_http_code = code;
+            snprintf(last_error, sizeof(last_error), "%s", error);
+            if (done) {
+                if (applied) *applied = true;
+                recovered = true;
+                break;
+            }
+        }
+        
+        long cap = (long)RETRY_BASE_MS << (attempt - 1);
+        if (cap > RETRY_MAX_MS) cap = RETRY_MAX_MS;
+        long delay = (long)(rand_r(&retry_seed) % (unsigned)(cap + 1));
+        if (now_monotonic() + delay / 1000.0 >= deadline) break;
+        
+        if (g_debug) {
+            fprintf(stderr, "重试 %s %s (第 %d 次, %ldms 后): %s\n", method, endpoint, attempt,
+                    delay, last_error[0] ? last_error : "无响应");
+        }
+        free(chunk->memory);
+        chunk->memory = NULL;
+        chunk->size = 0;
+        sleep_ms(delay);
+    }
+    
+    pthread_mutex_lock(&retry_lock);
+    retry_stats.requests++;
+    retry_stats.retries += attempt - 1;
+    if (recovered) {
+        retry_stats.recovered++;
+    } else if (attempt > 1) {
+        retry_stats.exhausted++;
+    }
+    pthread_mutex_unlock(&retry_lock);
+    
+    return res;
+}
+
+void api_retry_stats(RetryStats *stats) {
+    pthread_mutex_lock(&retry_lock);
+    *stats = retry_stats;
+    pthread_mutex_unlock(&retry_lock);
+}
+
+// 执行请求并解析 JSON 响应（非 2xx 响应体同样会被解析返回）
+static cJSON* api_request(const char *method, const char *endpoint, cJSON *data, long timeout) {
+    struct MemoryStruct chunk = {0};
+    RetryPolicy policy = { .idempotent = strcmp(method, "GET") == 0 };
+    CURLcode res = api_perform_retry(method, endpoint, data, &chunk, timeout, &policy, NULL);
+    
+    cJSON *json = NULL;
+    if (res == CURLE_OK && chunk.memory) {
         json = cJSON_Parse(chunk.memory);
         if (!json && g_debug) {
             fprintf(stderr, "JSON 解析失败: %s\n", chunk.memory);
         }
     }
     
-    free(chunk.memory);
-    curl_slist_free_all(headers);
-    
-    return json;
+    free(chunk.memory);
+    return json;
+}
+
+// 可缓存的 GET：只有 list/status 传入 ttl，ttl 为 0 时等同于 api_request。
+// 节点映射和其他命令据此规划、路由，必须直接请求
+static cJSON* api_get_cached(const char *endpoint, long timeout, int ttl) {
+    Config *config = current_config();
+    
+    char *body = cache_read(config, endpoint, ttl);
+    if (body) {
+        cJSON *json = cJSON_Parse(body);
+        free(body);
+        if (json) {
+            last_http_code = 200;
+            last_error[0] = '\0';
+            return json;
+        }
+    }
+    
+    struct MemoryStruct chunk = {0};
+    RetryPolicy policy = { .idempotent = true };
+    CURLcode res = api_perform_retry("GET", endpoint, NULL, &chunk, timeout, &policy, NULL);
+    
+    cJSON *json = NULL;
+    if (res == CURLE_OK && chunk.memory) {
+        json = cJSON_Parse(chunk.memory);
+        if (json && ttl > 0 && last_http_code >= 200 && last_http_code < 300) {
+            cache_write(config, endpoint, chunk.memory, chunk.size);
+        }
+    }
+    
+    free(chunk.memory);
+    return json;
+}
+
+// 执行 HTTP GET 请求并返回 JSON
+cJSON* api_get(const char *endpoint) {
+    return api_request("GET", endpoint, NULL, API_TIMEOUT);
+}
+
+cJSON* api_post(const char *endpoint, cJSON *data) {
+    return api_request("POST", endpoint, data, API_TIMEOUT);
+}
+
+cJSON* api_put(const char *endpoint, cJSON *data) {
+    return api_request("PUT", endpoint, data, API_TIMEOUT);
+}
+
+cJSON* api_delete(const char *endpoint) {
+    return api_request("DELETE", endpoint, NULL, API_TIMEOUT);
+}
+
+// 用密码（或仍有效的票据，即续期）换取新的登录票据和 CSRF token
+int api_login(const char *username, const char *password, char *ticket, size_t ticket_len,
+              char *csrf, size_t csrf_len) {
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddStringToObject(body, "username", username);
+    cJSON_AddStringToObject(body, "password", password);
+    // 用户名不带 @realm 时按 PAM 用户登录
+    if (!strchr(username, '@')) {
+        cJSON_AddStringToObject(body, "realm", "pam");
+    }
+    
+    login_request = true;
+    cJSON *response = api_request("POST", "/api2/json/access/ticket", body, API_TIMEOUT);
+    login_request = false;
+    cJSON_Delete(body);
+    
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    const char *t = json_get_string(data, "ticket", NULL);
+    const char *c = json_get_string(data, "CSRFPreventionToken", NULL);
+    int ret = -1;
+    if (last_http_code < 200 || last_http_code >= 300 || !t || !c) {
+        if (last_error[0] == '\0') {
+            snprintf(last_error, sizeof(last_error), "HTTP %ld", last_http_code);
+        }
+    } else if (json_get_int(data, "NeedTFA", 0)) {
+        snprintf(last_error, sizeof(last_error), "账户启用了双因素认证，请改用 API Token");
+    } else if (strlen(t) >= ticket_len || strlen(c) >= csrf_len) {
+        snprintf(last_error, sizeof(last_error), "票据过长");
+    } else {
+        snprintf(ticket, ticket_len, "%s", t);
+        snprintf(csrf, csrf_len, "%s", c);
+        ret = 0;
+    }
+    
+    cJSON_Delete(response);
+    return ret;
+}
+
+long api_last_http_code(void) {
+    return last_http_code;
+}
+
+const char* api_last_error(void) {
+    return last_error;
+}
+
+// 从响应中取出任务 ID（UPID），失败时返回 -1 并尽量填充错误信息
+int api_response_upid(cJSON *response, char *upid, size_t len) {
+    if (upid && len > 0) upid[0] = '\0';
+    
+    if (!response || last_http_code < 200 || last_http_code >= 300) {
+        if (last_error[0] == '\0') {
+            snprintf(last_error, sizeof(last_error), "HTTP %ld", last_http_code);
+        }
+        return -1;
+    }
+    
+    cJSON *errors = cJSON_GetObjectItem(response, "errors");
+    if (errors && cJSON_IsObject(errors)) {
+        cJSON *first = errors->child;
+        snprintf(last_error, sizeof(last_error), "%s: %s",
+                 first && first->string ? first->string : "errors",
+                 first && cJSON_IsString(first) ? first->valuestring : "invalid parameter");
+        return -1;
+    }
+    
+    const char *data = cJSON_GetStringValue(cJSON_GetObjectItem(response, "data"));
+    if (data && upid && len > 0) {
+        snprintf(upid, len, "%s", data);
+    }
+    return 0;
+}
+
+// 从 UPID 中解析节点名 (UPID:node:pid:pstart:starttime:type:id:user:)
+static int upid_node(const char *upid, char *node, size_t len) {
+    if (strncmp(upid, "UPID:", 5) != 0) return -1;
+    const char *start = upid + 5;
+    const char *end = strchr(start, ':');
+    if (!end || (size_t)(end - start) >= len) return -1;
+    memcpy(node, start, (size_t)(end - start));
+    node[end - start] = '\0';
+    return 0;
+}
+
+// 等待任务结束；返回 0 表示成功，1 表示任务失败，-1 表示超时或查询失败
+int api_wait_task(const char *upid, int timeout_sec, char *exitstatus, size_t len) {
+    if (exitstatus && len > 0) exitstatus[0] = '\0';
+    if (!upid || upid[0] == '\0') return -1;
+    
+    char node[64];
+    if (upid_node(upid, node, sizeof(node)) != 0) return -1;
+    
+    char endpoint[512];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/tasks/%s/status", node, upid);
+    
+    // 轮询间隔从 200ms 起指数增长，上限 2s
+    long delay_ms = 200;
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    for (;;) {
+        cJSON *response = api_get(endpoint);
+        cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+        const char *status = json_get_string(data, "status", NULL);
+        
+        if (status && strcmp(status, "stopped") == 0) {
+            const char *code = json_get_string(data, "exitstatus", "unknown");
+            if (exitstatus && len > 0) snprintf(exitstatus, len, "%s", code);
+            bool ok = (strcmp(code, "OK") == 0 || strncmp(code, "WARNINGS", 8) == 0);
+            cJSON_Delete(response);
+            return ok ? 0 : 1;
+        }
+        cJSON_Delete(response);
+        
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (timeout_sec > 0 && now.tv_sec - start.tv_sec >= timeout_sec) {
+            if (exitstatus && len > 0) snprintf(exitstatus, len, "timeout");
+            return -1;
+        }
+        
+        struct timespec ts = { delay_ms / 1000, (delay_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+        if (delay_ms < 2000) delay_ms *= 2;
+        if (delay_ms > 2000) delay_ms = 2000;
+    }
+}
+
+// VMID -> 节点映射缓存（来自 /cluster/resources，按 VMID 排序），每个集群一份
+typedef struct {
+    int vmid;
+    char node[64];
+    bool qemu;              // LXC 容器只占用 VMID，不参与节点路由
+} NodeEntry;
+
+typedef struct {
+    const Config *config;
+    pthread_mutex_t lock;
+    NodeEntry *map;
+    int count;
+    bool loaded;
+} NodeCache;
+
+static NodeCache node_caches[MAX_CLUSTERS + 1];   // 集群配置 + 默认配置
+static int node_cache_count = 0;
+static pthread_mutex_t node_caches_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int cmp_node_entry(const void *a, const void *b) {
+    const NodeEntry *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+// 查找当前集群的缓存，不存在时登记；槽位用尽时最后一个槽轮换使用
+static NodeCache* node_cache(void) {
+    const Config *config = current_config();
+    
+    pthread_mutex_lock(&node_caches_lock);
+    NodeCache *cache = NULL;
+    for (int i = 0; i < node_cache_count; i++) {
+        if (node_caches[i].config == config) {
+            cache = &node_caches[i];
+            break;
+        }
+    }
+    if (!cache) {
+        if (node_cache_count <= MAX_CLUSTERS) {
+            cache = &node_caches[node_cache_count++];
+            pthread_mutex_init(&cache->lock, NULL);
+        } else {
+            cache = &node_caches[MAX_CLUSTERS];
+            pthread_mutex_lock(&cache->lock);
+            free(cache->map);
+            cache->map = NULL;
+            cache->count = 0;
+            cache->loaded = false;
+            pthread_mutex_unlock(&cache->lock);
+        }
+        cache->config = config;
+    }
+    pthread_mutex_unlock(&node_caches_lock);
+    
+    return cache;
 }
 
-cJSON* api_post(const char *endpoint, cJSON *data) {
-    (void)data;  // 未使用的参数，保留用于未来扩展
-    if (!api_config || !endpoint || !curl_handle) return NULL;
-    
-    // 构建 URL
-    char url[1024];
-    snprintf(url, sizeof(url), "https://%s:%d%s",
-             api_config->host, api_config->port, endpoint);
+// 加载集群中所有 VM 和容器所在节点（调用方持有 cache->lock）
+static int load_node_map(NodeCache *cache) {
+    cJSON *response = api_get("/api2/json/cluster/resources?type=vm");
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
     
-    // 构建认证头
-    char auth_header[1024];
-    snprintf(auth_header, sizeof(auth_header),
-             "Authorization: PVEAPIToken=%s=%s",
-             api_config->token_id, api_config->token_secret);
+    int n = cJSON_GetArraySize(data);
+    NodeEntry *map = calloc(n > 0 ? (size_t)n : 1, sizeof(NodeEntry));
+    if (!map) {
+        cJSON_Delete(response);
+        return -1;
+    }
     
-    if (g_debug) {
-        fprintf(stderr, "API POST: %s\n", endpoint);
+    int count = 0;
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        const char *type = json_get_string(item, "type", "");
+        const char *node = json_get_string(item, "node", NULL);
+        int vmid = json_get_int(item, "vmid", 0);
+        if (!node || vmid <= 0) continue;
+        
+        map[count].vmid = vmid;
+        snprintf(map[count].node, sizeof(map[count].node), "%s", node);
+        map[count].qemu = strcmp(type, "qemu") == 0;
+        count++;
     }
+    cJSON_Delete(response);
     
-    // 设置 HTTP 头
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
+    qsort(map, (size_t)count, sizeof(NodeEntry), cmp_node_entry);
+    free(cache->map);
+    cache->map = map;
+    cache->count = count;
+    cache->loaded = true;
+    return 0;
+}
+
+static NodeEntry* find_node_entry(NodeCache *cache, int vmid) {
+    NodeEntry key = { .vmid = vmid };
+    return bsearch(&key, cache->map, (size_t)cache->count, sizeof(NodeEntry), cmp_node_entry);
+}
+
+// 确保当前集群的节点缓存已加载；集群不可达时返回 -1
+int api_load_node_cache(void) {
+    NodeCache *cache = node_cache();
     
-    // 准备接收数据
-    struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-    
-    // 配置 curl
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl_handle, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, "");
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 30L);
-    
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl_handle);
+    pthread_mutex_lock(&cache->lock);
+    int ret = cache->loaded ? 0 : load_node_map(cache);
+    pthread_mutex_unlock(&cache->lock);
     
-    cJSON *json = NULL;
-    if (res != CURLE_OK) {
-        if (g_debug) {
-            fprintf(stderr, "curl_easy_perform() 失败: %s\n", curl_easy_strerror(res));
-        }
-    } else {
-        json = cJSON_Parse(chunk.memory);
-        if (!json && g_debug) {
-            fprintf(stderr, "JSON 解析失败: %s\n", chunk.memory);
-        }
+    return ret;
+}
+
+// 查询 VM 所在节点；集群中查不到时回退到配置的节点并返回 -1
+int api_resolve_node(int vmid, char *node, size_t len) {
+    NodeCache *cache = node_cache();
+    Config *config = current_config();
+    
+    pthread_mutex_lock(&cache->lock);
+    if (!cache->loaded) {
+        load_node_map(cache);
     }
+    NodeEntry *e = find_node_entry(cache, vmid);
+    if (e && !e->qemu) e = NULL;
+    snprintf(node, len, "%s", e ? e->node : (config ? config->node : ""));
+    pthread_mutex_unlock(&cache->lock);
     
-    free(chunk.memory);
-    curl_slist_free_all(headers);
-    
-    return json;
+    return e ? 0 : -1;
 }
 
-// 获取 VM 配置信息（网络、存储等）
-int api_get_vm_config_details(int vmid, VMInfo *vm) {
-    char endpoint[256];
-    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/config",
-             api_config->node, vmid);
+// VMID 是否已在集群中被使用（包括 LXC 容器）
+bool api_vmid_exists(int vmid) {
+    NodeCache *cache = node_cache();
     
-    cJSON *response = api_get(endpoint);
-    if (!response) return -1;
+    pthread_mutex_lock(&cache->lock);
+    if (!cache->loaded) {
+        load_node_map(cache);
+    }
+    bool exists = find_node_entry(cache, vmid) != NULL;
+    pthread_mutex_unlock(&cache->lock);
     
-    cJSON *data = cJSON_GetObjectItem(response, "data");
-    if (!data) {
-        cJSON_Delete(response);
-        return -1;
+    return exists;
+}
+
+// 丢弃当前集群的节点缓存（VM 被创建、删除或迁移后调用）
+void api_invalidate_node_cache(void) {
+    NodeCache *cache = node_cache();
+    
+    pthread_mutex_lock(&cache->lock);
+    free(cache->map);
+    cache->map = NULL;
+    cache->count = 0;
+    cache->loaded = false;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// 指定当前线程访问的集群，NULL 恢复为 api_init 的配置
+void api_use_config(Config *config) {
+    thread_config = config;
+}
+
+// 解析配置中的 agent 项，形如 "1" 或 "enabled=1,fstrim_cloned_disks=1"
+static AgentState parse_agent(cJSON *data) {
+    cJSON *item = cJSON_GetObjectItem(data, "agent");
+    if (cJSON_IsNumber(item)) {
+        return item->valueint ? AGENT_ENABLED : AGENT_DISABLED;
+    }
+    if (!cJSON_IsString(item)) {
+        return AGENT_DISABLED;  // PVE 默认不启用
+    }
+    
+    const char *value = item->valuestring;
+    const char *enabled = strstr(value, "enabled=");
+    if (enabled) {
+        value = enabled + strlen("enabled=");
+    } else if (memchr(value, '=', strcspn(value, ","))) {
+        return AGENT_DISABLED;  // 只设置了其他选项，enabled 取默认值 0
     }
+    return (atoi(value) == 1) ? AGENT_ENABLED : AGENT_DISABLED;
+}
+
+// 从 VM 配置（/config 的 data，或本地配置文件当前段）中取出 agent、网桥和存储
+void api_parse_vm_config(cJSON *data, VMInfo *vm) {
+    vm->agent = parse_agent(data);
+    snprintf(vm->tags, sizeof(vm->tags), "%s", json_get_string(data, "tags", ""));
     
     // 获取网桥信息
     const char *net0 = json_get_string(data, "net0", NULL);
@@ -192,8 +1446,32 @@ int api_get_vm_config_details(int vmid, VMInfo *vm) {
         }
     }
     
-    // 获取存储信息（从 bootdisk 或第一个磁盘）
+    // 获取存储信息（从 bootdisk 或 boot 顺序中的第一个磁盘）
     const char *bootdisk = json_get_string(data, "bootdisk", NULL);
+    char boot_first[32] = "";
+    if (!bootdisk) {
+        // 新版 PVE 使用 boot: order=scsi0;ide2;net0
+        const char *boot = json_get_string(data, "boot", NULL);
+        const char *order = boot ? strstr(boot, "order=") : NULL;
+        if (order) {
+            order += strlen("order=");
+            while (*order) {
+                size_t n = strcspn(order, ";,");
+                if (n > 0 && n < sizeof(boot_first) && strncmp(order, "net", 3) != 0) {
+                    memcpy(boot_first, order, n);
+                    boot_first[n] = '\0';
+                    const char *val = json_get_string(data, boot_first, NULL);
+                    if (val && !strstr(val, "media=cdrom")) {
+                        bootdisk = boot_first;
+                        break;
+                    }
+                }
+                order += n;
+                if (*order != ';') break;
+                order++;
+            }
+        }
+    }
     if (bootdisk) {
         const char *disk_value = json_get_string(data, bootdisk, NULL);
         if (disk_value) {
@@ -208,34 +1486,183 @@ int api_get_vm_config_details(int vmid, VMInfo *vm) {
             }
         }
     }
+}
+
+// 获取 VM 配置信息（网络、存储等）
+int api_get_vm_config_details(int vmid, VMInfo *vm, int cache_ttl) {
+    // 本机在监视配置目录时直接解析本地配置文件，文件没变就用缓存
+    if (confwatch_details(vmid, vm) == 0) return 0;
+    
+    char node[64];
+    api_resolve_node(vmid, node, sizeof(node));
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/config",
+             node, vmid);
+    
+    cJSON *response = api_get_cached(endpoint, API_TIMEOUT, cache_ttl);
+    if (!response) return -1;
+    
+    cJSON *data = cJSON_GetObjectItem(response, "data");
+    if (!data) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    api_parse_vm_config(data, vm);
     
     // 设置配置文件路径
     snprintf(vm->config_file, sizeof(vm->config_file), 
-             "/etc/pve/nodes/%s/qemu-server/%d.conf", api_config->node, vmid);
+             "/etc/pve/nodes/%s/qemu-server/%d.conf", node, vmid);
     
     cJSON_Delete(response);
     return 0;
 }
 
 // 获取 VM IP 地址（通过 qemu-guest-agent）
-int api_get_vm_ip(int vmid, VMInfo *vm) {
+// guest agent 失败记录：按 (集群, VMID) 记录连续失败次数，指数退避
+typedef struct {
+    const Config *config;
+    int vmid;
+    int failures;
+    double retry_at;
+} AgentFailure;
+
+static AgentFailure *agent_table = NULL;   // 开放寻址哈希表，vmid 为 0 表示空槽
+static int agent_table_size = 0;
+static int agent_table_used = 0;
+static AgentStats agent_stats;
+static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t agent_hash(const Config *config, int vmid, int size) {
+    uint64_t h = (uint64_t)(uintptr_t)config * 31 + (uint64_t)vmid;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)(h & (uint64_t)(size - 1));
+}
+
+// 查找或登记失败记录（调用方持有 agent_lock）
+static AgentFailure* agent_entry(int vmid, bool create) {
+    const Config *config = current_config();
+    
+    if (agent_table_size > 0) {
+        size_t i = agent_hash(config, vmid, agent_table_size);
+        while (agent_table[i].vmid != 0) {
+            if (agent_table[i].vmid == vmid && agent_table[i].config == config) {
+                return &agent_table[i];
+            }
+            i = (i + 1) & (size_t)(agent_table_size - 1);
+        }
+    }
+    if (!create) return NULL;
+    
+    // 装载率超过 1/2 时扩容
+    if ((agent_table_used + 1) * 2 > agent_table_size) {
+        int size = agent_table_size ? agent_table_size * 2 : 256;
+        AgentFailure *table = calloc((size_t)size, sizeof(AgentFailure));
+        if (!table) return NULL;
+        for (int k = 0; k < agent_table_size; k++) {
+            if (agent_table[k].vmid == 0) continue;
+            size_t j = agent_hash(agent_table[k].config, agent_table[k].vmid, size);
+            while (table[j].vmid != 0) {
+                j = (j + 1) & (size_t)(size - 1);
+            }
+            table[j] = agent_table[k];
+        }
+        free(agent_table);
+        agent_table = table;
+        agent_table_size = size;
+    }
+    
+    size_t i = agent_hash(config, vmid, agent_table_size);
+    while (agent_table[i].vmid != 0) {
+        i = (i + 1) & (size_t)(agent_table_size - 1);
+    }
+    agent_table[i].config = config;
+    agent_table[i].vmid = vmid;
+    agent_table_used++;
+    return &agent_table[i];
+}
+
+// 是否请求 agent：0 正常请求，1 退避结束后的试探（短超时），-1 跳过
+static int agent_gate(int vmid) {
+    pthread_mutex_lock(&agent_lock);
+    AgentFailure *f = agent_entry(vmid, false);
+    int gate = 0;
+    if (f && f->failures > 0) {
+        if (now_monotonic() < f->retry_at) {
+            agent_stats.skipped_backoff++;
+            gate = -1;
+        } else {
+            agent_stats.probes++;
+            gate = 1;
+        }
+    }
+    if (gate >= 0) agent_stats.calls++;
+    pthread_mutex_unlock(&agent_lock);
+    
+    return gate;
+}
+
+static void agent_record(int vmid, bool ok) {
+    pthread_mutex_lock(&agent_lock);
+    AgentFailure *f = agent_entry(vmid, !ok);
+    if (ok) {
+        if (f) f->failures = 0;
+    } else {
+        agent_stats.failures++;
+        if (f) {
+            int shift = f->failures < 5 ? f->failures : 5;
+            int backoff = AGENT_BACKOFF_BASE << shift;
+            if (backoff > AGENT_BACKOFF_MAX) backoff = AGENT_BACKOFF_MAX;
+            f->failures++;
+            f->retry_at = now_monotonic() + backoff;
+        }
+    }
+    pthread_mutex_unlock(&agent_lock);
+}
+
+void api_agent_stats(AgentStats *stats) {
+    pthread_mutex_lock(&agent_lock);
+    *stats = agent_stats;
+    pthread_mutex_unlock(&agent_lock);
+}
+
+int api_get_vm_ip(int vmid, VMInfo *vm, int cache_ttl) {
     if (strcmp(vm->status, "running") != 0) {
         return 0; // 只有运行中的 VM 才能获取 IP
     }
     
+    // 配置中未启用 agent 或处于失败退避期时不发请求
+    if (vm->agent == AGENT_DISABLED) {
+        pthread_mutex_lock(&agent_lock);
+        agent_stats.skipped_disabled++;
+        pthread_mutex_unlock(&agent_lock);
+        return 0;
+    }
+    
+    int gate = agent_gate(vmid);
+    if (gate < 0) return 0;
+    
+    char node[64];
+    api_resolve_node(vmid, node, sizeof(node));
+    
     char endpoint[256];
     snprintf(endpoint, sizeof(endpoint), 
              "/api2/json/nodes/%s/qemu/%d/agent/network-get-interfaces",
-             api_config->node, vmid);
+             node, vmid);
     
-    cJSON *response = api_get(endpoint);
-    if (!response) return -1;
+    cJSON *response = api_get_cached(endpoint, gate > 0 ? AGENT_PROBE_TIMEOUT : AGENT_TIMEOUT, cache_ttl);
+    long http_code = last_http_code;
     
-    cJSON *data = cJSON_GetObjectItem(response, "data");
-    if (!data) {
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!data || http_code < 200 || http_code >= 300) {
+        agent_record(vmid, false);
         cJSON_Delete(response);
         return -1;
     }
+    agent_record(vmid, true);
     
     // data 可能包含 result 数组
     cJSON *result = cJSON_GetObjectItem(data, "result");
@@ -272,20 +1699,26 @@ int api_get_vm_ip(int vmid, VMInfo *vm) {
     return 0;
 }
 
-int api_get_vm_list(VMInfo **vms, int *count) {
-    if (!vms || !count) return -1;
+// 检查 guest agent 是否可响应（agent/ping），node 为空时自动解析
+int api_agent_ping(int vmid, const char *node) {
+    char resolved[64];
+    if (!node || node[0] == '\0') {
+        api_resolve_node(vmid, resolved, sizeof(resolved));
+        node = resolved;
+    }
     
     char endpoint[256];
-    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu", api_config->node);
-    
-    cJSON *response = api_get(endpoint);
-    if (!response) return -1;
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/agent/ping", node, vmid);
     
-    cJSON *data = cJSON_GetObjectItem(response, "data");
-    if (!cJSON_IsArray(data)) {
-        cJSON_Delete(response);
-        return -1;
-    }
+    cJSON *response = api_request("POST", endpoint, NULL, AGENT_PROBE_TIMEOUT);
+    bool ok = response && last_http_code >= 200 && last_http_code < 300;
+    cJSON_Delete(response);
+    return ok ? 0 : -1;
+}
+
+// 把 /nodes/{node}/qemu 的 data 数组转换为 VMInfo 数组
+int api_parse_vm_list(cJSON *data, const char *node, VMInfo **vms, int *count) {
+    if (!cJSON_IsArray(data) || !vms || !count) return -1;
     
     int vm_count = cJSON_GetArraySize(data);
     *vms = calloc(vm_count, sizeof(VMInfo));
@@ -318,26 +1751,198 @@ int api_get_vm_list(VMInfo **vms, int *count) {
         vm->disk = (uint64_t)json_get_double(vm_json, "disk", 0);
         vm->cpu_percent = json_get_double(vm_json, "cpu", 0) * 100;
         vm->uptime = json_get_int(vm_json, "uptime", 0);
+        vm->netin = (uint64_t)json_get_double(vm_json, "netin", 0);
+        vm->netout = (uint64_t)json_get_double(vm_json, "netout", 0);
+        vm->diskread = (uint64_t)json_get_double(vm_json, "diskread", 0);
+        vm->diskwrite = (uint64_t)json_get_double(vm_json, "diskwrite", 0);
         
         // 初始化新字段
         strcpy(vm->ip_address, "N/A");
         strcpy(vm->bridge, "N/A");
         strcpy(vm->storage, "N/A");
         vm->config_file[0] = '\0';
+        snprintf(vm->node, sizeof(vm->node), "%s", node);
+    }
+    return 0;
+}
+
+static int local_cluster_vms(VMInfo **vms, int *count, const char *node, bool with_config);
+
+int api_get_vm_list(VMInfo **vms, int *count, int cache_ttl) {
+    if (!vms || !count || !current_config()) return -1;
+    
+    if (local_backend_enabled(current_config()) &&
+        local_cluster_vms(vms, count, current_config()->node, false) == 0) {
+        return 0;
+    }
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu", current_config()->node);
+    
+    cJSON *response = api_get_cached(endpoint, API_TIMEOUT, cache_ttl);
+    if (!response) return -1;
+    
+    int ret = api_parse_vm_list(cJSON_GetObjectItem(response, "data"), current_config()->node,
+                                vms, count);
+    cJSON_Delete(response);
+    return ret;
+}
+
+static int cmp_vm_info(const void *a, const void *b) {
+    const VMInfo *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+// 用一次 /cluster/resources 请求获取集群中所有节点的 VM（含节点、资源池和标签），按 VMID 排序
+static int remote_cluster_vms(VMInfo **vms, int *count) {
+    cJSON *response = api_get("/api2/json/cluster/resources?type=vm");
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int n = cJSON_GetArraySize(data);
+    VMInfo *list = calloc(n > 0 ? (size_t)n : 1, sizeof(VMInfo));
+    if (!list) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int vm_count = 0;
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        if (strcmp(json_get_string(item, "type", ""), "qemu") != 0) continue;
+        
+        VMInfo *vm = &list[vm_count++];
+        vm->vmid = json_get_int(item, "vmid", 0);
+        snprintf(vm->name, sizeof(vm->name), "%s", json_get_string(item, "name", "N/A"));
+        snprintf(vm->status, sizeof(vm->status), "%s", json_get_string(item, "status", "N/A"));
+        snprintf(vm->node, sizeof(vm->node), "%s", json_get_string(item, "node", ""));
+        snprintf(vm->pool, sizeof(vm->pool), "%s", json_get_string(item, "pool", ""));
+        snprintf(vm->tags, sizeof(vm->tags), "%s", json_get_string(item, "tags", ""));
+        vm->cpus = json_get_int(item, "maxcpu", 0);
+        vm->maxmem = (uint64_t)json_get_double(item, "maxmem", 0);
+        vm->mem = (uint64_t)json_get_double(item, "mem", 0);
+        vm->maxdisk = (uint64_t)json_get_double(item, "maxdisk", 0);
+        vm->disk = (uint64_t)json_get_double(item, "disk", 0);
+        vm->cpu_percent = json_get_double(item, "cpu", 0) * 100;
+        vm->uptime = json_get_int(item, "uptime", 0);
+        vm->netin = (uint64_t)json_get_double(item, "netin", 0);
+        vm->netout = (uint64_t)json_get_double(item, "netout", 0);
+        vm->diskread = (uint64_t)json_get_double(item, "diskread", 0);
+        vm->diskwrite = (uint64_t)json_get_double(item, "diskwrite", 0);
+        
+        strcpy(vm->ip_address, "N/A");
+        strcpy(vm->bridge, "N/A");
+        strcpy(vm->storage, "N/A");
+    }
+    cJSON_Delete(response);
+    
+    qsort(list, (size_t)vm_count, sizeof(VMInfo), cmp_vm_info);
+    *vms = list;
+    *count = vm_count;
+    return 0;
+}
+
+// 本地后端：VM 列表来自 pmxcfs，node 不为 NULL 时只保留该节点的 VM。
+// 只有 rrd 中缺少的 VM 才用一次 /cluster/resources 补齐
+static int local_cluster_vms(VMInfo **vms, int *count, const char *node, bool with_config) {
+    if (local_get_cluster_vms(vms, count, with_config, NULL) != 0) {
+        if (g_debug) fprintf(stderr, "无法读取 %s，改用 API\n", local_pve_root());
+        return -1;
+    }
+    
+    int kept = 0, missing = 0;
+    for (int i = 0; i < *count; i++) {
+        if (node && strcmp((*vms)[i].node, node) != 0) continue;
+        if ((*vms)[i].status[0] == '\0') missing++;
+        (*vms)[kept++] = (*vms)[i];
+    }
+    *count = kept;
+    if (missing == 0) return 0;
+    
+    VMInfo *remote = NULL;
+    int remote_count = 0;
+    int filled = 0;
+    bool ok = remote_cluster_vms(&remote, &remote_count) == 0;
+    for (int i = 0; i < *count; i++) {
+        VMInfo *vm = &(*vms)[i];
+        if (vm->status[0]) continue;
+        VMInfo *found = ok ? bsearch(vm, remote, (size_t)remote_count, sizeof(VMInfo), cmp_vm_info) : NULL;
+        if (found) {
+            *vm = *found;
+            filled++;
+        } else {
+            strcpy(vm->status, "unknown");
+            if (vm->name[0] == '\0') strcpy(vm->name, "N/A");
+        }
+    }
+    free(remote);
+    if (g_debug) {
+        fprintf(stderr, "%d 个 VM 不在 rrd 数据中，从 API 补齐 %d 个%s\n", missing, filled, ok ? "" : "（请求失败）");
+    }
+    return 0;
+}
+
+int api_get_cluster_vms(VMInfo **vms, int *count) {
+    if (!vms || !count) return -1;
+    
+    if (local_backend_enabled(current_config()) && local_cluster_vms(vms, count, NULL, true) == 0) {
+        return 0;
+    }
+    return remote_cluster_vms(vms, count);
+}
+
+// 获取集群中所有节点的容量和负载
+int api_get_nodes(NodeInfo **nodes, int *count) {
+    if (!nodes || !count) return -1;
+    
+    cJSON *response = api_get("/api2/json/cluster/resources?type=node");
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int n = cJSON_GetArraySize(data);
+    NodeInfo *list = calloc(n > 0 ? (size_t)n : 1, sizeof(NodeInfo));
+    if (!list) {
+        cJSON_Delete(response);
+        return -1;
     }
     
+    int node_count = 0;
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        if (strcmp(json_get_string(item, "type", ""), "node") != 0) continue;
+        
+        NodeInfo *node = &list[node_count++];
+        snprintf(node->name, sizeof(node->name), "%s", json_get_string(item, "node", ""));
+        node->online = strcmp(json_get_string(item, "status", ""), "online") == 0;
+        node->maxcpu = json_get_int(item, "maxcpu", 0);
+        node->cpu_percent = json_get_double(item, "cpu", 0) * 100;
+        node->maxmem = (uint64_t)json_get_double(item, "maxmem", 0);
+        node->mem = (uint64_t)json_get_double(item, "mem", 0);
+    }
     cJSON_Delete(response);
+    
+    *nodes = list;
+    *count = node_count;
     return 0;
 }
 
-int api_get_vm_status(int vmid, VMInfo *vm) {
+int api_get_vm_status(int vmid, VMInfo *vm, int cache_ttl) {
     if (!vm) return -1;
     
+    char node[64];
+    api_resolve_node(vmid, node, sizeof(node));
+    
     char endpoint[256];
     snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/status/current",
-             api_config->node, vmid);
+             node, vmid);
     
-    cJSON *response = api_get(endpoint);
+    cJSON *response = api_get_cached(endpoint, API_TIMEOUT, cache_ttl);
     if (!response) return -1;
     
     cJSON *data = cJSON_GetObjectItem(response, "data");
@@ -348,6 +1953,7 @@ int api_get_vm_status(int vmid, VMInfo *vm) {
     
     vm->vmid = vmid;
     strncpy(vm->name, json_get_string(data, "name", "N/A"), sizeof(vm->name) - 1);
+    snprintf(vm->node, sizeof(vm->node), "%s", node);
     
     // 获取状态，优先检查 qmpstatus
     const char *qmpstatus = json_get_string(data, "qmpstatus", NULL);
@@ -368,6 +1974,10 @@ int api_get_vm_status(int vmid, VMInfo *vm) {
     vm->disk = (uint64_t)json_get_double(data, "disk", 0);
     vm->cpu_percent = json_get_double(data, "cpu", 0) * 100;
     vm->uptime = json_get_int(data, "uptime", 0);
+    vm->netin = (uint64_t)json_get_double(data, "netin", 0);
+    vm->netout = (uint64_t)json_get_double(data, "netout", 0);
+    vm->diskread = (uint64_t)json_get_double(data, "diskread", 0);
+    vm->diskwrite = (uint64_t)json_get_double(data, "diskwrite", 0);
     
     // 初始化新字段
     strcpy(vm->ip_address, "N/A");
@@ -378,81 +1988,84 @@ int api_get_vm_status(int vmid, VMInfo *vm) {
     cJSON_Delete(response);
     
     // 获取配置详情（网络、存储等）
-    api_get_vm_config_details(vmid, vm);
+    api_get_vm_config_details(vmid, vm, cache_ttl);
     
     // 获取 IP 地址（如果 VM 正在运行）
-    api_get_vm_ip(vmid, vm);
+    api_get_vm_ip(vmid, vm, cache_ttl);
     
     return 0;
 }
 
+// 电源操作生效后 VM 的 qmpstatus；无法据此判断是否生效的操作返回 NULL
+static const char* action_target_state(const char *action) {
+    if (strcmp(action, "start") == 0 || strcmp(action, "resume") == 0) return "running";
+    if (strcmp(action, "stop") == 0) return "stopped";
+    if (strcmp(action, "suspend") == 0) return "paused";
+    return NULL;
+}
+
+typedef struct {
+    int vmid;
+    const char *node;
+    const char *state;
+} StateCheck;
+
+// 请求结果不确定时检查 VM 是否已处于目标状态
+static bool vm_state_reached(void *arg) {
+    const StateCheck *check = (const StateCheck *)arg;
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/status/current",
+             check->node, check->vmid);
+    
+    cJSON *response = api_request("GET", endpoint, NULL, API_TIMEOUT);
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    bool reached = false;
+    if (cJSON_IsObject(data)) {
+        const char *status = json_get_string(data, "qmpstatus", json_get_string(data, "status", ""));
+        reached = strcmp(status, check->state) == 0;
+    }
+    cJSON_Delete(response);
+    
+    if (reached && g_debug) {
+        fprintf(stderr, "VM %d 已处于 %s，不再重试\n", check->vmid, check->state);
+    }
+    return reached;
+}
+
 int api_vm_action(int vmid, const char *action) {
-    if (!action || !curl_handle) return -1;
+    if (!action || !current_config()) return -1;
     
-    char url[1024];
+    char node[64];
     char endpoint[256];
     bool is_destroy = (strcmp(action, "destroy") == 0);
+    api_resolve_node(vmid, node, sizeof(node));
     
     // destroy 操作使用 DELETE 方法
     if (is_destroy) {
         snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d",
-                 api_config->node, vmid);
+                 node, vmid);
     } else {
         // 其他操作使用 POST 到 status/<action>
         snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/status/%s",
-                 api_config->node, vmid, action);
-    }
-    
-    snprintf(url, sizeof(url), "https://%s:%d%s",
-             api_config->host, api_config->port, endpoint);
-    
-    // 构建认证头
-    char auth_header[1024];
-    snprintf(auth_header, sizeof(auth_header),
-             "Authorization: PVEAPIToken=%s=%s",
-             api_config->token_id, api_config->token_secret);
-    
-    if (g_debug) {
-        fprintf(stderr, "API %s: %s\n", is_destroy ? "DELETE" : "POST", endpoint);
+                 node, vmid, action);
     }
     
-    // 设置 HTTP 头
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
+    // start/stop 等操作在结果不确定时先确认 VM 状态再重试，避免重复执行
+    StateCheck check = { vmid, node, action_target_state(action) };
+    RetryPolicy policy = { .applied = check.state ? vm_state_reached : NULL, .arg = &check };
+    bool applied = false;
     
-    // 准备接收数据
     struct MemoryStruct chunk = {0};
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-    
-    // 配置 curl
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-    
-    if (is_destroy) {
-        curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, "DELETE");
-    } else {
-        curl_easy_setopt(curl_handle, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, "");
-    }
-    
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 30L);
-    
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl_handle);
+    CURLcode res = api_perform_retry(is_destroy ? "DELETE" : "POST", endpoint, NULL, &chunk,
+                                     API_TIMEOUT, &policy, &applied);
     
     int ret = -1;
-    long http_code = 0;
-    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
+    long http_code = last_http_code;
     
-    if (res != CURLE_OK) {
-        if (g_debug) {
-            fprintf(stderr, "curl_easy_perform() 失败: %s\n", curl_easy_strerror(res));
-        }
+    if (applied) {
+        ret = 0;
+    } else if (res != CURLE_OK) {
+        // api_perform 已输出调试信息
     } else {
         if (g_debug) {
             fprintf(stderr, "HTTP %s %ld: %s\n", is_destroy ? "DELETE" : "POST", http_code, endpoint);
@@ -495,21 +2108,72 @@ int api_vm_action(int vmid, const char *action) {
     }
     
     free(chunk.memory);
-    curl_slist_free_all(headers);
-    
-    // 重置 curl 选项以供下次使用
-    if (is_destroy) {
-        curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, NULL);
-    }
-    curl_easy_setopt(curl_handle, CURLOPT_POST, 0L);
-    
     return ret;
 }
 
-void api_cleanup(void) {
+// 释放当前线程的 curl handle（工作线程退出前调用）
+void api_thread_cleanup(void) {
     if (curl_handle) {
-        curl_easy_cleanup(curl_handle);
+        lib.easy_cleanup(curl_handle);
         curl_handle = NULL;
     }
-    curl_global_cleanup();
+    if (hedge_handle) {
+        lib.easy_cleanup(hedge_handle);
+        hedge_handle = NULL;
+    }
+    if (hedge_multi) {
+        lib.multi_cleanup(hedge_multi);
+        hedge_multi = NULL;
+    }
+}
+
+void api_cleanup(void) {
+    api_thread_cleanup();
+    
+    if (g_debug && retry_stats.retries > 0) {
+        fprintf(stderr, "重试: %ld 个请求共重试 %ld 次 (%ld 个恢复, %ld 个仍失败)\n",
+                retry_stats.recovered + retry_stats.exhausted, retry_stats.retries,
+                retry_stats.recovered, retry_stats.exhausted);
+    }
+    if (g_debug) {
+        HostConcurrency hosts[AIMD_HOSTS];
+        int n = api_concurrency_stats(hosts, AIMD_HOSTS);
+        for (int i = 0; i < n; i++) {
+            fprintf(stderr, "并发 %s: 窗口 %.1f, 最大并发 %d, %ld 个请求 (等待 %ld 次, 退让 %ld 次)\n",
+                    hosts[i].host, hosts[i].window, hosts[i].max_inflight, hosts[i].requests,
+                    hosts[i].waits, hosts[i].cuts);
+        }
+    }
+    if (g_debug && hedge_stats.hedged > 0) {
+        fprintf(stderr, "对冲: %ld 个可对冲请求, 发出 %ld 个对冲请求 (%ld 个先返回, %ld 个超出预算)\n",
+                hedge_stats.eligible, hedge_stats.hedged, hedge_stats.wins, hedge_stats.denied);
+    }
+    if (g_debug && (agent_stats.calls || agent_stats.skipped_disabled || agent_stats.skipped_backoff)) {
+        fprintf(stderr, "guest agent: %ld 次请求 (%ld 次失败, %ld 次试探), 跳过 %ld 次 (未启用 %ld, 退避中 %ld)\n",
+                agent_stats.calls, agent_stats.failures, agent_stats.probes,
+                agent_stats.skipped_disabled + agent_stats.skipped_backoff,
+                agent_stats.skipped_disabled, agent_stats.skipped_backoff);
+    }
+    free(agent_table);
+    agent_table = NULL;
+    agent_table_size = 0;
+    agent_table_used = 0;
+    
+    pthread_mutex_lock(&node_caches_lock);
+    for (int i = 0; i < node_cache_count; i++) {
+        free(node_caches[i].map);
+        pthread_mutex_destroy(&node_caches[i].lock);
+    }
+    node_cache_count = 0;
+    pthread_mutex_unlock(&node_caches_lock);
+    if (!curl_ready) return;
+    if (curl_share) {
+        lib.share_cleanup(curl_share);
+        curl_share = NULL;
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&share_locks[i]);
+        }
+    }
+    lib.global_cleanup();
+    curl_ready = false;
 }
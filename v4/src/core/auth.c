@@ -0,0 +1,194 @@
+/*
+ * 用户名密码认证
+ * 通过 /access/ticket 换取票据和 CSRF token，缓存在集群缓存目录的 .ticket 文件中
+ * （权限 600），之后的命令直接复用，不必每次都登录（PAM 认证在服务器端开销不小）。
+ * 票据有效期 2 小时，使用超过 1 小时后用旧票据续期，过期后才需要密码
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AUTH_TICKET_LIFETIME 7200   // PVE 票据有效期（秒）
+#define AUTH_EXPIRY_MARGIN 300      // 剩余有效期不足时视为过期，避免请求途中失效
+#define AUTH_RENEW_AFTER 3600       // 使用超过这么久就续期
+#define AUTH_TICKET_FILE ".ticket"
+
+typedef struct {
+    const Config *config;
+    pthread_mutex_t lock;       // 登录和续期期间其他线程等待
+    bool loaded;                // 已尝试读取磁盘缓存
+    char ticket[AUTH_TICKET_LEN];
+    char csrf[AUTH_CSRF_LEN];
+    time_t issued;
+} AuthEntry;
+
+static AuthEntry auth_entries[MAX_CLUSTERS + 1];   // 集群配置 + 默认配置
+static int auth_entry_count = 0;
+static pthread_mutex_t auth_entries_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static AuthEntry* auth_entry(const Config *config) {
+    AuthEntry *entry = NULL;
+    pthread_mutex_lock(&auth_entries_lock);
+    for (int i = 0; i < auth_entry_count; i++) {
+        if (auth_entries[i].config == config) {
+            entry = &auth_entries[i];
+            break;
+        }
+    }
+    if (!entry && auth_entry_count < MAX_CLUSTERS + 1) {
+        entry = &auth_entries[auth_entry_count++];
+        memset(entry, 0, sizeof(*entry));
+        entry->config = config;
+        pthread_mutex_init(&entry->lock, NULL);
+    }
+    pthread_mutex_unlock(&auth_entries_lock);
+    return entry;
+}
+
+bool auth_uses_ticket(const Config *config) {
+    return config && config->token_id[0] == '\0' && config->username[0] != '\0';
+}
+
+// 读取磁盘上的票据：只接受当前用户所有、其他人不可读写的普通文件，
+// 且用户名与配置一致
+static void ticket_load(AuthEntry *entry) {
+    char path[640];
+    if (cache_file_path(entry->config, AUTH_TICKET_FILE, path, sizeof(path)) != 0) return;
+    
+    int fd = open(path, O_RDONLY | O_NOFOLLOW);
+    if (fd < 0) return;
+    
+    struct stat st;
+    char buf[AUTH_TICKET_LEN + AUTH_CSRF_LEN + 256];
+    ssize_t n = -1;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_uid == geteuid() &&
+        (st.st_mode & 077) == 0) {
+        n = read(fd, buf, sizeof(buf) - 1);
+    }
+    close(fd);
+    if (n <= 0) return;
+    buf[n] = '\0';
+    
+    // 格式：用户名\n票据\nCSRF token\n签发时间\n
+    char *save = NULL;
+    char *user = strtok_r(buf, "\n", &save);
+    char *ticket = strtok_r(NULL, "\n", &save);
+    char *csrf = strtok_r(NULL, "\n", &save);
+    char *issued = strtok_r(NULL, "\n", &save);
+    if (!user || !ticket || !csrf || !issued || strcmp(user, entry->config->username) != 0) return;
+    if (strlen(ticket) >= sizeof(entry->ticket) || strlen(csrf) >= sizeof(entry->csrf)) return;
+    
+    snprintf(entry->ticket, sizeof(entry->ticket), "%s", ticket);
+    snprintf(entry->csrf, sizeof(entry->csrf), "%s", csrf);
+    entry->issued = (time_t)atoll(issued);
+    if (g_debug) {
+        fprintf(stderr, "使用缓存的票据 (%lds 前签发)\n", (long)(time(NULL) - entry->issued));
+    }
+}
+
+// 先写临时文件再 rename，并发运行的其他 vmanager 不会读到半个文件
+static void ticket_save(const AuthEntry *entry) {
+    char path[640], tmp[660];
+    if (cache_file_path(entry->config, AUTH_TICKET_FILE, path, sizeof(path)) != 0) return;
+    
+    snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    if (fd < 0) return;
+    
+    char buf[AUTH_TICKET_LEN + AUTH_CSRF_LEN + 256];
+    int len = snprintf(buf, sizeof(buf), "%s\n%s\n%s\n%lld\n", entry->config->username,
+                       entry->ticket, entry->csrf, (long long)entry->issued);
+    bool ok = len > 0 && (size_t)len < sizeof(buf) && write_all(fd, buf, (size_t)len) == 0;
+    
+    if (close(fd) != 0 || !ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+    }
+}
+
+static void ticket_remove(const AuthEntry *entry) {
+    char path[640];
+    if (cache_file_path(entry->config, AUTH_TICKET_FILE, path, sizeof(path)) == 0) {
+        unlink(path);
+    }
+}
+
+// 登录或续期；password 为旧票据时即续期。失败时错误信息留在 api_last_error()
+static int ticket_request(AuthEntry *entry, const char *password) {
+    char ticket[AUTH_TICKET_LEN], csrf[AUTH_CSRF_LEN];
+    if (api_login(entry->config->username, password, ticket, sizeof(ticket), csrf, sizeof(csrf)) != 0) {
+        return -1;
+    }
+    
+    snprintf(entry->ticket, sizeof(entry->ticket), "%s", ticket);
+    snprintf(entry->csrf, sizeof(entry->csrf), "%s", csrf);
+    entry->issued = time(NULL);
+    ticket_save(entry);
+    return 0;
+}
+
+// 取得有效的票据：优先用内存或磁盘中的票据，快到期时续期，过期后用密码登录。
+// 密码来自配置文件的 password，或环境变量 VMANAGER_PASSWORD
+int auth_ticket(const Config *config, char *ticket, size_t ticket_len, char *csrf, size_t csrf_len,
+                char *error, size_t error_len) {
+    AuthEntry *entry = auth_entry(config);
+    if (!entry) {
+        snprintf(error, error_len, "集群数量超过上限");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&entry->lock);
+    if (!entry->loaded) {
+        ticket_load(entry);
+        entry->loaded = true;
+    }
+    
+    int ret = 0;
+    time_t age = time(NULL) - entry->issued;
+    bool valid = entry->ticket[0] && age >= 0 && age < AUTH_TICKET_LIFETIME - AUTH_EXPIRY_MARGIN;
+    
+    if (valid && age >= AUTH_RENEW_AFTER) {
+        // 续期失败时旧票据仍然可用，下一次请求再试
+        char old[AUTH_TICKET_LEN];
+        snprintf(old, sizeof(old), "%s", entry->ticket);
+        if (ticket_request(entry, old) != 0 && g_debug) {
+            fprintf(stderr, "票据续期失败: %s\n", api_last_error());
+        } else if (g_debug) {
+            fprintf(stderr, "票据已续期\n");
+        }
+    } else if (!valid) {
+        const char *password = config->password[0] ? config->password : getenv("VMANAGER_PASSWORD");
+        if (!password || !password[0]) {
+            snprintf(error, error_len, "需要密码：在配置文件 [auth] 中设置 password，或设置环境变量 VMANAGER_PASSWORD");
+            ret = -1;
+        } else if (ticket_request(entry, password) != 0) {
+            snprintf(error, error_len, "登录失败: %s", api_last_error());
+            entry->ticket[0] = '\0';
+            ret = -1;
+        }
+    }
+    
+    if (ret == 0) {
+        snprintf(ticket, ticket_len, "%s", entry->ticket);
+        snprintf(csrf, csrf_len, "%s", entry->csrf);
+    }
+    pthread_mutex_unlock(&entry->lock);
+    return ret;
+}
+
+// 服务器拒绝了票据（被吊销或服务器时间不一致），丢弃后下次请求重新登录
+void auth_invalidate(const Config *config) {
+    AuthEntry *entry = auth_entry(config);
+    if (!entry) return;
+    
+    pthread_mutex_lock(&entry->lock);
+    entry->ticket[0] = '\0';
+    entry->csrf[0] = '\0';
+    entry->issued = 0;
+    entry->loaded = true;
+    ticket_remove(entry);
+    pthread_mutex_unlock(&entry->lock);
+}
@@ -0,0 +1,324 @@
+/*
+ * 批量备份
+ * 并发提交 vzdump 任务，按目标存储和节点限制并发；磁盘大的 VM 先开始，
+ * 缩短整批备份的总时长，结束后按节点汇总吞吐
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <unistd.h>
+
+// 单个备份任务
+typedef struct {
+    int vmid;
+    char name[128];
+    char node[64];
+    uint64_t size;          // 磁盘大小 (maxdisk)
+    bool taken;
+    int ret;
+    char error[256];
+    double started;
+    double elapsed;
+} BackupJob;
+
+typedef struct {
+    const BackupOptions *opts;
+    BackupJob *jobs;
+    int count;
+    const char *storage_key;
+    KeyedLimit storage_limit;
+    KeyedLimit node_limit;
+    pthread_mutex_t lock;   // 保护 taken/done/failed，并配合 cond 等待空闲槽位
+    pthread_cond_t cond;
+    int done;
+    int failed;
+    bool show_progress;
+} BackupRun;
+
+static int cmp_job_size(const void *a, const void *b) {
+    const BackupJob *x = a, *y = b;
+    if (x->size != y->size) return (x->size < y->size) - (x->size > y->size);
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+static int cmp_vmid(const void *key, const void *elem) {
+    int vmid = *(const int *)key;
+    const VMInfo *vm = elem;
+    return (vmid > vm->vmid) - (vmid < vm->vmid);
+}
+
+// 取下一个可以开始的任务：按磁盘从大到小，跳过存储或节点已满的任务；
+// 全部任务都已取走时返回 -1
+static int take_job(BackupRun *run) {
+    pthread_mutex_lock(&run->lock);
+    for (;;) {
+        bool pending = false;
+        for (int i = 0; i < run->count; i++) {
+            BackupJob *job = &run->jobs[i];
+            if (job->taken) continue;
+            pending = true;
+            
+            if (!keyed_limit_try_acquire(&run->storage_limit, run->storage_key)) continue;
+            if (!keyed_limit_try_acquire(&run->node_limit, job->node)) {
+                keyed_limit_release(&run->storage_limit, run->storage_key);
+                continue;
+            }
+            
+            job->taken = true;
+            pthread_mutex_unlock(&run->lock);
+            return i;
+        }
+        if (!pending) break;
+        
+        pthread_cond_wait(&run->cond, &run->lock);
+    }
+    pthread_mutex_unlock(&run->lock);
+    return -1;
+}
+
+static void finish_job(BackupRun *run, BackupJob *job) {
+    keyed_limit_release(&run->node_limit, job->node);
+    keyed_limit_release(&run->storage_limit, run->storage_key);
+    
+    pthread_mutex_lock(&run->lock);
+    run->done++;
+    if (job->ret != 0) run->failed++;
+    
+    if (run->show_progress) {
+        fprintf(stderr, "\r\033[K");
+    }
+    char size[FORMAT_LEN], rate[FORMAT_LEN];
+    if (job->ret != 0) {
+        fprintf(stderr, "\033[31m✗\033[0m VM %d 备份失败: %s\n", job->vmid, job->error);
+    } else {
+        double secs = job->elapsed > 0.1 ? job->elapsed : 0.1;
+        printf("\033[32m✓\033[0m VM %d (%s) 备份完成 %s, %.1fs, %s/s\n", job->vmid, job->name,
+               format_bytes(job->size, size, sizeof(size)), job->elapsed,
+               format_bytes((uint64_t)((double)job->size / secs), rate, sizeof(rate)));
+        fflush(stdout);
+    }
+    if (run->show_progress) {
+        progress_draw("备份", run->done, run->failed, run->count);
+    }
+    
+    pthread_cond_broadcast(&run->cond);
+    pthread_mutex_unlock(&run->lock);
+}
+
+static void run_backup(BackupRun *run, BackupJob *job) {
+    const BackupOptions *opts = run->opts;
+    job->started = now_monotonic();
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/vzdump", job->node);
+    
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddNumberToObject(body, "vmid", job->vmid);
+    cJSON_AddStringToObject(body, "mode", opts->mode);
+    cJSON_AddStringToObject(body, "compress", opts->compress);
+    if (opts->storage[0]) cJSON_AddStringToObject(body, "storage", opts->storage);
+    if (opts->bwlimit > 0) cJSON_AddNumberToObject(body, "bwlimit", opts->bwlimit);
+    
+    cJSON *response = api_post(endpoint, body);
+    cJSON_Delete(body);
+    
+    char upid[256];
+    if (api_response_upid(response, upid, sizeof(upid)) != 0) {
+        snprintf(job->error, sizeof(job->error), "%s", api_last_error());
+        job->ret = -1;
+    } else if (upid[0]) {
+        char exitstatus[128];
+        if (api_wait_task(upid, opts->timeout, exitstatus, sizeof(exitstatus)) != 0) {
+            snprintf(job->error, sizeof(job->error), "任务失败: %s", exitstatus);
+            job->ret = -1;
+        }
+    }
+    cJSON_Delete(response);
+    
+    job->elapsed = now_monotonic() - job->started;
+}
+
+// 每个工作线程循环领取任务，直到全部取完
+static void backup_worker(int index, void *arg) {
+    (void)index;
+    BackupRun *run = (BackupRun *)arg;
+    
+    int i;
+    while ((i = take_job(run)) >= 0) {
+        run_backup(run, &run->jobs[i]);
+        finish_job(run, &run->jobs[i]);
+    }
+}
+
+static void print_plan(const BackupJob *jobs, int count) {
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "NODE", false },
+        { "DISK", true },
+    };
+    Table table;
+    table_init(&table, columns, 4);
+    
+    char buf[FORMAT_LEN];
+    for (int i = 0; i < count; i++) {
+        table_cell(&table, "%d", jobs[i].vmid);
+        table_cell(&table, "%s", jobs[i].name);
+        table_cell(&table, "%s", jobs[i].node);
+        table_cell(&table, "%s", format_bytes(jobs[i].size, buf, sizeof(buf)));
+    }
+    
+    fflush(stdout);
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+}
+
+// 按节点汇总成功任务的数据量和吞吐，吞吐 = 数据量 / 该节点第一个任务开始到最后一个结束
+static void print_throughput(const BackupJob *jobs, int count, const char *storage) {
+    static const TableColumn columns[] = {
+        { "NODE", false },
+        { "JOBS", true },
+        { "SIZE", true },
+        { "TIME", true },
+        { "RATE", true },
+    };
+    Table table;
+    table_init(&table, columns, 5);
+    
+    char size[FORMAT_LEN], rate[FORMAT_LEN];
+    uint64_t total_bytes = 0;
+    double first = 0, last = 0;
+    bool any = false;
+    
+    for (int i = 0; i < count; i++) {
+        // 每个节点只在第一次出现时汇总
+        bool seen = false;
+        for (int k = 0; k < i; k++) {
+            if (strcmp(jobs[k].node, jobs[i].node) == 0) {
+                seen = true;
+                break;
+            }
+        }
+        if (seen) continue;
+        
+        int n = 0;
+        uint64_t bytes = 0;
+        double start = 0, end = 0;
+        for (int k = i; k < count; k++) {
+            const BackupJob *j = &jobs[k];
+            if (strcmp(j->node, jobs[i].node) != 0 || j->ret != 0) continue;
+            if (n == 0 || j->started < start) start = j->started;
+            if (n == 0 || j->started + j->elapsed > end) end = j->started + j->elapsed;
+            bytes += j->size;
+            n++;
+        }
+        if (n == 0) continue;
+        
+        double span = end - start > 0.1 ? end - start : 0.1;
+        table_cell(&table, "%s", jobs[i].node);
+        table_cell(&table, "%d", n);
+        table_cell(&table, "%s", format_bytes(bytes, size, sizeof(size)));
+        table_cell(&table, "%.1fs", end - start);
+        table_cell(&table, "%s/s", format_bytes((uint64_t)((double)bytes / span), rate, sizeof(rate)));
+        
+        total_bytes += bytes;
+        if (!any || start < first) first = start;
+        if (!any || end > last) last = end;
+        any = true;
+    }
+    
+    if (!any) {
+        table_free(&table);
+        return;
+    }
+    
+    printf("\n");
+    fflush(stdout);
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+    
+    double span = last - first > 0.1 ? last - first : 0.1;
+    printf("\n存储 %s: %s, %.1fs, %s/s\n", storage[0] ? storage : "(默认)",
+           format_bytes(total_bytes, size, sizeof(size)), last - first,
+           format_bytes((uint64_t)((double)total_bytes / span), rate, sizeof(rate)));
+}
+
+int backup_run(const int *vmids, int count, const BackupOptions *opts) {
+    if (!vmids || count <= 0 || !opts) return -1;
+    
+    VMInfo *vms = NULL;
+    int vm_count = 0;
+    if (api_get_cluster_vms(&vms, &vm_count) != 0) {
+        fprintf(stderr, "错误：无法获取集群资源: %s\n", api_last_error());
+        return -1;
+    }
+    
+    BackupRun run = { .opts = opts, .storage_key = opts->storage };
+    run.jobs = calloc((size_t)count, sizeof(BackupJob));
+    if (!run.jobs) {
+        free(vms);
+        return -1;
+    }
+    
+    int missing = 0;
+    for (int i = 0; i < count; i++) {
+        VMInfo *vm = bsearch(&vmids[i], vms, (size_t)vm_count, sizeof(VMInfo), cmp_vmid);
+        if (!vm) {
+            fprintf(stderr, "\033[31m✗\033[0m VM %d 不存在\n", vmids[i]);
+            missing++;
+            continue;
+        }
+        BackupJob *job = &run.jobs[run.count++];
+        job->vmid = vm->vmid;
+        snprintf(job->name, sizeof(job->name), "%s", vm->name);
+        snprintf(job->node, sizeof(job->node), "%s", vm->node);
+        job->size = vm->maxdisk;
+    }
+    free(vms);
+    
+    if (run.count == 0) {
+        free(run.jobs);
+        return 1;
+    }
+    
+    // 大任务先开始，最后只剩小任务收尾（LPT 调度）
+    qsort(run.jobs, (size_t)run.count, sizeof(BackupJob), cmp_job_size);
+    
+    if (opts->dry_run) {
+        print_plan(run.jobs, run.count);
+        free(run.jobs);
+        return missing > 0 ? 1 : 0;
+    }
+    
+    printf("备份 %d 个 VM 到存储 %s (每个存储 %d 个并发，每个节点 %d 个)\n", run.count,
+           opts->storage[0] ? opts->storage : "(默认)", opts->per_storage, opts->per_node);
+    fflush(stdout);
+    
+    keyed_limit_init(&run.storage_limit, opts->per_storage);
+    keyed_limit_init(&run.node_limit, opts->per_node);
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.cond, NULL);
+    run.show_progress = isatty(STDERR_FILENO) && !g_debug;
+    if (run.show_progress) {
+        progress_draw("备份", 0, 0, run.count);
+    }
+    
+    double start = now_monotonic();
+    int workers = g_parallel < run.count ? g_parallel : run.count;
+    pool_run(workers, workers, backup_worker, &run);
+    
+    if (run.show_progress) {
+        fprintf(stderr, "\r\033[K");
+    }
+    print_throughput(run.jobs, run.count, opts->storage);
+    printf("\n备份 总计: \033[32m%d 成功\033[0m, \033[31m%d 失败\033[0m (%.1fs)\n",
+           run.done - run.failed, run.failed + missing, now_monotonic() - start);
+    
+    int ret = (run.failed + missing > 0) ? 1 : 0;
+    pthread_cond_destroy(&run.cond);
+    pthread_mutex_destroy(&run.lock);
+    keyed_limit_destroy(&run.storage_limit);
+    keyed_limit_destroy(&run.node_limit);
+    free(run.jobs);
+    return ret;
+}
@@ -0,0 +1,168 @@
+/*
+ * 只读请求的磁盘缓存
+ * 开启 --cache-ttl 后，list/status 用到的 GET 响应按集群缓存在
+ * $XDG_CACHE_HOME/vmanager（默认 ~/.cache/vmanager），命中时不初始化 curl/TLS，
+ * 供 shell 提示符、补全脚本等频繁调用的场景使用；修改类请求成功后清空该集群的缓存
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// FNV-1a
+static uint64_t hash_str(uint64_t h, const char *s) {
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int cache_root(char *path, size_t len) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    
+    if (xdg && xdg[0]) {
+        snprintf(path, len, "%s/vmanager", xdg);
+    } else if (home && home[0]) {
+        snprintf(path, len, "%s/.cache/vmanager", home);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// 每个集群（地址 + token 或用户名）一个子目录
+static int cluster_dir(const Config *config, char *path, size_t len) {
+    char root[448];
+    if (!config || cache_root(root, sizeof(root)) != 0) return -1;
+    
+    char port[16];
+    snprintf(port, sizeof(port), ":%d|", config->port);
+    uint64_t h = hash_str(1469598103934665603ULL, config->host);
+    h = hash_str(h, port);
+    h = hash_str(h, config->token_id[0] ? config->token_id : config->username);
+    
+    snprintf(path, len, "%s/%016llx", root, (unsigned long long)h);
+    return 0;
+}
+
+static int entry_path(const Config *config, const char *endpoint, char *path, size_t len) {
+    char dir[512];
+    if (cluster_dir(config, dir, sizeof(dir)) != 0) return -1;
+    
+    snprintf(path, len, "%s/%016llx.json", dir,
+             (unsigned long long)hash_str(1469598103934665603ULL, endpoint));
+    return 0;
+}
+
+static int make_dirs(const Config *config) {
+    char root[448], dir[512];
+    if (cache_root(root, sizeof(root)) != 0 || cluster_dir(config, dir, sizeof(dir)) != 0) {
+        return -1;
+    }
+    
+    // ~/.cache 可能还不存在
+    char parent[448];
+    snprintf(parent, sizeof(parent), "%s", root);
+    char *slash = strrchr(parent, '/');
+    if (slash && slash != parent) {
+        *slash = '\0';
+        mkdir(parent, 0700);
+    }
+    
+    if (mkdir(root, 0700) != 0 && errno != EEXIST) return -1;
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+// 集群缓存目录中的其他文件（如登录票据），按需创建目录；
+// 名称以 . 开头的文件不会被 cache_invalidate 删除
+int cache_file_path(const Config *config, const char *name, char *path, size_t len) {
+    char dir[512];
+    if (cluster_dir(config, dir, sizeof(dir)) != 0 || make_dirs(config) != 0) return -1;
+    
+    snprintf(path, len, "%s/%s", dir, name);
+    return 0;
+}
+
+// 读取未过期的缓存响应，返回 malloc 的内容；未命中返回 NULL
+char* cache_read(const Config *config, const char *endpoint, int ttl) {
+    char path[640];
+    if (ttl <= 0 || entry_path(config, endpoint, path, sizeof(path)) != 0) return NULL;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || time(NULL) - st.st_mtime >= ttl || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    
+    char *body = malloc((size_t)st.st_size + 1);
+    size_t got = 0;
+    while (body && got < (size_t)st.st_size) {
+        ssize_t n = read(fd, body + got, (size_t)st.st_size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+    
+    if (!body || got != (size_t)st.st_size) {
+        free(body);
+        return NULL;
+    }
+    body[got] = '\0';
+    
+    if (g_debug) {
+        fprintf(stderr, "缓存命中: %s\n", endpoint);
+    }
+    return body;
+}
+
+// 写入缓存：先写临时文件再 rename，并发的读者不会看到半个文件
+void cache_write(const Config *config, const char *endpoint, const char *body, size_t len) {
+    char path[640], tmp[660];
+    if (entry_path(config, endpoint, path, sizeof(path)) != 0 || make_dirs(config) != 0) return;
+    
+    snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return;
+    
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, body + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    
+    if (close(fd) != 0 || done != len || rename(tmp, path) != 0) {
+        unlink(tmp);
+    }
+}
+
+// 清空一个集群的缓存（VM 状态或配置可能已被修改）
+void cache_invalidate(const Config *config) {
+    char dir[512];
+    if (cluster_dir(config, dir, sizeof(dir)) != 0) return;
+    
+    DIR *d = opendir(dir);
+    if (!d) return;
+    
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        
+        char path[800];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
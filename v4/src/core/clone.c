@@ -0,0 +1,333 @@
+/*
+ * 批量克隆
+ * 从模板并发创建多个 VM，优先使用链接克隆，完整克隆按目标存储限制并发
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+#include <unistd.h>
+
+// 单个克隆任务
+typedef struct {
+    int newid;
+    char name[128];
+    int ret;
+    char error[256];
+    double elapsed;
+} CloneJob;
+
+typedef struct {
+    const CloneOptions *opts;
+    CloneJob *jobs;
+    int count;
+    char node[64];           // 源 VM 所在节点
+    char limit_key[64];      // 并发分组使用的存储名
+    bool linked;
+    KeyedLimit storage_limit;
+    pthread_mutex_t progress_lock;
+    int done;
+    int failed;
+    bool show_progress;
+} CloneRun;
+
+// 源 VM 的磁盘信息
+typedef struct {
+    bool is_template;
+    int disk_count;
+    char storages[16][64];
+    bool qcow2[16];
+} SourceInfo;
+
+// 按名称模式生成 VM 名称，%d 替换为序号（不把用户输入当作格式串）
+static void expand_name(const char *pattern, int seq, char *out, size_t len) {
+    size_t o = 0;
+    for (const char *p = pattern; *p && o + 1 < len; p++) {
+        if (p[0] == '%' && p[1] == 'd') {
+            int n = snprintf(out + o, len - o, "%d", seq);
+            if (n < 0) break;
+            o += (size_t)n;
+            if (o >= len) o = len - 1;
+            p++;
+        } else if (p[0] == '%' && p[1] == '%') {
+            out[o++] = '%';
+            p++;
+        } else {
+            out[o++] = *p;
+        }
+    }
+    out[o] = '\0';
+}
+
+// 判断是否为磁盘配置项 (scsi0, virtio1, sata0, ide0, efidisk0, tpmstate0)
+static bool is_disk_key(const char *key) {
+    static const char *prefixes[] = { "scsi", "virtio", "sata", "ide", "efidisk", "tpmstate" };
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        size_t n = strlen(prefixes[i]);
+        if (strncmp(key, prefixes[i], n) == 0 && isdigit((unsigned char)key[n])) {
+            const char *p = key + n;
+            while (isdigit((unsigned char)*p)) p++;
+            return *p == '\0';
+        }
+    }
+    return false;
+}
+
+// 读取源 VM 配置：是否为模板以及各磁盘所在存储
+static int load_source(int vmid, const char *node, SourceInfo *info) {
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/config", node, vmid);
+    
+    cJSON *response = api_get(endpoint);
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsObject(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    memset(info, 0, sizeof(*info));
+    info->is_template = json_get_int(data, "template", 0) == 1 ||
+                        strcmp(json_get_string(data, "template", "0"), "1") == 0;
+    
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        if (!cJSON_IsString(item) || !is_disk_key(item->string)) continue;
+        
+        const char *value = item->valuestring;
+        const char *colon = strchr(value, ':');
+        if (!colon || strstr(value, "media=cdrom") || strncmp(value, "none", 4) == 0) continue;
+        if (info->disk_count >= 16) break;
+        
+        int idx = info->disk_count++;
+        size_t n = (size_t)(colon - value);
+        if (n >= sizeof(info->storages[idx])) n = sizeof(info->storages[idx]) - 1;
+        memcpy(info->storages[idx], value, n);
+        info->storages[idx][n] = '\0';
+        
+        const char *comma = strchr(value, ',');
+        size_t vlen = comma ? (size_t)(comma - value) : strlen(value);
+        info->qcow2[idx] = (vlen > 6 && strncmp(value + vlen - 6, ".qcow2", 6) == 0) ||
+                           strstr(value, "format=qcow2") != NULL;
+    }
+    
+    cJSON_Delete(response);
+    return 0;
+}
+
+// 查询存储类型 (lvmthin, zfspool, rbd, dir, ...)
+static int storage_type(const char *node, const char *storage, char *type, size_t len) {
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/storage/%s/status", node, storage);
+    
+    cJSON *response = api_get(endpoint);
+    const char *t = json_get_string(response ? cJSON_GetObjectItem(response, "data") : NULL,
+                                    "type", NULL);
+    snprintf(type, len, "%s", t ? t : "");
+    cJSON_Delete(response);
+    return t ? 0 : -1;
+}
+
+// 所有磁盘所在存储都支持链接克隆时返回 true
+static bool supports_linked(const char *node, const SourceInfo *info) {
+    static const char *thin_types[] = { "lvmthin", "zfspool", "zfs", "rbd" };
+    static const char *file_types[] = { "dir", "nfs", "cifs", "glusterfs", "cephfs" };
+    
+    if (!info->is_template || info->disk_count == 0) return false;
+    
+    for (int i = 0; i < info->disk_count; i++) {
+        char type[32];
+        if (storage_type(node, info->storages[i], type, sizeof(type)) != 0) return false;
+        
+        bool ok = false;
+        for (size_t j = 0; j < sizeof(thin_types) / sizeof(thin_types[0]); j++) {
+            if (strcmp(type, thin_types[j]) == 0) ok = true;
+        }
+        // 文件型存储只有 qcow2 镜像支持链接克隆
+        for (size_t j = 0; j < sizeof(file_types) / sizeof(file_types[0]); j++) {
+            if (strcmp(type, file_types[j]) == 0 && info->qcow2[i]) ok = true;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// 分配 count 个可用 VMID；显式指定起始 ID 时要求连续且全部空闲
+static int allocate_ids(CloneRun *run) {
+    const CloneOptions *opts = run->opts;
+    int next = opts->start_id;
+    
+    if (next <= 0) {
+        cJSON *response = api_get("/api2/json/cluster/nextid");
+        cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+        if (cJSON_IsString(data)) {
+            next = atoi(data->valuestring);
+        } else if (cJSON_IsNumber(data)) {
+            next = data->valueint;
+        }
+        cJSON_Delete(response);
+        if (next <= 0) {
+            fprintf(stderr, "错误：无法获取可用的 VMID\n");
+            return -1;
+        }
+    }
+    
+    // 加载失败时 api_vmid_exists 把所有 ID 都当作空闲，不能继续分配
+    if (api_load_node_cache() != 0) {
+        fprintf(stderr, "错误：无法获取集群中已使用的 VMID: %s\n", api_last_error());
+        return -1;
+    }
+    
+    for (int i = 0; i < run->count; i++) {
+        while (api_vmid_exists(next)) {
+            if (opts->start_id > 0) {
+                fprintf(stderr, "错误：VMID %d 已存在\n", next);
+                return -1;
+            }
+            next++;
+        }
+        run->jobs[i].newid = next++;
+        if (opts->name_pattern[0]) {
+            expand_name(opts->name_pattern, i + 1, run->jobs[i].name, sizeof(run->jobs[i].name));
+        }
+    }
+    return 0;
+}
+
+static void report(CloneRun *run, CloneJob *job) {
+    pthread_mutex_lock(&run->progress_lock);
+    run->done++;
+    if (job->ret != 0) run->failed++;
+    
+    if (run->show_progress) {
+        fprintf(stderr, "\r\033[K");
+    }
+    if (job->ret != 0) {
+        fprintf(stderr, "\033[31m✗\033[0m VM %d 克隆失败: %s\n", job->newid, job->error);
+    } else {
+        printf("\033[32m✓\033[0m VM %d%s%s%s 克隆完成 (%.1fs)\n", job->newid,
+               job->name[0] ? " (" : "", job->name, job->name[0] ? ")" : "", job->elapsed);
+        fflush(stdout);
+    }
+    if (run->show_progress) {
+        progress_draw("克隆", run->done, run->failed, run->count);
+    }
+    pthread_mutex_unlock(&run->progress_lock);
+}
+
+static void clone_worker(int index, void *arg) {
+    CloneRun *run = (CloneRun *)arg;
+    const CloneOptions *opts = run->opts;
+    CloneJob *job = &run->jobs[index];
+    
+    // 链接克隆只写元数据，不占用存储带宽，不受每存储并发限制
+    if (!run->linked) {
+        keyed_limit_acquire(&run->storage_limit, run->limit_key);
+    }
+    double start = now_monotonic();
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/clone",
+             run->node, opts->source);
+    
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddNumberToObject(body, "newid", job->newid);
+    if (job->name[0]) cJSON_AddStringToObject(body, "name", job->name);
+    cJSON_AddBoolToObject(body, "full", !run->linked);
+    if (!run->linked && opts->storage[0]) cJSON_AddStringToObject(body, "storage", opts->storage);
+    if (opts->target[0]) cJSON_AddStringToObject(body, "target", opts->target);
+    
+    cJSON *response = api_post(endpoint, body);
+    cJSON_Delete(body);
+    
+    char upid[256];
+    if (api_response_upid(response, upid, sizeof(upid)) != 0) {
+        snprintf(job->error, sizeof(job->error), "%s", api_last_error());
+        job->ret = -1;
+    } else if (upid[0]) {
+        char exitstatus[128];
+        if (api_wait_task(upid, opts->timeout, exitstatus, sizeof(exitstatus)) != 0) {
+            snprintf(job->error, sizeof(job->error), "任务失败: %s", exitstatus);
+            job->ret = -1;
+        }
+    }
+    cJSON_Delete(response);
+    
+    job->elapsed = now_monotonic() - start;
+    if (!run->linked) {
+        keyed_limit_release(&run->storage_limit, run->limit_key);
+    }
+    
+    report(run, job);
+}
+
+// 从模板批量克隆
+int clone_run(const CloneOptions *opts) {
+    if (!opts || opts->source <= 0 || opts->count <= 0) return -1;
+    
+    CloneRun run = { .opts = opts, .count = opts->count };
+    if (api_resolve_node(opts->source, run.node, sizeof(run.node)) != 0 && g_debug) {
+        fprintf(stderr, "VM %d 未在集群资源中找到，使用节点 %s\n", opts->source, run.node);
+    }
+    
+    SourceInfo info;
+    if (load_source(opts->source, run.node, &info) != 0) {
+        fprintf(stderr, "错误：无法读取 VM %d 的配置: %s\n", opts->source, api_last_error());
+        return -1;
+    }
+    
+    // 目标存储与源不同时只能完整克隆
+    bool can_link = opts->storage[0] == '\0' && supports_linked(run.node, &info);
+    if (opts->mode == CLONE_LINKED && !can_link) {
+        fprintf(stderr, "错误：VM %d 不能链接克隆（需为模板且存储支持链接克隆）\n", opts->source);
+        return -1;
+    }
+    run.linked = (opts->mode != CLONE_FULL) && can_link;
+    
+    snprintf(run.limit_key, sizeof(run.limit_key), "%s",
+             opts->storage[0] ? opts->storage : (info.disk_count > 0 ? info.storages[0] : ""));
+    
+    run.jobs = calloc((size_t)opts->count, sizeof(CloneJob));
+    if (!run.jobs) return -1;
+    
+    if (allocate_ids(&run) != 0) {
+        free(run.jobs);
+        return -1;
+    }
+    
+    // 非模板克隆时 PVE 会锁定源 VM，只能逐个执行
+    int workers = g_parallel;
+    if (!info.is_template) {
+        workers = 1;
+        printf("\033[33m提示：VM %d 不是模板，克隆将逐个执行\033[0m\n", opts->source);
+    }
+    
+    printf("从 VM %d (节点 %s) %s克隆 %d 个 VM: %d-%d\n", opts->source, run.node,
+           run.linked ? "链接" : "完整", opts->count,
+           run.jobs[0].newid, run.jobs[opts->count - 1].newid);
+    fflush(stdout);
+    
+    keyed_limit_init(&run.storage_limit, opts->per_storage);
+    pthread_mutex_init(&run.progress_lock, NULL);
+    run.show_progress = isatty(STDERR_FILENO) && !g_debug;
+    if (run.show_progress) {
+        progress_draw("克隆", 0, 0, run.count);
+    }
+    
+    double start = now_monotonic();
+    pool_run(opts->count, workers, clone_worker, &run);
+    
+    if (run.show_progress) {
+        fprintf(stderr, "\r\033[K");
+    }
+    printf("\n克隆 总计: \033[32m%d 成功\033[0m, \033[31m%d 失败\033[0m (%.1fs)\n",
+           run.done - run.failed, run.failed, now_monotonic() - start);
+    
+    // 新 VM 已加入集群，节点缓存失效
+    api_invalidate_node_cache();
+    
+    int ret = (run.failed > 0) ? 1 : 0;
+    pthread_mutex_destroy(&run.progress_lock);
+    keyed_limit_destroy(&run.storage_limit);
+    free(run.jobs);
+    return ret;
+}
@@ -0,0 +1,420 @@
+/*
+ * 多集群操作
+ * 对多个独立集群并发执行 list/status/操作命令，合并结果输出，
+ * 单个集群不可达时只报告该集群失败，不影响其他集群
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <unistd.h>
+
+typedef struct {
+    bool reachable;
+    char error[256];
+    int success;
+    int failed;
+    int matched;            // 该集群中存在的目标 VM 数
+} ClusterResult;
+
+// 记录当前线程最近一次请求的错误
+static void record_error(ClusterResult *r) {
+    const char *err = api_last_error();
+    long code = api_last_http_code();
+    
+    if (err[0] != '\0' && code > 0) {
+        snprintf(r->error, sizeof(r->error), "HTTP %ld %s", code, err);
+    } else if (err[0] != '\0') {
+        snprintf(r->error, sizeof(r->error), "%s", err);
+    } else if (code > 0) {
+        snprintf(r->error, sizeof(r->error), "HTTP %ld", code);
+    } else {
+        snprintf(r->error, sizeof(r->error), "请求失败");
+    }
+}
+
+// 输出不可达集群，返回失败的集群数
+static int report_failures(const Config *clusters, const ClusterResult *results, int count) {
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].reachable) continue;
+        fprintf(stderr, "\033[31m✗\033[0m 集群 %s (%s): %s\n",
+                clusters[i].name, clusters[i].host, results[i].error);
+        failed++;
+    }
+    return failed;
+}
+
+// 解析 --cluster 参数：all 或逗号分隔的集群名称
+int cluster_select(const char *spec, const Config *all, int count, Config *out, int max) {
+    if (!spec || !all || !out) return -1;
+    
+    if (strcmp(spec, "all") == 0) {
+        int n = count < max ? count : max;
+        memcpy(out, all, (size_t)n * sizeof(Config));
+        return n;
+    }
+    
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    
+    int n = 0;
+    char *saveptr = NULL;
+    for (char *name = strtok_r(buf, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+        int found = -1;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(all[i].name, name) == 0) {
+                found = i;
+                break;
+            }
+        }
+        
+        if (found < 0) {
+            fprintf(stderr, "错误：未知集群: %s\n", name);
+            fprintf(stderr, "可用集群:");
+            for (int i = 0; i < count; i++) {
+                fprintf(stderr, " %s", all[i].name);
+            }
+            fprintf(stderr, "\n");
+            return -1;
+        }
+        
+        bool dup = false;
+        for (int i = 0; i < n; i++) {
+            if (strcmp(out[i].name, name) == 0) dup = true;
+        }
+        if (!dup && n < max) {
+            out[n++] = all[found];
+        }
+    }
+    
+    return n;
+}
+
+// ---- list ----
+
+typedef struct {
+    Config *clusters;
+    ClusterResult *results;
+    VMInfo **vms;
+    int *counts;
+} ListRun;
+
+typedef struct {
+    int cluster;
+    VMInfo *vm;
+} ListRow;
+
+static void list_worker(int index, void *arg) {
+    ListRun *run = (ListRun *)arg;
+    ClusterResult *r = &run->results[index];
+    
+    api_use_config(&run->clusters[index]);
+    if (api_get_vm_list(&run->vms[index], &run->counts[index], g_cache_ttl) == 0) {
+        r->reachable = true;
+    } else {
+        record_error(r);
+    }
+    api_use_config(NULL);
+}
+
+static int cmp_list_row(const void *a, const void *b) {
+    const ListRow *x = a, *y = b;
+    if (x->cluster != y->cluster) return x->cluster - y->cluster;
+    return x->vm->vmid - y->vm->vmid;
+}
+
+int cluster_list(Config *clusters, int count) {
+    if (!clusters || count <= 0) return -1;
+    
+    ClusterResult *results = calloc((size_t)count, sizeof(ClusterResult));
+    VMInfo **vms = calloc((size_t)count, sizeof(VMInfo *));
+    int *counts = calloc((size_t)count, sizeof(int));
+    if (!results || !vms || !counts) {
+        free(results);
+        free(vms);
+        free(counts);
+        return -1;
+    }
+    
+    ListRun run = { .clusters = clusters, .results = results, .vms = vms, .counts = counts };
+    pool_run(count, count, list_worker, &run);
+    
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].reachable) total += counts[i];
+    }
+    
+    ListRow *rows = calloc(total > 0 ? (size_t)total : 1, sizeof(ListRow));
+    int n = 0;
+    for (int i = 0; rows && i < count; i++) {
+        if (!results[i].reachable) continue;
+        for (int j = 0; j < counts[i]; j++) {
+            rows[n].cluster = i;
+            rows[n].vm = &vms[i][j];
+            n++;
+        }
+    }
+    if (rows) {
+        qsort(rows, (size_t)n, sizeof(ListRow), cmp_list_row);
+    }
+    
+    static const TableColumn list_columns[] = {
+        { "CLUSTER", false },
+        { "VMID", false },
+        { "NAME", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+    };
+    Table table;
+    table_init(&table, list_columns, 6);
+    
+    char mem[FORMAT_LEN];
+    for (int i = 0; i < n; i++) {
+        VMInfo *vm = rows[i].vm;
+        table_cell(&table, "%s", clusters[rows[i].cluster].name);
+        table_cell(&table, "%d", vm->vmid);
+        table_cell(&table, "%s", vm->name);
+        table_cell(&table, "%s", vm->status);
+        table_cell(&table, "%.1f%%", vm->cpu_percent);
+        table_cell(&table, "%s", format_bytes(vm->mem, mem, sizeof(mem)));
+    }
+    if (table_write(&table, STDOUT_FILENO) != 0) {
+        fprintf(stderr, "错误：无法输出 VM 列表\n");
+    }
+    table_free(&table);
+    
+    int failed = report_failures(clusters, results, count);
+    printf("\n共 %d 个虚拟机，%d/%d 个集群可用\n", n, count - failed, count);
+    
+    for (int i = 0; i < count; i++) {
+        free(vms[i]);
+    }
+    free(rows);
+    free(vms);
+    free(counts);
+    free(results);
+    return failed > 0 ? -1 : 0;
+}
+
+// ---- status 和 VM 操作 ----
+
+// 作业按 (集群, VMID) 展开，所有集群的所有 VM 共用一个线程池
+typedef struct {
+    Config *clusters;
+    ClusterResult *results;
+    int cluster_count;
+    const int *vmids;
+    int vmid_count;
+    const char *action;     // NULL 表示查询状态
+    const char *label;
+    VMInfo *status;         // 查询结果 [cluster * vmid_count + j]
+    bool *present;
+    pthread_mutex_t lock;
+} VMRun;
+
+// 探测集群是否可达，同时加载 VMID -> 节点缓存
+static void probe_worker(int index, void *arg) {
+    VMRun *run = (VMRun *)arg;
+    ClusterResult *r = &run->results[index];
+    
+    api_use_config(&run->clusters[index]);
+    if (api_load_node_cache() == 0) {
+        r->reachable = true;
+    } else {
+        record_error(r);
+    }
+    api_use_config(NULL);
+}
+
+static void vm_worker(int index, void *arg) {
+    VMRun *run = (VMRun *)arg;
+    int c = index / run->vmid_count;
+    int vmid = run->vmids[index % run->vmid_count];
+    Config *cluster = &run->clusters[c];
+    ClusterResult *r = &run->results[c];
+    
+    if (!r->reachable) return;
+    
+    api_use_config(cluster);
+    
+    // VMID 在各集群中独立分配，只处理该集群中存在的 VM（同号的 LXC 容器不算）
+    char node[64];
+    if (api_resolve_node(vmid, node, sizeof(node)) != 0) {
+        api_use_config(NULL);
+        return;
+    }
+    
+    int ret;
+    if (!run->action) {
+        ret = api_get_vm_status(vmid, &run->status[index], g_cache_ttl);
+    } else if (strcmp(run->action, "destroy") == 0) {
+        // 与 vm_destroy 一致：先停止再删除
+        api_vm_action(vmid, "stop");
+        sleep(2);
+        ret = api_vm_action(vmid, "destroy");
+    } else {
+        ret = api_vm_action(vmid, run->action);
+    }
+    
+    pthread_mutex_lock(&run->lock);
+    run->present[index] = true;
+    r->matched++;
+    if (ret == 0) {
+        r->success++;
+    } else {
+        r->failed++;
+    }
+    if (run->action) {
+        if (ret == 0) {
+            printf("\033[32m✓\033[0m [%s] VM %d %s成功\n", cluster->name, vmid, run->label);
+        } else {
+            fprintf(stderr, "\033[31m✗\033[0m [%s] VM %d %s失败\n", cluster->name, vmid, run->label);
+        }
+    }
+    pthread_mutex_unlock(&run->lock);
+    
+    api_use_config(NULL);
+}
+
+static int run_vm_jobs(VMRun *run) {
+    int c = run->cluster_count;
+    int jobs = c * run->vmid_count;
+    
+    run->results = calloc((size_t)c, sizeof(ClusterResult));
+    run->present = calloc((size_t)jobs, sizeof(bool));
+    run->status = run->action ? NULL : calloc((size_t)jobs, sizeof(VMInfo));
+    if (!run->results || !run->present || (!run->action && !run->status)) {
+        return -1;
+    }
+    pthread_mutex_init(&run->lock, NULL);
+    
+    pool_run(c, c, probe_worker, run);
+    pool_run(jobs, g_parallel, vm_worker, run);
+    
+    pthread_mutex_destroy(&run->lock);
+    return 0;
+}
+
+// 输出在所有可达集群中都不存在的 VMID，返回其数量
+static int report_missing(const VMRun *run) {
+    int missing = 0;
+    for (int j = 0; j < run->vmid_count; j++) {
+        bool found = false;
+        for (int c = 0; c < run->cluster_count; c++) {
+            if (run->present[c * run->vmid_count + j]) found = true;
+        }
+        if (!found) {
+            fprintf(stderr, "\033[31m✗\033[0m VM %d 在可用集群中不存在\n", run->vmids[j]);
+            missing++;
+        }
+    }
+    return missing;
+}
+
+static void free_vm_run(VMRun *run) {
+    free(run->results);
+    free(run->present);
+    free(run->status);
+}
+
+int cluster_status(Config *clusters, int count, const int *vmids, int vmid_count) {
+    if (!clusters || count <= 0 || !vmids || vmid_count <= 0) return -1;
+    
+    VMRun run = {
+        .clusters = clusters, .cluster_count = count,
+        .vmids = vmids, .vmid_count = vmid_count
+    };
+    if (run_vm_jobs(&run) != 0) {
+        free_vm_run(&run);
+        return -1;
+    }
+    
+    static const TableColumn status_columns[] = {
+        { "CLUSTER", false },
+        { "VMID", false },
+        { "NAME", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+        { "UPTIME", true },
+        { "IP", false },
+    };
+    Table table;
+    table_init(&table, status_columns, 8);
+    
+    int failed = 0;
+    char mem[FORMAT_LEN], maxmem[FORMAT_LEN], uptime[FORMAT_LEN];
+    for (int c = 0; c < count; c++) {
+        for (int j = 0; j < vmid_count; j++) {
+            int index = c * vmid_count + j;
+            if (!run.present[index]) continue;
+            
+            VMInfo *vm = &run.status[index];
+            if (vm->vmid == 0) {
+                fprintf(stderr, "\033[31m✗\033[0m [%s] 无法获取 VM %d 的状态\n",
+                        clusters[c].name, vmids[j]);
+                failed++;
+                continue;
+            }
+            
+            table_cell(&table, "%s", clusters[c].name);
+            table_cell(&table, "%d", vm->vmid);
+            table_cell(&table, "%s", vm->name);
+            table_cell(&table, "%s", vm->status);
+            table_cell(&table, "%.1f%%", vm->cpu_percent);
+            table_cell(&table, "%s / %s", format_bytes(vm->mem, mem, sizeof(mem)),
+                       format_bytes(vm->maxmem, maxmem, sizeof(maxmem)));
+            table_cell(&table, "%s", format_uptime(vm->uptime, uptime, sizeof(uptime)));
+            table_cell(&table, "%s", vm->ip_address);
+        }
+    }
+    if (table_write(&table, STDOUT_FILENO) != 0) {
+        fprintf(stderr, "错误：无法输出 VM 状态\n");
+    }
+    table_free(&table);
+    
+    int unreachable = report_failures(clusters, run.results, count);
+    int missing = report_missing(&run);
+    
+    free_vm_run(&run);
+    return (failed + unreachable + missing) > 0 ? -1 : 0;
+}
+
+int cluster_action(Config *clusters, int count, const int *vmids, int vmid_count,
+                   const char *action, const char *label) {
+    if (!clusters || count <= 0 || !vmids || vmid_count <= 0 || !action) return -1;
+    
+    VMRun run = {
+        .clusters = clusters, .cluster_count = count,
+        .vmids = vmids, .vmid_count = vmid_count,
+        .action = action, .label = label ? label : action
+    };
+    if (run_vm_jobs(&run) != 0) {
+        free_vm_run(&run);
+        return -1;
+    }
+    
+    int unreachable = report_failures(clusters, run.results, count);
+    int missing = report_missing(&run);
+    
+    // 按集群汇总
+    int success = 0, failed = 0;
+    printf("\n%s 汇总:\n", run.label);
+    for (int c = 0; c < count; c++) {
+        const ClusterResult *r = &run.results[c];
+        if (!r->reachable) {
+            printf("  %-12s \033[31m不可达\033[0m\n", clusters[c].name);
+            continue;
+        }
+        printf("  %-12s \033[32m%d 成功\033[0m, \033[31m%d 失败\033[0m\n",
+               clusters[c].name, r->success, r->failed);
+        success += r->success;
+        failed += r->failed;
+    }
+    printf("%s 总计: \033[32m%d 成功\033[0m, \033[31m%d 失败\033[0m, %d 个集群不可达\n",
+           run.label, success, failed, unreachable);
+    
+    free_vm_run(&run);
+    return (failed + unreachable + missing) > 0 ? -1 : 0;
+}
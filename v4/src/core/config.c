@@ -6,7 +6,10 @@
 #define _POSIX_C_SOURCE 200809L
 #include "../../include/vmanager.h"
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
 
 #define MAX_LINE_LENGTH 1024
 
@@ -43,12 +46,45 @@ bool is_on_pve_server(void) {
     return false;
 }
 
-// 加载配置文件
-int config_load(Config *config, const char *file) {
-    if (!config || !file) {
-        return -1;
+// 设置配置项
+static void config_set(Config *config, const char *key, const char *value) {
+    if (strcmp(key, "name") == 0) {
+        strncpy(config->name, value, sizeof(config->name) - 1);
+    } else if (strcmp(key, "host") == 0) {
+        strncpy(config->host, value, sizeof(config->host) - 1);
+    } else if (strcmp(key, "port") == 0) {
+        config->port = atoi(value);
+    } else if (strcmp(key, "node") == 0) {
+        strncpy(config->node, value, sizeof(config->node) - 1);
+    } else if (strcmp(key, "verify_ssl") == 0) {
+        config->verify_ssl = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+    } else if (strcmp(key, "token_id") == 0) {
+        strncpy(config->token_id, value, sizeof(config->token_id) - 1);
+    } else if (strcmp(key, "token_secret") == 0) {
+        strncpy(config->token_secret, value, sizeof(config->token_secret) - 1);
+    } else if (strcmp(key, "username") == 0) {
+        strncpy(config->username, value, sizeof(config->username) - 1);
+    } else if (strcmp(key, "password") == 0) {
+        strncpy(config->password, value, sizeof(config->password) - 1);
     }
-    
+}
+
+// [auth] 节中的键
+static bool is_auth_key(const char *key) {
+    return strcmp(key, "token_id") == 0 || strcmp(key, "token_secret") == 0 ||
+           strcmp(key, "username") == 0 || strcmp(key, "password") == 0;
+}
+
+// 必需字段是否齐全；用户名认证的密码可以来自环境变量，不要求写在配置中
+static bool config_complete(const Config *config) {
+    bool token = config->token_id[0] != '\0' && config->token_secret[0] != '\0';
+    return config->host[0] != '\0' && config->port != 0 &&
+           config->node[0] != '\0' && (token || config->username[0] != '\0');
+}
+
+// 解析配置文件：[server]/[auth] 写入 config，[cluster NAME] 写入 clusters
+static int config_parse(const char *file, Config *config,
+                        Config *clusters, int max_clusters, int *cluster_count) {
     FILE *fp = fopen(file, "r");
     if (!fp) {
         if (g_debug) {
@@ -59,6 +95,7 @@ int config_load(Config *config, const char *file) {
     
     char line[MAX_LINE_LENGTH];
     char section[64] = "";
+    Config *cluster = NULL;
     int line_num = 0;
     
     while (fgets(line, sizeof(line), fp)) {
@@ -77,6 +114,19 @@ int config_load(Config *config, const char *file) {
                 *end = '\0';
                 strncpy(section, trimmed + 1, sizeof(section) - 1);
                 section[sizeof(section) - 1] = '\0';
+                
+                // 集群配置节 [cluster NAME]
+                cluster = NULL;
+                if (strncmp(section, "cluster ", 8) == 0 && clusters) {
+                    char *name = trim(section + 8);
+                    if (*cluster_count < max_clusters && name[0] != '\0') {
+                        cluster = &clusters[(*cluster_count)++];
+                        memset(cluster, 0, sizeof(*cluster));
+                        strncpy(cluster->name, name, sizeof(cluster->name) - 1);
+                    } else {
+                        fprintf(stderr, "警告：忽略集群配置 [%s] (行 %d)\n", section, line_num);
+                    }
+                }
             }
             continue;
         }
@@ -95,31 +145,35 @@ int config_load(Config *config, const char *file) {
         char *value = trim(eq + 1);
         
         // 根据节和键设置配置
-        if (strcmp(section, "server") == 0 || section[0] == '\0') {
-            if (strcmp(key, "host") == 0) {
-                strncpy(config->host, value, sizeof(config->host) - 1);
-            } else if (strcmp(key, "port") == 0) {
-                config->port = atoi(value);
-            } else if (strcmp(key, "node") == 0) {
-                strncpy(config->node, value, sizeof(config->node) - 1);
-            } else if (strcmp(key, "verify_ssl") == 0) {
-                config->verify_ssl = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        if (cluster) {
+            config_set(cluster, key, value);
+        } else if (strcmp(section, "server") == 0 || section[0] == '\0') {
+            if (!is_auth_key(key)) {
+                config_set(config, key, value);
             }
         } else if (strcmp(section, "auth") == 0) {
-            if (strcmp(key, "token_id") == 0) {
-                strncpy(config->token_id, value, sizeof(config->token_id) - 1);
-            } else if (strcmp(key, "token_secret") == 0) {
-                strncpy(config->token_secret, value, sizeof(config->token_secret) - 1);
+            if (is_auth_key(key)) {
+                config_set(config, key, value);
             }
         }
     }
     
     fclose(fp);
+    return 0;
+}
+
+// 加载配置文件
+int config_load(Config *config, const char *file) {
+    if (!config || !file) {
+        return -1;
+    }
+    
+    if (config_parse(file, config, NULL, 0, NULL) != 0) {
+        return -1;
+    }
     
     // 验证必需字段
-    if (config->host[0] == '\0' || config->port == 0 || 
-        config->node[0] == '\0' || config->token_id[0] == '\0' || 
-        config->token_secret[0] == '\0') {
+    if (!config_complete(config)) {
         if (g_debug) {
             fprintf(stderr, "配置文件缺少必需字段\n");
         }
@@ -130,14 +184,91 @@ int config_load(Config *config, const char *file) {
     return 0;
 }
 
+// 加载所有集群配置
+// [server]/[auth] 配置完整时作为第一个集群（名称取 name，默认 "default"），
+// 每个 [cluster NAME] 节中未设置的字段继承 [server]/[auth] 的值
+int config_load_clusters(const char *file, Config *clusters, int max_clusters) {
+    if (!file || !clusters || max_clusters <= 0) {
+        return -1;
+    }
+    
+    Config base = {0};
+    Config *named = calloc((size_t)max_clusters, sizeof(Config));
+    if (!named) {
+        return -1;
+    }
+    
+    int named_count = 0;
+    if (config_parse(file, &base, named, max_clusters, &named_count) != 0) {
+        free(named);
+        return -1;
+    }
+    
+    int count = 0;
+    if (config_complete(&base)) {
+        clusters[count] = base;
+        if (clusters[count].name[0] == '\0') {
+            snprintf(clusters[count].name, sizeof(clusters[count].name), "default");
+        }
+        strncpy(clusters[count].config_file, file, sizeof(clusters[count].config_file) - 1);
+        count++;
+    }
+    
+    for (int i = 0; i < named_count; i++) {
+        Config *c = &named[i];
+        if (c->host[0] == '\0') memcpy(c->host, base.host, sizeof(c->host));
+        if (c->port == 0) c->port = base.port ? base.port : 8006;
+        if (c->node[0] == '\0') memcpy(c->node, base.node, sizeof(c->node));
+        // 集群自己设置了一种认证方式时不继承另一种
+        bool own_token = c->token_id[0] != '\0' || c->token_secret[0] != '\0';
+        bool own_user = c->username[0] != '\0';
+        if (!own_user) {
+            if (c->token_id[0] == '\0') memcpy(c->token_id, base.token_id, sizeof(c->token_id));
+            if (c->token_secret[0] == '\0') memcpy(c->token_secret, base.token_secret, sizeof(c->token_secret));
+        }
+        if (!own_token) {
+            if (c->username[0] == '\0') memcpy(c->username, base.username, sizeof(c->username));
+            if (c->password[0] == '\0') memcpy(c->password, base.password, sizeof(c->password));
+        }
+        
+        if (!config_complete(c)) {
+            fprintf(stderr, "警告：集群 %s 配置不完整，已忽略\n", c->name);
+            continue;
+        }
+        
+        bool dup = false;
+        for (int j = 0; j < count; j++) {
+            if (strcmp(clusters[j].name, c->name) == 0) dup = true;
+        }
+        if (dup) {
+            fprintf(stderr, "警告：集群名称重复: %s，已忽略\n", c->name);
+            continue;
+        }
+        if (count >= max_clusters) {
+            fprintf(stderr, "警告：集群数量超过上限 %d\n", max_clusters);
+            break;
+        }
+        
+        clusters[count] = *c;
+        strncpy(clusters[count].config_file, file, sizeof(clusters[count].config_file) - 1);
+        count++;
+    }
+    
+    free(named);
+    return count;
+}
+
 // 保存配置文件
 int config_save(Config *config, const char *file) {
     if (!config || !file) {
         return -1;
     }
     
-    FILE *fp = fopen(file, "w");
+    // 配置中有密钥，创建时就只允许所有者读写
+    int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
     if (!fp) {
+        if (fd >= 0) close(fd);
         fprintf(stderr, "无法创建配置文件: %s (%s)\n", file, strerror(errno));
         return -1;
     }
@@ -146,14 +277,33 @@ int config_save(Config *config, const char *file) {
     fprintf(fp, "# 自动生成于 %s\n\n", __DATE__);
     
     fprintf(fp, "[server]\n");
+    if (config->name[0] != '\0') {
+        fprintf(fp, "name = %s\n", config->name);
+    }
     fprintf(fp, "host = %s\n", config->host);
     fprintf(fp, "port = %d\n", config->port);
     fprintf(fp, "node = %s\n", config->node);
     fprintf(fp, "verify_ssl = %s\n\n", config->verify_ssl ? "true" : "false");
     
     fprintf(fp, "[auth]\n");
-    fprintf(fp, "token_id = %s\n", config->token_id);
-    fprintf(fp, "token_secret = %s\n\n", config->token_secret);
+    if (config->token_id[0] != '\0') {
+        fprintf(fp, "token_id = %s\n", config->token_id);
+        fprintf(fp, "token_secret = %s\n\n", config->token_secret);
+    } else {
+        fprintf(fp, "username = %s\n", config->username);
+        if (config->password[0] != '\0') {
+            fprintf(fp, "password = %s\n\n", config->password);
+        } else {
+            fprintf(fp, "# 密码从环境变量 VMANAGER_PASSWORD 读取\n\n");
+        }
+    }
+    
+    fprintf(fp, "# 其他集群 (可选)，未设置的字段继承 [server]/[auth]\n");
+    fprintf(fp, "#[cluster prod-a]\n");
+    fprintf(fp, "#host = 10.0.1.10\n");
+    fprintf(fp, "#node = pve1\n");
+    fprintf(fp, "#token_id = root@pam!vmanager\n");
+    fprintf(fp, "#token_secret = xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx\n\n");
     
     fprintf(fp, "# UI 配置 (可选)\n");
     fprintf(fp, "#[ui]\n");
@@ -176,6 +326,26 @@ int config_save(Config *config, const char *file) {
     return 0;
 }
 
+// 读取一行且不回显（输入密码），去掉结尾换行
+static int read_secret(char *buf, size_t len) {
+    struct termios saved;
+    bool tty = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (tty) {
+        struct termios quiet = saved;
+        quiet.c_lflag &= (tcflag_t)~ECHO;
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &quiet);
+    }
+    
+    int ret = fgets(buf, (int)len, stdin) ? 0 : -1;
+    
+    if (tty) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved);
+        printf("\n");
+    }
+    if (ret == 0) buf[strcspn(buf, "\r\n")] = '\0';
+    return ret;
+}
+
 // 配置向导
 int config_wizard(Config *config) {
     if (!config) {
@@ -221,7 +391,7 @@ int config_wizard(Config *config) {
     // 认证方式
     printf("\n认证方式:\n");
     printf("  1. API Token (推荐)\n");
-    printf("  2. 用户名密码 (暂未实现)\n");
+    printf("  2. 用户名密码 (登录票据缓存 2 小时，不支持双因素认证)\n");
     printf("选择 [1]: ");
     
     int auth_method = 1;
@@ -248,8 +418,22 @@ int config_wizard(Config *config) {
                 strncpy(config->token_secret, trimmed, sizeof(config->token_secret) - 1);
             }
         }
+    } else if (auth_method == 2) {
+        printf("\n用户名 (例如: root@pam): ");
+        if (fgets(input, sizeof(input), stdin)) {
+            char *trimmed = trim(input);
+            if (trimmed[0] != '\0') {
+                strncpy(config->username, trimmed, sizeof(config->username) - 1);
+            }
+        }
+        
+        printf("密码 (留空则运行时从 VMANAGER_PASSWORD 读取): ");
+        fflush(stdout);
+        if (read_secret(config->password, sizeof(config->password)) != 0) {
+            config->password[0] = '\0';
+        }
     } else {
-        fprintf(stderr, "\n错误：用户名密码认证暂未实现\n");
+        fprintf(stderr, "\n错误：未知的认证方式\n");
         return -1;
     }
     
@@ -261,9 +445,7 @@ int config_wizard(Config *config) {
     }
     
     // 验证配置
-    if (config->host[0] == '\0' || config->port == 0 || 
-        config->node[0] == '\0' || config->token_id[0] == '\0' || 
-        config->token_secret[0] == '\0') {
+    if (!config_complete(config)) {
         fprintf(stderr, "\n错误：配置信息不完整\n");
         return -1;
     }
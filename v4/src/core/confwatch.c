@@ -0,0 +1,325 @@
+/*
+ * VM 配置详情缓存，按配置文件的变化失效
+ * 在 PVE 节点上使用本地后端时，TUI 和 list --watch 用 inotify 监视 /etc/pve/nodes/<节点>/qemu-server/，
+ * api_get_vm_config_details 直接解析本地的 <vmid>.conf，结果一直缓存，
+ * 只有该文件变化后才重新解析，不再每个周期重新请求每个 VM 的配置。
+ * pmxcfs 是 FUSE 文件系统，inotify 只能看到经由本机写入的修改，其他节点写入的修改
+ * 在使用缓存前比较 mtime 和大小发现（一次 stat，不读文件）。
+ * 没有 inotify 的平台上不启用，行为与之前相同
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CONFWATCH_MAX_DIRS 64
+
+typedef struct {
+    int vmid;
+    char node[64];
+    bool valid;             // 已解析，且之后没有收到变化事件
+    time_t mtime;
+    off_t size;
+    AgentState agent;
+    char bridge[32];
+    char storage[64];
+    char tags[128];
+} ConfDetails;
+
+typedef struct {
+    int wd;
+    char node[256];         // 目录名，即节点名
+} WatchDir;
+
+static int watch_fd = -1;
+static WatchDir watch_dirs[CONFWATCH_MAX_DIRS];
+static int watch_dir_count = 0;
+
+static ConfDetails *details = NULL;     // 按 VMID 排序
+static int details_count = 0;
+static int details_cap = 0;
+
+// 上次 confwatch_poll 之后配置变化的 VM
+static EventChanges pending;
+static pthread_mutex_t confwatch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int find_index(int vmid, bool *found) {
+    int lo = 0, hi = details_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (details[mid].vmid < vmid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = lo < details_count && details[lo].vmid == vmid;
+    return lo;
+}
+
+static ConfDetails* find_details(int vmid) {
+    bool found;
+    int i = find_index(vmid, &found);
+    return found ? &details[i] : NULL;
+}
+
+static ConfDetails* add_details(int vmid, const char *node) {
+    bool found;
+    int i = find_index(vmid, &found);
+    if (!found) {
+        if (details_count == details_cap) {
+            int cap = details_cap ? details_cap * 2 : 256;
+            ConfDetails *bigger = realloc(details, (size_t)cap * sizeof(ConfDetails));
+            if (!bigger) return NULL;
+            details = bigger;
+            details_cap = cap;
+        }
+        memmove(&details[i + 1], &details[i], (size_t)(details_count - i) * sizeof(ConfDetails));
+        details_count++;
+        memset(&details[i], 0, sizeof(ConfDetails));
+        details[i].vmid = vmid;
+    }
+    snprintf(details[i].node, sizeof(details[i].node), "%s", node);
+    details[i].valid = false;
+    return &details[i];
+}
+
+static void remove_details(int vmid) {
+    bool found;
+    int i = find_index(vmid, &found);
+    if (!found) return;
+    memmove(&details[i], &details[i + 1], (size_t)(details_count - i - 1) * sizeof(ConfDetails));
+    details_count--;
+}
+
+static void mark_changed(int vmid) {
+    if (pending.full_refresh) return;
+    for (int i = 0; i < pending.count; i++) {
+        if (pending.vmids[i] == vmid) return;
+    }
+    if (pending.count < EVENT_MAX_CHANGES) {
+        pending.vmids[pending.count++] = vmid;
+    } else {
+        pending.full_refresh = true;
+    }
+}
+
+// "<vmid>.conf"，其他文件（编辑器和 pmxcfs 的临时文件）返回 0
+static int conf_vmid(const char *name) {
+    char *end;
+    long vmid = strtol(name, &end, 10);
+    if (end == name || strcmp(end, ".conf") != 0 || vmid <= 0 || vmid > 999999999) return 0;
+    return (int)vmid;
+}
+
+static const char* watch_node(int wd) {
+    for (int i = 0; i < watch_dir_count; i++) {
+        if (watch_dirs[i].wd == wd) return watch_dirs[i].node;
+    }
+    return NULL;
+}
+
+// 读出所有待处理事件：新写入或移入的配置作废缓存，删除或移出的（VM 删除、迁移走）去掉
+static void drain_events(void) {
+    char buf[8192] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = read(watch_fd, buf, sizeof(buf));
+        if (n <= 0) break;   // EAGAIN：没有更多事件
+        
+        for (char *p = buf; p < buf + n; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // 丢了事件，不知道哪些变了
+                for (int i = 0; i < details_count; i++) details[i].valid = false;
+                pending.full_refresh = true;
+                continue;
+            }
+            
+            const char *node = watch_node(ev->wd);
+            int vmid = ev->len > 0 ? conf_vmid(ev->name) : 0;
+            if (!node || vmid == 0) continue;
+            
+            if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                ConfDetails *entry = find_details(vmid);
+                if (entry && strcmp(entry->node, node) == 0) remove_details(vmid);
+            } else {
+                add_details(vmid, node);
+            }
+            mark_changed(vmid);
+        }
+    }
+}
+
+// 监视每个节点的 qemu-server 目录，并记录已有配置所在的节点
+int confwatch_start(const Config *config) {
+    if (watch_fd >= 0) return 0;
+    if (!local_backend_enabled(config)) return -1;
+    
+    const char *root = local_pve_root();
+    char path[512];
+    snprintf(path, sizeof(path), "%s/nodes", root);
+    DIR *nodes = opendir(path);
+    if (!nodes) return -1;
+    
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        closedir(nodes);
+        return -1;
+    }
+    
+    pthread_mutex_lock(&confwatch_lock);
+    watch_fd = fd;
+    struct dirent *node;
+    while ((node = readdir(nodes)) != NULL && watch_dir_count < CONFWATCH_MAX_DIRS) {
+        if (node->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/nodes/%s/qemu-server", root, node->d_name);
+        int wd = inotify_add_watch(fd, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+        if (wd < 0) continue;
+        
+        WatchDir *dir = &watch_dirs[watch_dir_count++];
+        dir->wd = wd;
+        snprintf(dir->node, sizeof(dir->node), "%s", node->d_name);
+        
+        DIR *confs = opendir(path);
+        struct dirent *conf;
+        while (confs && (conf = readdir(confs)) != NULL) {
+            int vmid = conf_vmid(conf->d_name);
+            if (vmid > 0) add_details(vmid, dir->node);
+        }
+        if (confs) closedir(confs);
+    }
+    closedir(nodes);
+    
+    int watched = watch_dir_count, known = details_count;
+    pthread_mutex_unlock(&confwatch_lock);
+    
+    if (watched == 0) {
+        confwatch_stop();
+        return -1;
+    }
+    if (g_debug) {
+        fprintf(stderr, "监视 %d 个节点的 VM 配置目录，已知 %d 个配置\n", watched, known);
+    }
+    return 0;
+}
+
+// 取出上次调用之后配置有变化的 VM；未启用监视时返回 -1
+int confwatch_poll(EventChanges *out) {
+    memset(out, 0, sizeof(*out));
+    if (watch_fd < 0) return -1;
+    
+    pthread_mutex_lock(&confwatch_lock);
+    drain_events();
+    *out = pending;
+    memset(&pending, 0, sizeof(pending));
+    pthread_mutex_unlock(&confwatch_lock);
+    return 0;
+}
+
+// 其他节点迁移过来的 VM：本机看不到 rename 事件，到各节点目录下找一遍
+static ConfDetails* locate(int vmid, struct stat *st) {
+    char path[512];
+    for (int i = 0; i < watch_dir_count; i++) {
+        snprintf(path, sizeof(path), "%s/nodes/%s/qemu-server/%d.conf", local_pve_root(), watch_dirs[i].node, vmid);
+        if (stat(path, st) == 0) return add_details(vmid, watch_dirs[i].node);
+    }
+    return NULL;
+}
+
+// 填入缓存的 agent、网桥、存储、标签和配置文件路径；缓存失效时重新解析本地配置文件。
+// 未启用监视或找不到配置文件时返回 -1，由调用方走 API
+int confwatch_details(int vmid, VMInfo *vm) {
+    if (watch_fd < 0) return -1;
+    
+    pthread_mutex_lock(&confwatch_lock);
+    drain_events();
+    
+    char path[512];
+    struct stat st;
+    ConfDetails *entry = find_details(vmid);
+    if (entry) {
+        snprintf(path, sizeof(path), "%s/nodes/%s/qemu-server/%d.conf", local_pve_root(), entry->node, vmid);
+        if (stat(path, &st) != 0) {
+            remove_details(vmid);
+            entry = NULL;
+        }
+    }
+    if (!entry) entry = locate(vmid, &st);
+    if (!entry) {
+        pthread_mutex_unlock(&confwatch_lock);
+        return -1;
+    }
+    
+    if (!entry->valid || entry->mtime != st.st_mtime || entry->size != st.st_size) {
+        cJSON *data = local_read_vm_config(entry->node, vmid);
+        if (!data) {
+            pthread_mutex_unlock(&confwatch_lock);
+            return -1;
+        }
+        VMInfo parsed = { .vmid = vmid };
+        strcpy(parsed.bridge, "N/A");
+        strcpy(parsed.storage, "N/A");
+        api_parse_vm_config(data, &parsed);
+        cJSON_Delete(data);
+        
+        entry->agent = parsed.agent;
+        memcpy(entry->bridge, parsed.bridge, sizeof(entry->bridge));
+        memcpy(entry->storage, parsed.storage, sizeof(entry->storage));
+        memcpy(entry->tags, parsed.tags, sizeof(entry->tags));
+        entry->mtime = st.st_mtime;
+        entry->size = st.st_size;
+        entry->valid = true;
+    }
+    
+    vm->agent = entry->agent;
+    memcpy(vm->bridge, entry->bridge, sizeof(vm->bridge));
+    memcpy(vm->storage, entry->storage, sizeof(vm->storage));
+    memcpy(vm->tags, entry->tags, sizeof(vm->tags));
+    snprintf(vm->config_file, sizeof(vm->config_file), "%s/nodes/%s/qemu-server/%d.conf",
+             local_pve_root(), entry->node, vmid);
+    pthread_mutex_unlock(&confwatch_lock);
+    return 0;
+}
+
+void confwatch_stop(void) {
+    pthread_mutex_lock(&confwatch_lock);
+    if (watch_fd >= 0) close(watch_fd);
+    watch_fd = -1;
+    watch_dir_count = 0;
+    free(details);
+    details = NULL;
+    details_count = details_cap = 0;
+    memset(&pending, 0, sizeof(pending));
+    pthread_mutex_unlock(&confwatch_lock);
+}
+
+#else
+
+int confwatch_start(const Config *config) {
+    (void)config;
+    return -1;
+}
+
+int confwatch_poll(EventChanges *out) {
+    memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+int confwatch_details(int vmid, VMInfo *vm) {
+    (void)vmid;
+    (void)vm;
+    return -1;
+}
+
+void confwatch_stop(void) {
+}
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * 集群变更事件
+ * 增量轮询 /cluster/tasks 和 /cluster/log，只返回受影响的 VMID，
+ * 调用方据此做定向刷新，避免每次重新拉取整个 VM 列表
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+
+// 任务类型对 VM 的影响
+typedef enum {
+    EFFECT_NONE,
+    EFFECT_STATE,           // 状态或配置变化，刷新该 VM 即可
+    EFFECT_MEMBERSHIP       // VM 被创建、删除或迁移，需要重新获取列表
+} TaskEffect;
+
+static const struct {
+    const char *type;
+    TaskEffect effect;
+} task_effects[] = {
+    { "qmstart",       EFFECT_STATE },
+    { "qmstop",        EFFECT_STATE },
+    { "qmshutdown",    EFFECT_STATE },
+    { "qmreboot",      EFFECT_STATE },
+    { "qmreset",       EFFECT_STATE },
+    { "qmsuspend",     EFFECT_STATE },
+    { "qmresume",      EFFECT_STATE },
+    { "qmpause",       EFFECT_STATE },
+    { "qmconfig",      EFFECT_STATE },
+    { "qmresize",      EFFECT_STATE },
+    { "qmmove",        EFFECT_STATE },
+    { "qmtemplate",    EFFECT_STATE },
+    { "qmsnapshot",    EFFECT_STATE },
+    { "qmrollback",    EFFECT_STATE },
+    { "qmdelsnapshot", EFFECT_STATE },
+    { "hastart",       EFFECT_STATE },
+    { "hastop",        EFFECT_STATE },
+    { "qmcreate",      EFFECT_MEMBERSHIP },
+    { "qmclone",       EFFECT_MEMBERSHIP },   // 任务 ID 是源 VM，新 VMID 未知
+    { "qmrestore",     EFFECT_MEMBERSHIP },
+    { "qmdestroy",     EFFECT_MEMBERSHIP },
+    { "qmigrate",      EFFECT_MEMBERSHIP },
+    { "hamigrate",     EFFECT_MEMBERSHIP },
+    { "vzdump",        EFFECT_NONE },
+};
+
+static TaskEffect task_effect(const char *type) {
+    for (size_t i = 0; i < sizeof(task_effects) / sizeof(task_effects[0]); i++) {
+        if (strcmp(type, task_effects[i].type) == 0) {
+            return task_effects[i].effect;
+        }
+    }
+    // 未知的 qm* 任务保守地当作状态变化
+    return strncmp(type, "qm", 2) == 0 ? EFFECT_STATE : EFFECT_NONE;
+}
+
+// FNV-1a，用于记录已见过的任务和日志条目
+static uint64_t hash_str(const char *s) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static bool seen_contains(const uint64_t *set, int count, uint64_t key) {
+    return bsearch(&key, set, (size_t)count, sizeof(uint64_t), cmp_u64) != NULL;
+}
+
+static void add_change(EventChanges *out, int vmid) {
+    for (int i = 0; i < out->count; i++) {
+        if (out->vmids[i] == vmid) return;
+    }
+    if (out->count >= EVENT_MAX_CHANGES) {
+        out->full_refresh = true;
+        return;
+    }
+    out->vmids[out->count++] = vmid;
+}
+
+// 记录一个任务的影响
+static void apply_task(EventChanges *out, const char *type, const char *id) {
+    TaskEffect effect = task_effect(type);
+    if (effect == EFFECT_NONE) return;
+    
+    if (effect == EFFECT_MEMBERSHIP) {
+        out->full_refresh = true;
+        if (strcmp(type, "qmigrate") == 0 || strcmp(type, "hamigrate") == 0) {
+            out->node_changed = true;
+        }
+    }
+    
+    if (id && is_number(id)) {
+        add_change(out, atoi(id));
+    }
+}
+
+// 从 UPID 中解析任务类型和 ID (UPID:node:pid:pstart:starttime:type:id:user:)
+static void apply_upid(EventChanges *out, const char *upid) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", upid);
+    
+    char *fields[9] = {0};
+    int n = 0;
+    char *p = buf;
+    while (n < 9 && p) {
+        fields[n++] = p;
+        p = strchr(p, ':');
+        if (p) *p++ = '\0';
+    }
+    if (n >= 7) {
+        apply_task(out, fields[5], fields[6]);
+    }
+}
+
+void event_feed_init(EventFeed *feed) {
+    memset(feed, 0, sizeof(*feed));
+}
+
+void event_feed_free(EventFeed *feed) {
+    free(feed->tasks_seen);
+    free(feed->tasks_done);
+    event_feed_init(feed);
+}
+
+// 轮询 /cluster/tasks：新出现的任务和刚结束的任务都视为变更
+static int poll_tasks(EventFeed *feed, EventChanges *out) {
+    cJSON *response = api_get("/api2/json/cluster/tasks");
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int n = cJSON_GetArraySize(data);
+    uint64_t *seen = calloc(n > 0 ? (size_t)n : 1, sizeof(uint64_t));
+    uint64_t *done = calloc(n > 0 ? (size_t)n : 1, sizeof(uint64_t));
+    if (!seen || !done) {
+        free(seen);
+        free(done);
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int seen_count = 0, done_count = 0;
+    cJSON *task = NULL;
+    cJSON_ArrayForEach(task, data) {
+        const char *upid = json_get_string(task, "upid", NULL);
+        if (!upid) continue;
+        
+        uint64_t h = hash_str(upid);
+        bool finished = json_get_double(task, "endtime", 0) > 0;
+        seen[seen_count++] = h;
+        if (finished) done[done_count++] = h;
+        
+        // 首次成功轮询只建立基线
+        if (!feed->tasks_primed) continue;
+        
+        bool is_new = !seen_contains(feed->tasks_seen, feed->tasks_seen_count, h);
+        bool just_done = finished && !seen_contains(feed->tasks_done, feed->tasks_done_count, h);
+        if (is_new || just_done) {
+            apply_task(out, json_get_string(task, "type", ""), json_get_string(task, "id", NULL));
+        }
+    }
+    cJSON_Delete(response);
+    
+    qsort(seen, (size_t)seen_count, sizeof(uint64_t), cmp_u64);
+    qsort(done, (size_t)done_count, sizeof(uint64_t), cmp_u64);
+    free(feed->tasks_seen);
+    free(feed->tasks_done);
+    feed->tasks_seen = seen;
+    feed->tasks_seen_count = seen_count;
+    feed->tasks_done = done;
+    feed->tasks_done_count = done_count;
+    feed->tasks_primed = true;
+    return 0;
+}
+
+// 轮询 /cluster/log：按时间游标只处理新条目，补上已滚出任务列表的任务
+static int poll_log(EventFeed *feed, EventChanges *out) {
+    cJSON *response = api_get("/api2/json/cluster/log?max=100");
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    long max_time = feed->log_time;
+    uint64_t same_second[EVENT_LOG_SEEN];
+    int same_count = 0;
+    
+    cJSON *entry = NULL;
+    cJSON_ArrayForEach(entry, data) {
+        long t = (long)json_get_double(entry, "time", 0);
+        const char *msg = json_get_string(entry, "msg", "");
+        char key[320];
+        snprintf(key, sizeof(key), "%ld|%s|%s", t, json_get_string(entry, "node", ""), msg);
+        uint64_t h = hash_str(key);
+        
+        // 记录最新一秒内的条目，用于下次去重
+        if (t > max_time) {
+            max_time = t;
+            same_count = 0;
+        }
+        if (t == max_time && same_count < EVENT_LOG_SEEN) {
+            same_second[same_count++] = h;
+        }
+        
+        if (!feed->log_primed || t < feed->log_time) continue;
+        if (t == feed->log_time) {
+            bool dup = false;
+            for (int i = 0; i < feed->log_seen_count; i++) {
+                if (feed->log_seen[i] == h) dup = true;
+            }
+            if (dup) continue;
+        }
+        
+        // 任务日志形如 "starting task UPID:..." / "end task UPID:... OK"
+        const char *upid = strstr(msg, "UPID:");
+        if (upid) {
+            char buf[256];
+            size_t len = strcspn(upid, " \t");
+            if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+            memcpy(buf, upid, len);
+            buf[len] = '\0';
+            apply_upid(out, buf);
+            continue;
+        }
+        
+        // HA 事件形如 "service 'vm:100': state changed ..."
+        const char *vm = strstr(msg, "vm:");
+        if (vm && isdigit((unsigned char)vm[3])) {
+            add_change(out, atoi(vm + 3));
+        }
+    }
+    cJSON_Delete(response);
+    
+    if (max_time > feed->log_time) {
+        feed->log_time = max_time;
+        memcpy(feed->log_seen, same_second, (size_t)same_count * sizeof(uint64_t));
+        feed->log_seen_count = same_count;
+    } else if (max_time == feed->log_time) {
+        // 同一秒内又有新条目：合并去重集合
+        for (int i = 0; i < same_count && feed->log_seen_count < EVENT_LOG_SEEN; i++) {
+            bool dup = false;
+            for (int j = 0; j < feed->log_seen_count; j++) {
+                if (feed->log_seen[j] == same_second[i]) dup = true;
+            }
+            if (!dup) feed->log_seen[feed->log_seen_count++] = same_second[i];
+        }
+    }
+    feed->log_primed = true;
+    return 0;
+}
+
+// 获取自上次轮询以来的变更；每个来源第一次成功轮询只建立基线，不报告变更
+int event_feed_poll(EventFeed *feed, EventChanges *out) {
+    memset(out, 0, sizeof(*out));
+    
+    int ret_tasks = poll_tasks(feed, out);
+    int ret_log = poll_log(feed, out);
+    
+    // 两个来源都失败时无法判断变化，要求调用方全量刷新
+    if (ret_tasks != 0 && ret_log != 0) {
+        if (feed->tasks_primed || feed->log_primed) out->full_refresh = true;
+        return -1;
+    }
+    
+    if (out->node_changed) {
+        api_invalidate_node_cache();
+    }
+    
+    feed->polls++;
+    feed->changes += out->count;
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * VM 指标历史
+ * 每个 VM 一个固定大小的环形缓冲区，采样不分配内存；
+ * 首次查看时从 rrddata 补齐最近一小时，之后随指标刷新增量追加
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+
+void history_init(VMHistory *h, int vmid) {
+    memset(h, 0, sizeof(*h));
+    h->vmid = vmid;
+}
+
+static void history_push(VMHistory *h, const float values[METRIC_COUNT]) {
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        h->samples[k][h->head] = values[k];
+    }
+    h->head = (h->head + 1) % HISTORY_SAMPLES;
+    if (h->len < HISTORY_SAMPLES) h->len++;
+}
+
+static float mem_percent(uint64_t mem, uint64_t maxmem) {
+    return maxmem > 0 ? (float)((double)mem * 100.0 / (double)maxmem) : 0.0f;
+}
+
+// 累计计数器的速率；VM 重启后计数器归零，此时记为 0
+static float counter_rate(uint64_t now_bytes, uint64_t prev_bytes, double seconds) {
+    if (now_bytes < prev_bytes || seconds <= 0) return 0.0f;
+    return (float)((double)(now_bytes - prev_bytes) / seconds);
+}
+
+// 追加一个样本；距上次不足一个间隔时忽略（允许 1/4 的抖动），保持与 rrddata 相同的时间刻度
+void history_sample(VMHistory *h, const VMInfo *vm, time_t now) {
+    uint64_t disk = vm->diskread + vm->diskwrite;
+    uint64_t net = vm->netin + vm->netout;
+    
+    // 速率需要两次读数，第一次只建立计数器基线
+    if (h->last_time == 0) {
+        h->last_time = now;
+        h->disk_bytes = disk;
+        h->net_bytes = net;
+        return;
+    }
+    if (now - h->last_time < HISTORY_STEP * 3 / 4) return;
+    
+    double seconds = (double)(now - h->last_time);
+    float values[METRIC_COUNT];
+    values[METRIC_CPU] = (float)vm->cpu_percent;
+    values[METRIC_MEM] = mem_percent(vm->mem, vm->maxmem);
+    values[METRIC_DISK] = counter_rate(disk, h->disk_bytes, seconds);
+    values[METRIC_NET] = counter_rate(net, h->net_bytes, seconds);
+    history_push(h, values);
+    
+    h->last_time = now;
+    h->disk_bytes = disk;
+    h->net_bytes = net;
+}
+
+// 用 rrddata 最近一小时的数据（每分钟一个点）重建历史
+int history_seed(VMHistory *h, const VMInfo *vm) {
+    // 失败也不再重试，之后靠增量样本
+    h->seeded = true;
+    
+    char node[64];
+    if (vm->node[0]) {
+        snprintf(node, sizeof(node), "%s", vm->node);
+    } else if (api_resolve_node(vm->vmid, node, sizeof(node)) != 0) {
+        return -1;
+    }
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint),
+             "/api2/json/nodes/%s/qemu/%d/rrddata?timeframe=hour&cf=AVERAGE", node, vm->vmid);
+    
+    cJSON *response = api_get(endpoint);
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int n = cJSON_GetArraySize(data);
+    int first = n > HISTORY_SAMPLES ? n - HISTORY_SAMPLES : 0;
+    
+    h->head = 0;
+    h->len = 0;
+    for (int i = first; i < n; i++) {
+        cJSON *point = cJSON_GetArrayItem(data, i);
+        
+        // 缺失的字段（VM 未运行或尚未采集）按 0 处理，保持时间刻度
+        float values[METRIC_COUNT];
+        values[METRIC_CPU] = (float)(json_get_double(point, "cpu", 0) * 100);
+        values[METRIC_MEM] = mem_percent((uint64_t)json_get_double(point, "mem", 0),
+                                         (uint64_t)json_get_double(point, "maxmem", 0));
+        values[METRIC_DISK] = (float)(json_get_double(point, "diskread", 0) +
+                                      json_get_double(point, "diskwrite", 0));
+        values[METRIC_NET] = (float)(json_get_double(point, "netin", 0) +
+                                     json_get_double(point, "netout", 0));
+        history_push(h, values);
+    }
+    cJSON_Delete(response);
+    
+    // rrddata 已覆盖到现在，下一个增量样本从当前计数器算起
+    h->last_time = time(NULL);
+    h->disk_bytes = vm->diskread + vm->diskwrite;
+    h->net_bytes = vm->netin + vm->netout;
+    return 0;
+}
+
+// 取最近 max 个样本，按时间从旧到新写入 out，返回样本数
+int history_values(const VMHistory *h, MetricKind kind, float *out, int max) {
+    int n = h->len < max ? h->len : max;
+    int start = (h->head - n + HISTORY_SAMPLES) % HISTORY_SAMPLES;
+    for (int i = 0; i < n; i++) {
+        out[i] = h->samples[kind][(start + i) % HISTORY_SAMPLES];
+    }
+    return n;
+}
@@ -0,0 +1,498 @@
+/*
+ * 本地后端：在 PVE 节点上直接读取 pmxcfs 中的集群状态文件
+ * /etc/pve/.vmlist 是整个集群的 VMID → 节点映射，/etc/pve/.rrd 是各节点 pvestatd
+ * 每 10 秒广播的 VM 状态和指标，/etc/pve/.members 是节点在线状态。
+ * 读这几个文件就能得到全集群的 VM 列表，不需要 API 请求（没有 TLS 握手，也不占 pveproxy 的 worker）。
+ * rrd 中缺少或过期的 VM（刚创建、所在节点的 pvestatd 没在运行）status 留空，由调用方用 API 补齐。
+ * 设置 VMANAGER_PVE_ROOT 可以改读其他目录（如 bench/fixtures/pve）
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define LOCAL_RRD_MAX_AGE 60            // 比 rrd 中最新的数据旧这么多视为过期（秒）
+#define LOCAL_FILE_MAX (64 * 1024 * 1024)
+#define LOCAL_MAX_NODES 64
+
+typedef struct {
+    char name[64];
+    char ip[64];
+    bool online;
+} LocalNode;
+
+// 每个 VM 配置文件中读到的名称和标签，按 .vmlist 中的版本号和文件修改时间判断是否需要重读
+typedef struct {
+    int vmid;
+    int version;
+    time_t mtime;
+    char node[64];
+    char name[128];
+    char tags[128];
+} ConfEntry;
+
+static ConfEntry *conf_cache = NULL;
+static int conf_cache_count = 0;
+static pthread_mutex_t conf_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 每个配置是否走本地后端，第一次用到时判断
+typedef struct {
+    const Config *config;
+    bool enabled;
+} LocalDecision;
+
+static LocalDecision decisions[MAX_CLUSTERS + 1];
+static int decision_count = 0;
+static pthread_mutex_t decisions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const char* local_pve_root(void) {
+    const char *root = getenv("VMANAGER_PVE_ROOT");
+    return root && root[0] ? root : "/etc/pve";
+}
+
+// pmxcfs 的虚拟文件 stat 得到的大小不可靠，按块读到结尾
+static char* local_read(const char *root, const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return NULL;
+    
+    size_t cap = 64 * 1024, len = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        if (len + 1 >= cap) {
+            char *bigger = cap < LOCAL_FILE_MAX ? realloc(buf, cap * 2) : NULL;
+            if (!bigger) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len - 1, fp);
+        if (n == 0) break;
+        len += n;
+    }
+    if (buf && ferror(fp)) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    if (buf) buf[len] = '\0';
+    return buf;
+}
+
+// 解析 .members；单节点（未建集群）时没有 nodelist，只有 nodename
+static int local_members(const char *root, char *self, size_t self_len, LocalNode *nodes, int max) {
+    char *text = local_read(root, ".members");
+    cJSON *json = text ? cJSON_Parse(text) : NULL;
+    free(text);
+    if (!json) return -1;
+    
+    snprintf(self, self_len, "%s", json_get_string(json, "nodename", ""));
+    int count = 0;
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItem(json, "nodelist")) {
+        if (count >= max || !item->string) break;
+        LocalNode *node = &nodes[count++];
+        snprintf(node->name, sizeof(node->name), "%s", item->string);
+        snprintf(node->ip, sizeof(node->ip), "%s", json_get_string(item, "ip", ""));
+        node->online = json_get_int(item, "online", 0) != 0;
+    }
+    if (count == 0 && self[0] && max > 0) {
+        snprintf(nodes[0].name, sizeof(nodes[0].name), "%s", self);
+        nodes[0].ip[0] = '\0';
+        nodes[0].online = true;
+        count = 1;
+    }
+    cJSON_Delete(json);
+    return count;
+}
+
+// 配置的 host 是否就是本集群的某个节点：本机地址、节点名（或 FQDN 的第一段）、节点 IP
+static bool host_in_cluster(const char *host, const char *self, const LocalNode *nodes, int count) {
+    if (strcmp(host, "localhost") == 0 || strcmp(host, "127.0.0.1") == 0 || strcmp(host, "::1") == 0) {
+        return true;
+    }
+    
+    char short_name[256];
+    snprintf(short_name, sizeof(short_name), "%s", host);
+    char *dot = strchr(short_name, '.');
+    if (dot && !isdigit((unsigned char)short_name[0])) *dot = '\0';
+    
+    if (self[0] && (strcasecmp(host, self) == 0 || strcasecmp(short_name, self) == 0)) return true;
+    for (int i = 0; i < count; i++) {
+        if (strcasecmp(host, nodes[i].name) == 0 || strcasecmp(short_name, nodes[i].name) == 0) return true;
+        if (nodes[i].ip[0] && strcmp(host, nodes[i].ip) == 0) return true;
+    }
+    return false;
+}
+
+static bool local_decide(const Config *config) {
+    if (g_exec_mode == MODE_LOCAL) return true;
+    
+    // 自动模式：在 PVE 节点上，且配置指向的就是本集群时才读本地文件
+    const char *override = getenv("VMANAGER_PVE_ROOT");
+    if (!(override && override[0]) && !is_on_pve_server()) return false;
+    
+    char self[64];
+    LocalNode nodes[LOCAL_MAX_NODES];
+    int count = local_members(local_pve_root(), self, sizeof(self), nodes, LOCAL_MAX_NODES);
+    return count >= 0 && host_in_cluster(config->host, self, nodes, count);
+}
+
+bool local_backend_enabled(const Config *config) {
+    if (!config || g_exec_mode == MODE_REMOTE) return false;
+    
+    pthread_mutex_lock(&decisions_lock);
+    for (int i = 0; i < decision_count; i++) {
+        if (decisions[i].config == config) {
+            bool enabled = decisions[i].enabled;
+            pthread_mutex_unlock(&decisions_lock);
+            return enabled;
+        }
+    }
+    bool enabled = local_decide(config);
+    if (decision_count < MAX_CLUSTERS + 1) {
+        decisions[decision_count].config = config;
+        decisions[decision_count].enabled = enabled;
+        decision_count++;
+    }
+    pthread_mutex_unlock(&decisions_lock);
+    
+    if (enabled && g_debug) {
+        fprintf(stderr, "VM 列表读取本地 %s（%s）\n", local_pve_root(), config->name[0] ? config->name : config->host);
+    }
+    return enabled;
+}
+
+static int cmp_vmid(const void *a, const void *b) {
+    const VMInfo *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+typedef struct {
+    int vmid;
+    int version;
+    const char *node;
+} VmlistEntry;
+
+static int cmp_vmlist_entry(const void *a, const void *b) {
+    const VmlistEntry *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+// .vmlist: {"version":N,"ids":{"100":{"node":"pve1","type":"qemu","version":3},...}}
+// 只取 qemu，按 VMID 排序；versions 可为 NULL
+static int parse_vmlist(const char *text, VMInfo **vms, int **versions, int *count) {
+    cJSON *json = cJSON_Parse(text);
+    cJSON *ids = cJSON_GetObjectItem(json, "ids");
+    if (!cJSON_IsObject(ids)) {
+        cJSON_Delete(json);
+        return -1;
+    }
+    
+    int n = cJSON_GetArraySize(ids);
+    VmlistEntry *entries = malloc((n > 0 ? (size_t)n : 1) * sizeof(VmlistEntry));
+    VMInfo *list = calloc(n > 0 ? (size_t)n : 1, sizeof(VMInfo));
+    int *vers = versions ? calloc(n > 0 ? (size_t)n : 1, sizeof(int)) : NULL;
+    if (!entries || !list || (versions && !vers)) {
+        free(entries);
+        free(list);
+        free(vers);
+        cJSON_Delete(json);
+        return -1;
+    }
+    
+    int vm_count = 0;
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, ids) {
+        if (!item->string || strcmp(json_get_string(item, "type", ""), "qemu") != 0) continue;
+        int vmid = atoi(item->string);
+        if (vmid <= 0) continue;
+        entries[vm_count].vmid = vmid;
+        entries[vm_count].version = json_get_int(item, "version", 0);
+        entries[vm_count].node = json_get_string(item, "node", "");
+        vm_count++;
+    }
+    qsort(entries, (size_t)vm_count, sizeof(VmlistEntry), cmp_vmlist_entry);
+    
+    for (int i = 0; i < vm_count; i++) {
+        VMInfo *vm = &list[i];
+        vm->vmid = entries[i].vmid;
+        snprintf(vm->node, sizeof(vm->node), "%s", entries[i].node);
+        strcpy(vm->ip_address, "N/A");
+        strcpy(vm->bridge, "N/A");
+        strcpy(vm->storage, "N/A");
+        if (vers) vers[i] = entries[i].version;
+    }
+    free(entries);
+    cJSON_Delete(json);
+    
+    *vms = list;
+    *count = vm_count;
+    if (versions) *versions = vers;
+    return 0;
+}
+
+// rrd 字段中未知值写作 U，strtod/strtoull 得到 0 正好合适
+static uint64_t field_u64(const char *s) {
+    return s ? strtoull(s, NULL, 10) : 0;
+}
+
+// .rrd 每行 "键:值:值..."，VM 的键是 pve2.3-vm/<vmid>（PVE 9 为 pve-vm-9.0/<vmid>，字段在后面追加）：
+// uptime:name:status:template:ctime:maxcpu:cpu:maxmem:mem:maxdisk:disk:netin:netout:diskread:diskwrite
+// 过期与否和文件中最新的 ctime 比较而不是本机时间，节点间时钟不一致时也不会误判。
+// 返回没有有效数据的 VM 数
+static int apply_rrd(const char *text, VMInfo *vms, int count) {
+    time_t *ctimes = calloc(count > 0 ? (size_t)count : 1, sizeof(time_t));
+    time_t newest = 0;
+    const char *line = text;
+    while (line && *line) {
+        const char *end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+        const char *next = end ? end + 1 : NULL;
+        
+        bool is_vm = strncmp(line, "pve2.3-vm/", 10) == 0 || strncmp(line, "pve-vm-", 7) == 0;
+        char buf[1024];
+        if (!is_vm || len >= sizeof(buf)) {
+            line = next;
+            continue;
+        }
+        memcpy(buf, line, len);
+        buf[len] = '\0';
+        line = next;
+        
+        char *fields[24];
+        int nfields = 0;
+        char *p = strchr(buf, '/');
+        if (!p) continue;
+        p++;
+        while (p && nfields < 24) {
+            fields[nfields++] = p;
+            p = strchr(p, ':');
+            if (p) *p++ = '\0';
+        }
+        if (nfields < 16) continue;
+        
+        VMInfo key = { .vmid = atoi(fields[0]) };
+        VMInfo *vm = bsearch(&key, vms, (size_t)count, sizeof(VMInfo), cmp_vmid);
+        if (!vm) continue;   // 不在 .vmlist 中（已删除或是容器）
+        
+        time_t ctime = (time_t)atoll(fields[5]);
+        if (ctimes) ctimes[vm - vms] = ctime;
+        if (ctime > newest) newest = ctime;
+        
+        vm->uptime = atoi(fields[1]);
+        snprintf(vm->name, sizeof(vm->name), "%s", fields[2]);
+        snprintf(vm->status, sizeof(vm->status), "%s", fields[3]);
+        vm->cpus = atoi(fields[6]);
+        vm->cpu_percent = strtod(fields[7], NULL) * 100;
+        vm->maxmem = field_u64(fields[8]);
+        vm->mem = field_u64(fields[9]);
+        vm->maxdisk = field_u64(fields[10]);
+        vm->disk = field_u64(fields[11]);
+        vm->netin = field_u64(fields[12]);
+        vm->netout = field_u64(fields[13]);
+        vm->diskread = field_u64(fields[14]);
+        vm->diskwrite = field_u64(fields[15]);
+    }
+    
+    int missing = 0;
+    for (int i = 0; i < count; i++) {
+        VMInfo *vm = &vms[i];
+        if (vm->status[0] && ctimes && newest - ctimes[i] > LOCAL_RRD_MAX_AGE) {
+            // 所在节点的 pvestatd 已停止上报：只保留名称
+            VMInfo stale = { .vmid = vm->vmid };
+            memcpy(stale.node, vm->node, sizeof(stale.node));
+            memcpy(stale.name, vm->name, sizeof(stale.name));
+            strcpy(stale.ip_address, "N/A");
+            strcpy(stale.bridge, "N/A");
+            strcpy(stale.storage, "N/A");
+            *vm = stale;
+        }
+        if (vm->status[0] == '\0') missing++;
+    }
+    free(ctimes);
+    return missing;
+}
+
+// 解析 .vmlist 和 .rrd 的内容（不读文件），rrd 中缺少或过期的 VM status 为空，个数写入 missing
+int local_parse_cluster(const char *vmlist, const char *rrd, VMInfo **vms, int *count, int *missing) {
+    if (!vmlist || !vms || !count) return -1;
+    if (parse_vmlist(vmlist, vms, NULL, count) != 0) return -1;
+    
+    int n = apply_rrd(rrd ? rrd : "", *vms, *count);
+    if (missing) *missing = n;
+    return 0;
+}
+
+// user.cfg 中的资源池: pool:<名称>:<备注>:<VMID 列表，逗号分隔>:<存储列表>:
+static void apply_pools(const char *root, VMInfo *vms, int count) {
+    char *text = local_read(root, "user.cfg");
+    if (!text) return;
+    
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        if (strncmp(line, "pool:", 5) != 0) continue;
+        char *name = line + 5;
+        char *comment = strchr(name, ':');
+        if (!comment) continue;
+        *comment++ = '\0';
+        char *members = strchr(comment, ':');
+        if (!members) continue;
+        members++;
+        char *members_end = strchr(members, ':');
+        if (members_end) *members_end = '\0';
+        
+        char *id_save = NULL;
+        for (char *id = strtok_r(members, ",", &id_save); id; id = strtok_r(NULL, ",", &id_save)) {
+            VMInfo key = { .vmid = atoi(id) };
+            VMInfo *vm = bsearch(&key, vms, (size_t)count, sizeof(VMInfo), cmp_vmid);
+            if (vm) snprintf(vm->pool, sizeof(vm->pool), "%s", name);
+        }
+    }
+    free(text);
+}
+
+// 读取配置文件当前段（第一个 [快照] 之前）中的 name 和 tags
+static void read_conf(const char *root, ConfEntry *entry) {
+    char name[128];
+    snprintf(name, sizeof(name), "nodes/%s/qemu-server/%d.conf", entry->node, entry->vmid);
+    char *text = local_read(root, name);
+    entry->name[0] = '\0';
+    entry->tags[0] = '\0';
+    if (!text) return;
+    
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        if (line[0] == '[') break;
+        if (strncmp(line, "name: ", 6) == 0) {
+            snprintf(entry->name, sizeof(entry->name), "%s", line + 6);
+        } else if (strncmp(line, "tags: ", 6) == 0) {
+            snprintf(entry->tags, sizeof(entry->tags), "%s", line + 6);
+        }
+    }
+    free(text);
+}
+
+// 把 VM 配置文件当前段的 "键: 值" 转成与 API /config 的 data 相同形状的对象（值都是字符串）
+cJSON* local_read_vm_config(const char *node, int vmid) {
+    char name[128];
+    snprintf(name, sizeof(name), "nodes/%s/qemu-server/%d.conf", node, vmid);
+    char *text = local_read(local_pve_root(), name);
+    if (!text) return NULL;
+    
+    cJSON *data = cJSON_CreateObject();
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line && data; line = strtok_r(NULL, "\n", &save)) {
+        if (line[0] == '[') break;
+        if (line[0] == '#') continue;   // 描述
+        char *sep = strstr(line, ": ");
+        if (!sep) continue;
+        *sep = '\0';
+        cJSON_AddStringToObject(data, line, sep + 2);
+    }
+    free(text);
+    return data;
+}
+
+static int cmp_conf_entry(const void *a, const void *b) {
+    const ConfEntry *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+// 标签只在配置文件里。TUI 每次刷新都会调用，所以按 VM 缓存，
+// .vmlist 版本号和文件修改时间都没变的不重新读取
+static void apply_conf(const char *root, VMInfo *vms, const int *versions, int count) {
+    ConfEntry *next = calloc(count > 0 ? (size_t)count : 1, sizeof(ConfEntry));
+    if (!next) return;
+    
+    pthread_mutex_lock(&conf_cache_lock);
+    for (int i = 0; i < count; i++) {
+        VMInfo *vm = &vms[i];
+        ConfEntry *entry = &next[i];
+        entry->vmid = vm->vmid;
+        entry->version = versions[i];
+        snprintf(entry->node, sizeof(entry->node), "%s", vm->node);
+        char path[512];
+        snprintf(path, sizeof(path), "%s/nodes/%s/qemu-server/%d.conf", root, vm->node, vm->vmid);
+        
+        struct stat st;
+        entry->mtime = stat(path, &st) == 0 ? st.st_mtime : 0;
+        
+        ConfEntry *old = bsearch(entry, conf_cache, (size_t)conf_cache_count, sizeof(ConfEntry), cmp_conf_entry);
+        if (old && old->version == entry->version && old->mtime == entry->mtime &&
+            strcmp(old->node, entry->node) == 0) {
+            memcpy(entry->name, old->name, sizeof(entry->name));
+            memcpy(entry->tags, old->tags, sizeof(entry->tags));
+        } else {
+            read_conf(root, entry);
+        }
+        
+        snprintf(vm->tags, sizeof(vm->tags), "%s", entry->tags);
+        if (vm->name[0] == '\0' && entry->name[0]) {
+            snprintf(vm->name, sizeof(vm->name), "%s", entry->name);
+        }
+    }
+    free(conf_cache);
+    conf_cache = next;
+    conf_cache_count = count;
+    pthread_mutex_unlock(&conf_cache_lock);
+}
+
+// 从 pmxcfs 读取全集群的 VM，按 VMID 排序。with_config 时还读取资源池和标签（每个 VM 一个配置文件）。
+// 所在节点离线的 VM 状态为 unknown（与 API 一致）；其余没有 rrd 数据的 status 为空，个数写入 missing
+int local_get_cluster_vms(VMInfo **vms, int *count, bool with_config, int *missing) {
+    if (!vms || !count) return -1;
+    const char *root = local_pve_root();
+    
+    char *vmlist = local_read(root, ".vmlist");
+    if (!vmlist) return -1;
+    
+    VMInfo *list = NULL;
+    int *versions = NULL;
+    int vm_count = 0;
+    int ret = parse_vmlist(vmlist, &list, &versions, &vm_count);
+    free(vmlist);
+    if (ret != 0) return -1;
+    
+    char *rrd = local_read(root, ".rrd");
+    int unknown = apply_rrd(rrd ? rrd : "", list, vm_count);
+    free(rrd);
+    
+    if (unknown > 0) {
+        char self[64];
+        LocalNode nodes[LOCAL_MAX_NODES];
+        int node_count = local_members(root, self, sizeof(self), nodes, LOCAL_MAX_NODES);
+        for (int i = 0; i < vm_count && node_count > 0; i++) {
+            VMInfo *vm = &list[i];
+            if (vm->status[0]) continue;
+            for (int k = 0; k < node_count; k++) {
+                if (strcmp(nodes[k].name, vm->node) == 0 && !nodes[k].online) {
+                    strcpy(vm->status, "unknown");
+                    unknown--;
+                    break;
+                }
+            }
+        }
+    }
+    
+    if (with_config) {
+        apply_pools(root, list, vm_count);
+        apply_conf(root, list, versions, vm_count);
+    }
+    free(versions);
+    
+    for (int i = 0; i < vm_count; i++) {
+        if (list[i].status[0] && list[i].name[0] == '\0') strcpy(list[i].name, "N/A");
+    }
+    
+    *vms = list;
+    *count = vm_count;
+    if (missing) *missing = unknown;
+    return 0;
+}
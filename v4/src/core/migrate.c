@@ -0,0 +1,315 @@
+/*
+ * 批量迁移
+ * 并发迁移多个 VM 或清空一个节点，按源节点和目标节点分别限制并发，
+ * 内存小的 VM 先迁移，节点上的 VM 数量下降最快
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <unistd.h>
+
+// 单个迁移任务的执行状态
+typedef struct {
+    int ret;
+    char error[256];
+    double elapsed;
+} MigrateJob;
+
+typedef struct {
+    const MigrateOptions *opts;
+    MigrateMove *moves;
+    MigrateJob *jobs;
+    int count;
+    KeyedLimit source_limit;
+    KeyedLimit target_limit;
+    pthread_mutex_t progress_lock;
+    int done;
+    int failed;
+    bool show_progress;
+} MigrateRun;
+
+static int cmp_move_mem(const void *a, const void *b) {
+    const MigrateMove *x = a, *y = b;
+    if (x->maxmem != y->maxmem) return (x->maxmem > y->maxmem) - (x->maxmem < y->maxmem);
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+static int cmp_vmid(const void *key, const void *elem) {
+    int vmid = *(const int *)key;
+    const VMInfo *vm = elem;
+    return (vmid > vm->vmid) - (vmid < vm->vmid);
+}
+
+static void report(MigrateRun *run, MigrateMove *move, MigrateJob *job) {
+    pthread_mutex_lock(&run->progress_lock);
+    run->done++;
+    if (job->ret != 0) run->failed++;
+    
+    if (run->show_progress) {
+        fprintf(stderr, "\r\033[K");
+    }
+    if (job->ret != 0) {
+        fprintf(stderr, "\033[31m✗\033[0m VM %d %s → %s 迁移失败: %s\n",
+                move->vmid, move->source, move->target, job->error);
+    } else {
+        printf("\033[32m✓\033[0m VM %d (%s) %s → %s 迁移完成 (%.1fs)\n",
+               move->vmid, move->name, move->source, move->target, job->elapsed);
+        fflush(stdout);
+    }
+    if (run->show_progress) {
+        progress_draw("迁移", run->done, run->failed, run->count);
+    }
+    pthread_mutex_unlock(&run->progress_lock);
+}
+
+static void migrate_worker(int index, void *arg) {
+    MigrateRun *run = (MigrateRun *)arg;
+    const MigrateOptions *opts = run->opts;
+    MigrateMove *move = &run->moves[index];
+    MigrateJob *job = &run->jobs[index];
+    
+    // 总是先占源节点再占目标节点，两组限制之间不会循环等待
+    keyed_limit_acquire(&run->source_limit, move->source);
+    keyed_limit_acquire(&run->target_limit, move->target);
+    double start = now_monotonic();
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/migrate",
+             move->source, move->vmid);
+    
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddStringToObject(body, "target", move->target);
+    cJSON_AddBoolToObject(body, "online", move->online);
+    if (opts->with_local_disks) cJSON_AddBoolToObject(body, "with-local-disks", true);
+    if (opts->bwlimit > 0) cJSON_AddNumberToObject(body, "bwlimit", opts->bwlimit);
+    
+    cJSON *response = api_post(endpoint, body);
+    cJSON_Delete(body);
+    
+    char upid[256];
+    if (api_response_upid(response, upid, sizeof(upid)) != 0) {
+        snprintf(job->error, sizeof(job->error), "%s", api_last_error());
+        job->ret = -1;
+    } else if (upid[0]) {
+        char exitstatus[128];
+        if (api_wait_task(upid, opts->timeout, exitstatus, sizeof(exitstatus)) != 0) {
+            snprintf(job->error, sizeof(job->error), "任务失败: %s", exitstatus);
+            job->ret = -1;
+        }
+    }
+    cJSON_Delete(response);
+    
+    job->elapsed = now_monotonic() - start;
+    keyed_limit_release(&run->target_limit, move->target);
+    keyed_limit_release(&run->source_limit, move->source);
+    
+    report(run, move, job);
+}
+
+static void print_plan(const MigrateMove *moves, int count) {
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "FROM", false },
+        { "TO", false },
+        { "MEM", true },
+        { "MODE", false },
+    };
+    Table table;
+    table_init(&table, columns, 6);
+    
+    char buf[FORMAT_LEN];
+    for (int i = 0; i < count; i++) {
+        const MigrateMove *m = &moves[i];
+        table_cell(&table, "%d", m->vmid);
+        table_cell(&table, "%s", m->name);
+        table_cell(&table, "%s", m->source);
+        table_cell(&table, "%s", m->target);
+        table_cell(&table, "%s", format_bytes(m->maxmem, buf, sizeof(buf)));
+        table_cell(&table, "%s", m->online ? "在线" : "离线");
+    }
+    
+    fflush(stdout);
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+}
+
+// 执行迁移计划，moves 会按内存从小到大重新排序
+int migrate_execute(MigrateMove *moves, int count, const MigrateOptions *opts) {
+    if (!moves || count <= 0 || !opts) return -1;
+    
+    qsort(moves, (size_t)count, sizeof(MigrateMove), cmp_move_mem);
+    
+    print_plan(moves, count);
+    if (opts->dry_run) return 0;
+    printf("\n");
+    
+    MigrateRun run = { .opts = opts, .moves = moves, .count = count };
+    run.jobs = calloc((size_t)count, sizeof(MigrateJob));
+    if (!run.jobs) return -1;
+    
+    keyed_limit_init(&run.source_limit, opts->per_source);
+    keyed_limit_init(&run.target_limit, opts->per_target);
+    pthread_mutex_init(&run.progress_lock, NULL);
+    run.show_progress = isatty(STDERR_FILENO) && !g_debug;
+    if (run.show_progress) {
+        progress_draw("迁移", 0, 0, count);
+    }
+    
+    double start = now_monotonic();
+    pool_run(count, g_parallel, migrate_worker, &run);
+    
+    if (run.show_progress) {
+        fprintf(stderr, "\r\033[K");
+    }
+    printf("\n迁移 总计: \033[32m%d 成功\033[0m, \033[31m%d 失败\033[0m (%.1fs)\n",
+           run.done - run.failed, run.failed, now_monotonic() - start);
+    
+    // VM 所在节点已变化
+    api_invalidate_node_cache();
+    
+    int ret = (run.failed > 0) ? 1 : 0;
+    pthread_mutex_destroy(&run.progress_lock);
+    keyed_limit_destroy(&run.source_limit);
+    keyed_limit_destroy(&run.target_limit);
+    free(run.jobs);
+    return ret;
+}
+
+static NodeInfo* find_node(NodeInfo *nodes, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(nodes[i].name, name) == 0) return &nodes[i];
+    }
+    return NULL;
+}
+
+static void fill_move(MigrateMove *m, const VMInfo *vm) {
+    m->vmid = vm->vmid;
+    snprintf(m->name, sizeof(m->name), "%s", vm->name);
+    snprintf(m->source, sizeof(m->source), "%s", vm->node);
+    m->maxmem = vm->maxmem;
+    m->online = strcmp(vm->status, "running") == 0;
+}
+
+// 清空节点时为每个 VM 选择目标：按内存从大到小，依次放到剩余内存最多的在线节点
+static int assign_targets(MigrateMove *moves, int count, NodeInfo *nodes, int node_count,
+                          const char *evacuate) {
+    int64_t *free_mem = calloc((size_t)node_count, sizeof(int64_t));
+    if (!free_mem) return -1;
+    
+    int candidates = 0;
+    for (int i = 0; i < node_count; i++) {
+        if (nodes[i].online && strcmp(nodes[i].name, evacuate) != 0) {
+            free_mem[i] = (int64_t)nodes[i].maxmem - (int64_t)nodes[i].mem;
+            candidates++;
+        }
+    }
+    if (candidates == 0) {
+        fprintf(stderr, "错误：没有其他在线节点可以接收 VM\n");
+        free(free_mem);
+        return -1;
+    }
+    
+    qsort(moves, (size_t)count, sizeof(MigrateMove), cmp_move_mem);
+    bool overcommit = false;
+    for (int i = count - 1; i >= 0; i--) {
+        int best = -1;
+        for (int j = 0; j < node_count; j++) {
+            if (!nodes[j].online || strcmp(nodes[j].name, evacuate) == 0) continue;
+            if (best < 0 || free_mem[j] > free_mem[best]) best = j;
+        }
+        snprintf(moves[i].target, sizeof(moves[i].target), "%s", nodes[best].name);
+        free_mem[best] -= (int64_t)moves[i].maxmem;
+        if (free_mem[best] < 0) overcommit = true;
+    }
+    
+    if (overcommit) {
+        printf("\033[33m警告：其余节点的空闲内存不足以容纳所有 VM 的最大内存\033[0m\n");
+    }
+    free(free_mem);
+    return 0;
+}
+
+int migrate_run(const int *vmids, int count, const MigrateOptions *opts) {
+    if (!opts || (!opts->evacuate[0] && (!vmids || count <= 0))) return -1;
+    
+    VMInfo *vms = NULL;
+    int vm_count = 0;
+    NodeInfo *nodes = NULL;
+    int node_count = 0;
+    if (api_get_cluster_vms(&vms, &vm_count) != 0 || api_get_nodes(&nodes, &node_count) != 0) {
+        fprintf(stderr, "错误：无法获取集群资源: %s\n", api_last_error());
+        free(vms);
+        return -1;
+    }
+    
+    int ret = -1;
+    int errors = 0;
+    MigrateMove *moves = calloc((size_t)(opts->evacuate[0] ? vm_count : count) + 1, sizeof(MigrateMove));
+    int move_count = 0;
+    if (!moves) goto out;
+    
+    if (opts->target[0]) {
+        NodeInfo *t = find_node(nodes, node_count, opts->target);
+        if (!t || !t->online) {
+            fprintf(stderr, "错误：目标节点 %s %s\n", opts->target, t ? "不在线" : "不存在");
+            goto out;
+        }
+    }
+    
+    if (opts->evacuate[0]) {
+        if (!find_node(nodes, node_count, opts->evacuate)) {
+            fprintf(stderr, "错误：节点 %s 不存在\n", opts->evacuate);
+            goto out;
+        }
+        if (strcmp(opts->target, opts->evacuate) == 0) {
+            fprintf(stderr, "错误：目标节点不能是被清空的节点\n");
+            goto out;
+        }
+        for (int i = 0; i < vm_count; i++) {
+            if (strcmp(vms[i].node, opts->evacuate) == 0) {
+                fill_move(&moves[move_count++], &vms[i]);
+            }
+        }
+        if (move_count == 0) {
+            printf("节点 %s 上没有 VM\n", opts->evacuate);
+            ret = 0;
+            goto out;
+        }
+        
+        if (opts->target[0]) {
+            for (int i = 0; i < move_count; i++) {
+                snprintf(moves[i].target, sizeof(moves[i].target), "%s", opts->target);
+            }
+        } else if (assign_targets(moves, move_count, nodes, node_count, opts->evacuate) != 0) {
+            goto out;
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            VMInfo *vm = bsearch(&vmids[i], vms, (size_t)vm_count, sizeof(VMInfo), cmp_vmid);
+            if (!vm) {
+                fprintf(stderr, "\033[31m✗\033[0m VM %d 不存在\n", vmids[i]);
+                errors++;
+            } else if (strcmp(vm->node, opts->target) == 0) {
+                printf("- VM %d 已在节点 %s\n", vmids[i], opts->target);
+            } else {
+                MigrateMove *m = &moves[move_count++];
+                fill_move(m, vm);
+                snprintf(m->target, sizeof(m->target), "%s", opts->target);
+            }
+        }
+        if (move_count == 0) {
+            ret = errors > 0 ? 1 : 0;
+            goto out;
+        }
+    }
+    
+    ret = migrate_execute(moves, move_count, opts);
+    if (ret == 0 && errors > 0) ret = 1;
+
+out:
+    free(moves);
+    free(nodes);
+    free(vms);
+    return ret;
+}
@@ -0,0 +1,315 @@
+/*
+ * 集群负载均衡
+ * 根据节点容量和 VM 的平均负载（rrddata）生成迁移计划：每次把最热节点上的一个 VM
+ * 移到能让集群峰值压力降得最多的节点，直到无法改善或达到迁移数量上限
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <unistd.h>
+
+#define REBALANCE_MIN_GAIN 1.0      // 每次迁移至少降低的峰值压力（百分点）
+
+// 参与计划的 VM（只有运行中的 VM 产生负载）
+typedef struct {
+    const VMInfo *vm;
+    double cores;           // 平均使用的 CPU 核数
+    double mem;             // 平均内存 bytes
+    int node;               // 计划中所在节点的下标
+    int origin;             // 当前所在节点的下标
+} LoadVM;
+
+typedef struct {
+    const NodeInfo *info;
+    int vm_count;           // 当前运行中的 VM 数
+    double cores;           // 计划中的负载，含宿主机自身的基础负载
+    double mem;
+    double cores_before;
+    double mem_before;
+} LoadNode;
+
+typedef struct {
+    LoadVM *vms;
+    const char *timeframe;
+} RrdRun;
+
+// 用 rrddata 的平均值替换当前瞬时值；没有数据时保留瞬时值
+static void rrd_worker(int index, void *arg) {
+    RrdRun *run = (RrdRun *)arg;
+    LoadVM *lv = &run->vms[index];
+    const VMInfo *vm = lv->vm;
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint),
+             "/api2/json/nodes/%s/qemu/%d/rrddata?timeframe=%s&cf=AVERAGE",
+             vm->node, vm->vmid, run->timeframe);
+    
+    cJSON *response = api_get(endpoint);
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        cJSON_Delete(response);
+        return;
+    }
+    
+    double cpu_sum = 0, mem_sum = 0;
+    int cpu_n = 0, mem_n = 0;
+    cJSON *point = NULL;
+    cJSON_ArrayForEach(point, data) {
+        // VM 未运行的时段没有 cpu/mem 字段
+        cJSON *cpu = cJSON_GetObjectItem(point, "cpu");
+        cJSON *mem = cJSON_GetObjectItem(point, "mem");
+        if (cJSON_IsNumber(cpu)) {
+            cpu_sum += cpu->valuedouble;
+            cpu_n++;
+        }
+        if (cJSON_IsNumber(mem)) {
+            mem_sum += mem->valuedouble;
+            mem_n++;
+        }
+    }
+    cJSON_Delete(response);
+    
+    if (cpu_n > 0) lv->cores = cpu_sum / cpu_n * vm->cpus;
+    if (mem_n > 0) lv->mem = mem_sum / mem_n;
+}
+
+// 节点压力：CPU 与内存使用率中较高的一个（百分比）
+static double pressure(const NodeInfo *info, double cores, double mem) {
+    double c = info->maxcpu > 0 ? cores * 100.0 / info->maxcpu : 0;
+    double m = info->maxmem > 0 ? mem * 100.0 / (double)info->maxmem : 0;
+    return c > m ? c : m;
+}
+
+static double node_pressure(const LoadNode *n) {
+    return pressure(n->info, n->cores, n->mem);
+}
+
+static double peak_pressure(const LoadNode *nodes, int count) {
+    double peak = 0;
+    for (int i = 0; i < count; i++) {
+        if (!nodes[i].info->online) continue;
+        double p = node_pressure(&nodes[i]);
+        if (p > peak) peak = p;
+    }
+    return peak;
+}
+
+// 假设 vm 从 from 移到 to，计算之后的集群峰值压力
+static double peak_after_move(const LoadNode *nodes, int count, const LoadVM *vm, int from, int to) {
+    double peak = 0;
+    for (int i = 0; i < count; i++) {
+        if (!nodes[i].info->online) continue;
+        double cores = nodes[i].cores, mem = nodes[i].mem;
+        if (i == from) {
+            cores -= vm->cores;
+            mem -= vm->mem;
+        } else if (i == to) {
+            cores += vm->cores;
+            mem += vm->mem;
+        }
+        double p = pressure(nodes[i].info, cores, mem);
+        if (p > peak) peak = p;
+    }
+    return peak;
+}
+
+// 贪心改进：每轮从最热节点挑一个 VM 移到使峰值最低的节点，返回迁移数
+static int plan_moves(LoadNode *nodes, int node_count, LoadVM *vms, int vm_count,
+                      const RebalanceOptions *opts) {
+    int moves = 0;
+    
+    while (moves < opts->max_moves) {
+        int hot = -1;
+        for (int i = 0; i < node_count; i++) {
+            if (!nodes[i].info->online) continue;
+            if (hot < 0 || node_pressure(&nodes[i]) > node_pressure(&nodes[hot])) hot = i;
+        }
+        if (hot < 0) break;
+        
+        double peak = peak_pressure(nodes, node_count);
+        int best_vm = -1, best_node = -1;
+        double best_peak = peak - REBALANCE_MIN_GAIN;
+        
+        for (int v = 0; v < vm_count; v++) {
+            LoadVM *lv = &vms[v];
+            // 每个 VM 最多迁移一次
+            if (lv->node != hot || lv->node != lv->origin) continue;
+            
+            for (int t = 0; t < node_count; t++) {
+                if (t == hot || !nodes[t].info->online || nodes[t].info->maxmem == 0) continue;
+                double mem_after = (nodes[t].mem + lv->mem) * 100.0 / (double)nodes[t].info->maxmem;
+                if (mem_after > opts->mem_limit) continue;
+                
+                double p = peak_after_move(nodes, node_count, lv, hot, t);
+                // 同样的效果优先迁移内存小的 VM，迁移更快
+                if (p < best_peak - 1e-9 ||
+                    (best_vm >= 0 && p < best_peak + 1e-9 && lv->mem < vms[best_vm].mem)) {
+                    best_peak = p;
+                    best_vm = v;
+                    best_node = t;
+                }
+            }
+        }
+        if (best_vm < 0) break;
+        
+        LoadVM *lv = &vms[best_vm];
+        nodes[hot].cores -= lv->cores;
+        nodes[hot].mem -= lv->mem;
+        nodes[best_node].cores += lv->cores;
+        nodes[best_node].mem += lv->mem;
+        lv->node = best_node;
+        moves++;
+    }
+    
+    return moves;
+}
+
+static void print_nodes(const LoadNode *nodes, int count) {
+    static const TableColumn columns[] = {
+        { "NODE", false },
+        { "VMS", true },
+        { "CPU%", true },
+        { "MEM%", true },
+        { "PLAN CPU%", true },
+        { "PLAN MEM%", true },
+    };
+    Table table;
+    table_init(&table, columns, 6);
+    
+    for (int i = 0; i < count; i++) {
+        const LoadNode *n = &nodes[i];
+        const NodeInfo *info = n->info;
+        double maxcpu = info->maxcpu > 0 ? info->maxcpu : 1;
+        double maxmem = info->maxmem > 0 ? (double)info->maxmem : 1;
+        
+        table_cell(&table, "%s%s", info->name, info->online ? "" : " (离线)");
+        table_cell(&table, "%d", n->vm_count);
+        table_cell(&table, "%.1f%%", n->cores_before * 100.0 / maxcpu);
+        table_cell(&table, "%.1f%%", n->mem_before * 100.0 / maxmem);
+        table_cell(&table, "%.1f%%", n->cores * 100.0 / maxcpu);
+        table_cell(&table, "%.1f%%", n->mem * 100.0 / maxmem);
+    }
+    
+    fflush(stdout);
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+}
+
+int rebalance_run(const RebalanceOptions *opts) {
+    if (!opts) return -1;
+    
+    VMInfo *vms = NULL;
+    int vm_count = 0;
+    NodeInfo *infos = NULL;
+    int node_count = 0;
+    if (api_get_cluster_vms(&vms, &vm_count) != 0 || api_get_nodes(&infos, &node_count) != 0) {
+        fprintf(stderr, "错误：无法获取集群资源: %s\n", api_last_error());
+        free(vms);
+        return -1;
+    }
+    
+    int ret = -1;
+    LoadNode *nodes = calloc((size_t)node_count + 1, sizeof(LoadNode));
+    LoadVM *load = calloc((size_t)vm_count + 1, sizeof(LoadVM));
+    MigrateMove *moves = NULL;
+    if (!nodes || !load) goto out;
+    
+    for (int i = 0; i < node_count; i++) {
+        nodes[i].info = &infos[i];
+    }
+    
+    int load_count = 0;
+    for (int i = 0; i < vm_count; i++) {
+        if (strcmp(vms[i].status, "running") != 0) continue;
+        
+        int n = -1;
+        for (int j = 0; j < node_count; j++) {
+            if (strcmp(infos[j].name, vms[i].node) == 0) {
+                n = j;
+                break;
+            }
+        }
+        if (n < 0) continue;
+        
+        LoadVM *lv = &load[load_count++];
+        lv->vm = &vms[i];
+        lv->cores = vms[i].cpu_percent / 100.0 * vms[i].cpus;
+        lv->mem = (double)vms[i].mem;
+        lv->node = lv->origin = n;
+        
+        // 宿主机基础负载 = 节点当前负载 - VM 当前负载，先累计 VM 部分
+        nodes[n].cores_before += lv->cores;
+        nodes[n].mem_before += lv->mem;
+        nodes[n].vm_count++;
+    }
+    
+    for (int i = 0; i < node_count; i++) {
+        const NodeInfo *info = &infos[i];
+        double base_cores = info->cpu_percent / 100.0 * info->maxcpu - nodes[i].cores_before;
+        double base_mem = (double)info->mem - nodes[i].mem_before;
+        nodes[i].cores = base_cores > 0 ? base_cores : 0;
+        nodes[i].mem = base_mem > 0 ? base_mem : 0;
+    }
+    
+    // 并发读取每个运行中 VM 的平均负载
+    RrdRun rrd = { .vms = load, .timeframe = opts->timeframe };
+    pool_run(load_count, g_parallel, rrd_worker, &rrd);
+    
+    for (int i = 0; i < load_count; i++) {
+        nodes[load[i].node].cores += load[i].cores;
+        nodes[load[i].node].mem += load[i].mem;
+    }
+    for (int i = 0; i < node_count; i++) {
+        nodes[i].cores_before = nodes[i].cores;
+        nodes[i].mem_before = nodes[i].mem;
+    }
+    
+    double peak_before = peak_pressure(nodes, node_count);
+    int move_count = plan_moves(nodes, node_count, load, load_count, opts);
+    double peak_after = peak_pressure(nodes, node_count);
+    
+    printf("负载取最近一%s的平均值，%d 个运行中的 VM\n",
+           strcmp(opts->timeframe, "day") == 0 ? "天" :
+           strcmp(opts->timeframe, "week") == 0 ? "周" : "小时", load_count);
+    print_nodes(nodes, node_count);
+    printf("\n峰值压力: %.1f%% → %.1f%%\n", peak_before, peak_after);
+    
+    if (move_count == 0) {
+        printf("集群负载已均衡，无需迁移\n");
+        ret = 0;
+        goto out;
+    }
+    
+    moves = calloc((size_t)move_count, sizeof(MigrateMove));
+    if (!moves) goto out;
+    
+    int m = 0;
+    for (int i = 0; i < load_count; i++) {
+        LoadVM *lv = &load[i];
+        if (lv->node == lv->origin) continue;
+        
+        MigrateMove *mv = &moves[m++];
+        mv->vmid = lv->vm->vmid;
+        snprintf(mv->name, sizeof(mv->name), "%s", lv->vm->name);
+        snprintf(mv->source, sizeof(mv->source), "%s", infos[lv->origin].name);
+        snprintf(mv->target, sizeof(mv->target), "%s", infos[lv->node].name);
+        mv->maxmem = lv->vm->maxmem;
+        mv->online = true;
+    }
+    
+    printf("\n迁移计划 (%d 个 VM)：\n", move_count);
+    MigrateOptions migrate = opts->migrate;
+    migrate.dry_run = !opts->apply;
+    ret = migrate_execute(moves, move_count, &migrate);
+    if (!opts->apply) {
+        printf("\n使用 --apply 执行以上迁移\n");
+    }
+
+out:
+    free(moves);
+    free(load);
+    free(nodes);
+    free(infos);
+    free(vms);
+    return ret;
+}
@@ -0,0 +1,224 @@
+/*
+ * 批量修改 VM 配置
+ * 并发读取配置，只提交实际变化的配置项，PUT 时带上读到的 digest，
+ * 配置在读取后被其他人修改时重新读取并重试
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <time.h>
+
+#define SET_MAX_ATTEMPTS 5          // digest 冲突时的最多尝试次数
+
+// 单个 VM 的执行状态
+typedef struct {
+    int vmid;
+    char node[64];
+    int ret;                // 0 成功，-1 失败
+    char error[256];
+    char *old[SET_MAX_CHANGES];     // 修改前的值，NULL 表示原本未设置
+    bool changed[SET_MAX_CHANGES];
+    int change_count;
+    int retries;            // digest 冲突重试次数
+} SetJob;
+
+typedef struct {
+    const SetOptions *opts;
+    SetJob *jobs;
+} SetRun;
+
+// 把配置项的值转换为字符串（PVE 对数值项返回 JSON 数字）
+static void value_string(cJSON *item, char *buf, size_t len) {
+    if (cJSON_IsString(item)) {
+        snprintf(buf, len, "%s", item->valuestring);
+    } else if (cJSON_IsNumber(item)) {
+        if (item->valuedouble == (double)(long long)item->valuedouble) {
+            snprintf(buf, len, "%lld", (long long)item->valuedouble);
+        } else {
+            snprintf(buf, len, "%g", item->valuedouble);
+        }
+    } else if (cJSON_IsBool(item)) {
+        snprintf(buf, len, "%d", cJSON_IsTrue(item) ? 1 : 0);
+    } else {
+        buf[0] = '\0';
+    }
+}
+
+static void clear_diff(SetJob *job) {
+    for (int i = 0; i < SET_MAX_CHANGES; i++) {
+        free(job->old[i]);
+        job->old[i] = NULL;
+        job->changed[i] = false;
+    }
+    job->change_count = 0;
+}
+
+// 读取当前配置并与目标值比较，digest 写入 digest
+static int compute_diff(SetJob *job, const SetOptions *opts, char *digest, size_t len) {
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/config", job->node, job->vmid);
+    
+    cJSON *response = api_get(endpoint);
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsObject(data)) {
+        snprintf(job->error, sizeof(job->error), "读取配置失败: %s",
+                 api_last_error()[0] ? api_last_error() : "无响应");
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    snprintf(digest, len, "%s", json_get_string(data, "digest", ""));
+    
+    clear_diff(job);
+    for (int i = 0; i < opts->count; i++) {
+        const ConfigChange *c = &opts->changes[i];
+        cJSON *item = cJSON_GetObjectItem(data, c->key);
+        
+        char current[512];
+        value_string(item, current, sizeof(current));
+        if (item) job->old[i] = strdup(current);
+        
+        job->changed[i] = c->remove ? (item != NULL) : (!item || strcmp(current, c->value) != 0);
+        if (job->changed[i]) job->change_count++;
+    }
+    
+    cJSON_Delete(response);
+    return 0;
+}
+
+// digest 不匹配时 PVE 返回 "detected modified configuration - file changed by other user? Try again."
+// 只认这条消息：digest 参数校验失败等其他错误重试也不会成功
+static bool is_conflict(const char *error) {
+    return strstr(error, "detected modified configuration") != NULL;
+}
+
+static int put_config(SetJob *job, const SetOptions *opts, const char *digest) {
+    cJSON *body = cJSON_CreateObject();
+    if (digest[0]) cJSON_AddStringToObject(body, "digest", digest);
+    
+    char removes[512] = "";
+    size_t rlen = 0;
+    for (int i = 0; i < opts->count; i++) {
+        const ConfigChange *c = &opts->changes[i];
+        if (!job->changed[i]) continue;
+        
+        if (c->remove) {
+            rlen += (size_t)snprintf(removes + rlen, sizeof(removes) - rlen, "%s%s",
+                                     rlen ? "," : "", c->key);
+            if (rlen >= sizeof(removes)) rlen = sizeof(removes) - 1;
+        } else {
+            cJSON_AddStringToObject(body, c->key, c->value);
+        }
+    }
+    if (removes[0]) cJSON_AddStringToObject(body, "delete", removes);
+    
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/config", job->node, job->vmid);
+    
+    cJSON *response = api_put(endpoint, body);
+    int ret = api_response_upid(response, NULL, 0);
+    if (ret != 0) {
+        snprintf(job->error, sizeof(job->error), "%s", api_last_error());
+    }
+    
+    cJSON_Delete(response);
+    cJSON_Delete(body);
+    return ret;
+}
+
+static void set_worker(int index, void *arg) {
+    SetRun *run = (SetRun *)arg;
+    const SetOptions *opts = run->opts;
+    SetJob *job = &run->jobs[index];
+    
+    for (int attempt = 1; ; attempt++) {
+        char digest[64];
+        if (compute_diff(job, opts, digest, sizeof(digest)) != 0) {
+            job->ret = -1;
+            return;
+        }
+        if (job->change_count == 0 || opts->dry_run) return;
+        
+        if (put_config(job, opts, digest) == 0) return;
+        
+        if (!is_conflict(job->error) || attempt >= SET_MAX_ATTEMPTS) {
+            job->ret = -1;
+            return;
+        }
+        
+        // 按 VMID 错开重试时间，避免同时修改的多个客户端再次撞上
+        job->retries++;
+        long ms = 100L * attempt + job->vmid % 97;
+        struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void print_result(const SetJob *job, const SetOptions *opts) {
+    if (job->ret != 0) {
+        fflush(stdout);
+        fprintf(stderr, "\033[31m✗\033[0m VM %d 修改失败: %s\n", job->vmid, job->error);
+        return;
+    }
+    if (job->change_count == 0) {
+        printf("- VM %d 无需修改\n", job->vmid);
+        return;
+    }
+    
+    printf("%s VM %d%s ", opts->dry_run ? "\033[33m~\033[0m" : "\033[32m✓\033[0m",
+           job->vmid, opts->dry_run ? " 将修改" : "");
+    
+    const char *sep = "";
+    for (int i = 0; i < opts->count; i++) {
+        const ConfigChange *c = &opts->changes[i];
+        if (!job->changed[i]) continue;
+        
+        if (c->remove) {
+            printf("%s%s: %s → (删除)", sep, c->key, job->old[i]);
+        } else {
+            printf("%s%s: %s → %s", sep, c->key, job->old[i] ? job->old[i] : "(未设置)", c->value);
+        }
+        sep = ", ";
+    }
+    if (job->retries > 0) {
+        printf(" (冲突重试 %d 次)", job->retries);
+    }
+    printf("\n");
+}
+
+int set_run(const int *vmids, int count, const SetOptions *opts) {
+    if (!vmids || count <= 0 || !opts || opts->count <= 0) return -1;
+    
+    SetRun run = { .opts = opts };
+    run.jobs = calloc((size_t)count, sizeof(SetJob));
+    if (!run.jobs) return -1;
+    for (int i = 0; i < count; i++) {
+        run.jobs[i].vmid = vmids[i];
+        api_resolve_node(vmids[i], run.jobs[i].node, sizeof(run.jobs[i].node));
+    }
+    
+    pool_run(count, g_parallel, set_worker, &run);
+    
+    int modified = 0, unchanged = 0, failed = 0;
+    for (int i = 0; i < count; i++) {
+        SetJob *job = &run.jobs[i];
+        print_result(job, opts);
+        if (job->ret != 0) {
+            failed++;
+        } else if (job->change_count == 0) {
+            unchanged++;
+        } else {
+            modified++;
+        }
+        clear_diff(job);
+    }
+    
+    if (count > 1) {
+        printf("\n%s 总计: \033[32m%d %s\033[0m, %d 无需修改, \033[31m%d 失败\033[0m\n",
+               opts->dry_run ? "预览" : "修改", modified,
+               opts->dry_run ? "待修改" : "已修改", unchanged, failed);
+    }
+    
+    free(run.jobs);
+    return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,418 @@
+/*
+ * 快照管理
+ * 对多个 VM 并发执行快照创建、列出、回滚、删除和按保留策略清理
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+#include <time.h>
+
+// 单个快照条目
+typedef struct {
+    char name[64];
+    char description[256];
+    long snaptime;
+    bool vmstate;
+    bool remove;            // prune 计划删除
+} SnapshotEntry;
+
+// 单个 VM 的执行状态
+typedef struct {
+    int vmid;
+    char node[64];          // VM 所在节点
+    int ret;                // 0 成功，-1 失败
+    char error[256];
+    char storage[64];
+    SnapshotEntry *snaps;
+    int snap_count;
+    int remove_count;       // prune 计划删除数
+    int removed;            // prune 实际删除数
+    double elapsed;
+} SnapshotJob;
+
+typedef struct {
+    const SnapshotOptions *opts;
+    SnapshotJob *jobs;
+    KeyedLimit storage_limit;
+} SnapshotRun;
+
+static const char *action_names[] = {
+    [SNAP_CREATE] = "创建",
+    [SNAP_LIST] = "列出",
+    [SNAP_ROLLBACK] = "回滚",
+    [SNAP_DELETE] = "删除",
+    [SNAP_PRUNE] = "清理"
+};
+
+// PVE 快照名规则：字母开头，仅含字母、数字、- 和 _，最长 40
+static bool valid_snapname(const char *name) {
+    size_t len = strlen(name);
+    if (len < 2 || len > 40 || !isalpha((unsigned char)name[0])) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void job_error(SnapshotJob *job, const char *what) {
+    const char *reason = api_last_error();
+    snprintf(job->error, sizeof(job->error), "%s%s%s",
+             what, reason[0] ? ": " : "", reason);
+    job->ret = -1;
+}
+
+// 提交异步任务并等待其完成
+static int snapshot_task(SnapshotJob *job, const char *method, const char *endpoint,
+                         cJSON *body, int timeout) {
+    cJSON *response = (strcmp(method, "DELETE") == 0)
+                      ? api_delete(endpoint)
+                      : api_post(endpoint, body);
+    
+    char upid[256];
+    if (api_response_upid(response, upid, sizeof(upid)) != 0) {
+        job_error(job, "任务提交失败");
+        cJSON_Delete(response);
+        return -1;
+    }
+    cJSON_Delete(response);
+    
+    if (g_debug) {
+        fprintf(stderr, "VM %d 任务 ID: %s\n", job->vmid, upid);
+    }
+    
+    // 部分版本对同步完成的操作不返回 UPID
+    if (upid[0] == '\0') return 0;
+    
+    char exitstatus[128];
+    int ret = api_wait_task(upid, timeout, exitstatus, sizeof(exitstatus));
+    if (ret != 0) {
+        snprintf(job->error, sizeof(job->error), "任务失败: %s", exitstatus);
+        job->ret = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// 获取单个 VM 的快照列表（不含 current）
+static int fetch_snapshots(SnapshotJob *job) {
+    char endpoint[256];
+    snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/snapshot",
+             job->node, job->vmid);
+    
+    cJSON *response = api_get(endpoint);
+    cJSON *data = response ? cJSON_GetObjectItem(response, "data") : NULL;
+    if (!cJSON_IsArray(data)) {
+        job_error(job, "无法获取快照列表");
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    int n = cJSON_GetArraySize(data);
+    job->snaps = calloc(n > 0 ? (size_t)n : 1, sizeof(SnapshotEntry));
+    if (!job->snaps) {
+        snprintf(job->error, sizeof(job->error), "内存分配失败");
+        job->ret = -1;
+        cJSON_Delete(response);
+        return -1;
+    }
+    
+    cJSON *item = NULL;
+    cJSON_ArrayForEach(item, data) {
+        const char *name = json_get_string(item, "name", NULL);
+        if (!name || strcmp(name, "current") == 0) continue;
+        
+        SnapshotEntry *e = &job->snaps[job->snap_count++];
+        snprintf(e->name, sizeof(e->name), "%s", name);
+        snprintf(e->description, sizeof(e->description), "%s",
+                 json_get_string(item, "description", ""));
+        e->snaptime = (long)json_get_double(item, "snaptime", 0);
+        e->vmstate = json_get_int(item, "vmstate", 0) != 0;
+    }
+    
+    cJSON_Delete(response);
+    return 0;
+}
+
+static int cmp_snaptime_desc(const void *a, const void *b) {
+    const SnapshotEntry *x = a, *y = b;
+    if (x->snaptime != y->snaptime) return (x->snaptime < y->snaptime) ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+// 根据保留策略标记需要删除的快照（仅限带前缀的快照）
+static void plan_prune(SnapshotJob *job, const SnapshotOptions *opts) {
+    qsort(job->snaps, (size_t)job->snap_count, sizeof(SnapshotEntry), cmp_snaptime_desc);
+    
+    size_t plen = strlen(opts->prefix);
+    int kept_last = 0, kept_days = 0;
+    char last_day[16] = "";
+    
+    for (int i = 0; i < job->snap_count; i++) {
+        SnapshotEntry *e = &job->snaps[i];
+        if (strncmp(e->name, opts->prefix, plen) != 0) continue;
+        
+        bool keep = false;
+        if (kept_last < opts->keep_last) {
+            kept_last++;
+            keep = true;
+        }
+        
+        // 按时间倒序遍历，每天的第一个即当天最新的快照
+        time_t t = (time_t)e->snaptime;
+        struct tm tm;
+        char day[16];
+        localtime_r(&t, &tm);
+        strftime(day, sizeof(day), "%Y-%m-%d", &tm);
+        if (strcmp(day, last_day) != 0) {
+            snprintf(last_day, sizeof(last_day), "%s", day);
+            if (kept_days < opts->keep_daily) {
+                kept_days++;
+                keep = true;
+            }
+        }
+        
+        if (!keep) {
+            e->remove = true;
+            job->remove_count++;
+        }
+    }
+}
+
+static void list_worker(int index, void *arg) {
+    SnapshotRun *run = (SnapshotRun *)arg;
+    SnapshotJob *job = &run->jobs[index];
+    
+    if (fetch_snapshots(job) == 0 && run->opts->action == SNAP_PRUNE) {
+        plan_prune(job, run->opts);
+    }
+}
+
+static void print_result(SnapshotJob *job, const SnapshotOptions *opts) {
+    const char *verb = action_names[opts->action];
+    
+    if (job->ret != 0) {
+        fprintf(stderr, "\033[31m✗\033[0m VM %d 快照%s失败: %s\n",
+                job->vmid, verb, job->error);
+    } else if (opts->action == SNAP_PRUNE) {
+        printf("\033[32m✓\033[0m VM %d 已清理 %d 个快照 (%.1fs)\n",
+               job->vmid, job->removed, job->elapsed);
+    } else {
+        printf("\033[32m✓\033[0m VM %d 快照 %s %s成功 (%.1fs)\n",
+               job->vmid, opts->name, verb, job->elapsed);
+    }
+}
+
+static void exec_worker(int index, void *arg) {
+    SnapshotRun *run = (SnapshotRun *)arg;
+    const SnapshotOptions *opts = run->opts;
+    SnapshotJob *job = &run->jobs[index];
+    
+    if (job->ret != 0) return;                 // 列出阶段已失败
+    if (opts->action == SNAP_PRUNE && job->remove_count == 0) return;
+    
+    // 以 VM 的主磁盘存储作为并发分组
+    VMInfo vm = {0};
+    snprintf(vm.storage, sizeof(vm.storage), "N/A");
+    api_get_vm_config_details(job->vmid, &vm, 0);
+    snprintf(job->storage, sizeof(job->storage), "%s", vm.storage);
+    
+    keyed_limit_acquire(&run->storage_limit, job->storage);
+    double start = now_monotonic();
+    
+    char endpoint[512];
+    switch (opts->action) {
+        case SNAP_CREATE: {
+            snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/snapshot",
+                     job->node, job->vmid);
+            cJSON *body = cJSON_CreateObject();
+            cJSON_AddStringToObject(body, "snapname", opts->name);
+            if (opts->description[0]) {
+                cJSON_AddStringToObject(body, "description", opts->description);
+            }
+            if (opts->vmstate) {
+                cJSON_AddBoolToObject(body, "vmstate", true);
+            }
+            snapshot_task(job, "POST", endpoint, body, opts->timeout);
+            cJSON_Delete(body);
+            break;
+        }
+        case SNAP_ROLLBACK:
+            snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/snapshot/%s/rollback",
+                     job->node, job->vmid, opts->name);
+            snapshot_task(job, "POST", endpoint, NULL, opts->timeout);
+            break;
+        case SNAP_DELETE:
+            snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/snapshot/%s",
+                     job->node, job->vmid, opts->name);
+            snapshot_task(job, "DELETE", endpoint, NULL, opts->timeout);
+            break;
+        case SNAP_PRUNE:
+            // 同一 VM 的快照操作会锁定配置，只能逐个删除
+            for (int i = 0; i < job->snap_count; i++) {
+                if (!job->snaps[i].remove) continue;
+                snprintf(endpoint, sizeof(endpoint), "/api2/json/nodes/%s/qemu/%d/snapshot/%s",
+                         job->node, job->vmid, job->snaps[i].name);
+                if (snapshot_task(job, "DELETE", endpoint, NULL, opts->timeout) != 0) break;
+                job->removed++;
+            }
+            break;
+        case SNAP_LIST:
+            break;
+    }
+    
+    job->elapsed = now_monotonic() - start;
+    keyed_limit_release(&run->storage_limit, job->storage);
+    
+    print_result(job, opts);
+}
+
+static void print_snapshot_list(SnapshotJob *jobs, int count) {
+    printf("\033[1m");
+    printf("%-6s %-28s %-20s %-7s %s\n", "VMID", "SNAPSHOT", "DATE", "VMSTATE", "DESCRIPTION");
+    printf("────────────────────────────────────────────────────────────────────────────────\n");
+    printf("\033[0m");
+    
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        SnapshotJob *job = &jobs[i];
+        if (job->ret != 0) {
+            fprintf(stderr, "\033[31m✗\033[0m VM %d: %s\n", job->vmid, job->error);
+            continue;
+        }
+        
+        qsort(job->snaps, (size_t)job->snap_count, sizeof(SnapshotEntry), cmp_snaptime_desc);
+        for (int j = 0; j < job->snap_count; j++) {
+            SnapshotEntry *e = &job->snaps[j];
+            char date[32] = "N/A";
+            if (e->snaptime > 0) {
+                time_t t = (time_t)e->snaptime;
+                struct tm tm;
+                localtime_r(&t, &tm);
+                strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+            }
+            // 描述只显示第一行
+            char desc[64];
+            snprintf(desc, sizeof(desc), "%.63s", e->description);
+            desc[strcspn(desc, "\n")] = '\0';
+            
+            printf("%-6d %-28s %-20s %-7s %s\n", job->vmid, e->name, date,
+                   e->vmstate ? "yes" : "no", desc);
+            total++;
+        }
+    }
+    
+    printf("\n共 %d 个快照\n", total);
+}
+
+static void print_prune_plan(SnapshotJob *jobs, int count, const SnapshotOptions *opts) {
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        SnapshotJob *job = &jobs[i];
+        for (int j = 0; j < job->snap_count; j++) {
+            if (!job->snaps[j].remove) continue;
+            printf("%s VM %d: %s\n", opts->dry_run ? "[dry-run] 将删除" : "计划删除",
+                   job->vmid, job->snaps[j].name);
+            total++;
+        }
+    }
+    printf("共 %d 个快照待删除 (keep-last=%d, keep-daily=%d, prefix=\"%s\")\n\n",
+           total, opts->keep_last, opts->keep_daily, opts->prefix);
+}
+
+// 对一组 VM 并发执行快照操作
+int snapshot_run(const int *vmids, int count, const SnapshotOptions *opts_in) {
+    if (!vmids || count <= 0 || !opts_in) return -1;
+    
+    SnapshotOptions opts = *opts_in;
+    
+    if (opts.action == SNAP_CREATE && opts.name[0] == '\0') {
+        // 所有 VM 使用同一个自动生成的快照名，便于之后统一回滚
+        time_t now = time(NULL);
+        struct tm tm;
+        char stamp[32];
+        localtime_r(&now, &tm);
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+        snprintf(opts.name, sizeof(opts.name), "%s%s", opts.prefix, stamp);
+    }
+    
+    if (opts.action != SNAP_LIST && opts.action != SNAP_PRUNE && !valid_snapname(opts.name)) {
+        fprintf(stderr, "错误：无效的快照名: %s\n", opts.name[0] ? opts.name : "(空)");
+        fprintf(stderr, "快照名需以字母开头，只能包含字母、数字、- 和 _\n");
+        return -1;
+    }
+    
+    if (opts.action == SNAP_PRUNE && opts.keep_last <= 0 && opts.keep_daily <= 0) {
+        fprintf(stderr, "错误：prune 需要 --keep-last 或 --keep-daily\n");
+        return -1;
+    }
+    
+    SnapshotRun run = { .opts = &opts };
+    run.jobs = calloc((size_t)count, sizeof(SnapshotJob));
+    if (!run.jobs) return -1;
+    for (int i = 0; i < count; i++) {
+        run.jobs[i].vmid = vmids[i];
+        api_resolve_node(vmids[i], run.jobs[i].node, sizeof(run.jobs[i].node));
+    }
+    keyed_limit_init(&run.storage_limit, opts.per_storage);
+    
+    // 列表只需一轮并发 GET；prune 基于同一轮结果计算删除计划
+    if (opts.action == SNAP_LIST || opts.action == SNAP_PRUNE) {
+        pool_run(count, g_parallel, list_worker, &run);
+    }
+    
+    int ret = 0;
+    if (opts.action == SNAP_LIST) {
+        print_snapshot_list(run.jobs, count);
+        for (int i = 0; i < count; i++) {
+            if (run.jobs[i].ret != 0) ret = 1;
+        }
+    } else {
+        if (opts.action == SNAP_PRUNE) {
+            print_prune_plan(run.jobs, count, &opts);
+            fflush(stdout);
+        }
+        
+        if (opts.action == SNAP_PRUNE && opts.dry_run) {
+            for (int i = 0; i < count; i++) {
+                if (run.jobs[i].ret != 0) {
+                    print_result(&run.jobs[i], &opts);
+                    ret = 1;
+                }
+            }
+        } else {
+            pool_run(count, g_parallel, exec_worker, &run);
+            
+            int success = 0, failed = 0;
+            for (int i = 0; i < count; i++) {
+                SnapshotJob *job = &run.jobs[i];
+                if (job->ret != 0) {
+                    // 列出阶段失败的 VM 不会进入执行阶段，这里补充输出
+                    if (opts.action == SNAP_PRUNE && job->snaps == NULL) {
+                        print_result(job, &opts);
+                    }
+                    failed++;
+                } else {
+                    success++;
+                }
+            }
+            
+            if (success + failed > 1) {
+                printf("\n快照%s 总计: \033[32m%d 成功\033[0m, \033[31m%d 失败\033[0m\n",
+                       action_names[opts.action], success, failed);
+            }
+            ret = (failed > 0) ? 1 : 0;
+        }
+    }
+    
+    for (int i = 0; i < count; i++) {
+        free(run.jobs[i].snaps);
+    }
+    free(run.jobs);
+    keyed_limit_destroy(&run.storage_limit);
+    return ret;
+}
@@ -13,9 +13,9 @@ int vm_list(bool verbose) {
     VMInfo *vms = NULL;
     int count = 0;
     
-    int ret = api_get_vm_list(&vms, &count);
+    int ret = api_get_vm_list(&vms, &count, g_cache_ttl);
     if (ret != 0) {
-        fprintf(stderr, "错误：无法获取 VM 列表\n");
+        fprintf(stderr, "错误：无法获取 VM 列表: %s\n", api_last_error());
         return -1;
     }
     
@@ -28,48 +28,47 @@ int vm_list(bool verbose) {
     // 详细模式下获取额外信息
     if (verbose) {
         for (int i = 0; i < count; i++) {
-            api_get_vm_config_details(vms[i].vmid, &vms[i]);
-            api_get_vm_ip(vms[i].vmid, &vms[i]);
+            api_get_vm_config_details(vms[i].vmid, &vms[i], g_cache_ttl);
+            api_get_vm_ip(vms[i].vmid, &vms[i], g_cache_ttl);
         }
     }
     
-    // 打印表头
-    printf("\033[1m");  // 粗体
-    if (verbose) {
-        printf("%-6s %-20s %-10s %-6s %-10s %-12s %-15s %-12s\n",
-               "VMID", "NAME", "STATUS", "CPU%", "MEM", "BRIDGE", "IP", "STORAGE");
-        printf("────────────────────────────────────────────────────────────────────────────────────────────────────────\n");
-    } else {
-        printf("%-6s %-20s %-10s %-6s %-10s\n",
-               "VMID", "NAME", "STATUS", "CPU%", "MEM");
-        printf("────────────────────────────────────────────────────────────\n");
-    }
-    printf("\033[0m");  // 重置
-    
-    // 打印每个 VM
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+        { "BRIDGE", false },
+        { "IP", false },
+        { "STORAGE", false },
+    };
+    Table table;
+    table_init(&table, columns, verbose ? 8 : 5);
+    
+    char mem[FORMAT_LEN];
     for (int i = 0; i < count; i++) {
         VMInfo *vm = &vms[i];
-        
+        table_cell(&table, "%d", vm->vmid);
+        table_cell(&table, "%s", vm->name);
+        table_cell(&table, "%s", vm->status);
+        table_cell(&table, "%.1f%%", vm->cpu_percent);
+        table_cell(&table, "%s", format_bytes(vm->mem, mem, sizeof(mem)));
         if (verbose) {
-            printf("%-6d %-20s %-10s %5.1f%% %-10s %-12s %-15s %-12s\n",
-                   vm->vmid,
-                   vm->name,
-                   vm->status,
-                   vm->cpu_percent,
-                   format_bytes(vm->mem),
-                   vm->bridge,
-                   vm->ip_address,
-                   vm->storage);
-        } else {
-            printf("%-6d %-20s %-10s %5.1f%% %-10s\n",
-                   vm->vmid,
-                   vm->name,
-                   vm->status,
-                   vm->cpu_percent,
-                   format_bytes(vm->mem));
+            table_cell(&table, "%s", vm->bridge);
+            table_cell(&table, "%s", vm->ip_address);
+            table_cell(&table, "%s", vm->storage);
         }
     }
     
+    ret = table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+    if (ret != 0) {
+        fprintf(stderr, "错误：无法输出 VM 列表\n");
+        free(vms);
+        return -1;
+    }
+    
     printf("\n共 %d 个虚拟机\n", count);
     
     free(vms);
@@ -80,9 +79,9 @@ int vm_list(bool verbose) {
 int vm_status(int vmid) {
     VMInfo vm = {0};
     
-    int ret = api_get_vm_status(vmid, &vm);
+    int ret = api_get_vm_status(vmid, &vm, g_cache_ttl);
     if (ret != 0) {
-        fprintf(stderr, "错误：无法获取 VM %d 的状态\n", vmid);
+        fprintf(stderr, "错误：无法获取 VM %d 的状态: %s\n", vmid, api_last_error());
         return -1;
     }
     
@@ -91,11 +90,12 @@ int vm_status(int vmid) {
     printf("VM %d 详细信息\n", vmid);
     printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n");
     
+    char buf1[FORMAT_LEN], buf2[FORMAT_LEN];
     printf("\033[36m基本信息:\033[0m\n");
     printf("  VMID:       %d\n", vm.vmid);
     printf("  名称:       %s\n", vm.name);
     printf("  状态:       %s\n", vm.status);
-    printf("  运行时间:   %s\n", format_uptime(vm.uptime));
+    printf("  运行时间:   %s\n", format_uptime(vm.uptime, buf1, sizeof(buf1)));
     
     printf("\n\033[36m网络信息:\033[0m\n");
     printf("  网桥:       %s\n", vm.bridge);
@@ -105,12 +105,12 @@ int vm_status(int vmid) {
     printf("  CPU:        %d 核\n", vm.cpus);
     printf("  CPU 使用:   %.2f%%\n", vm.cpu_percent);
     printf("  内存:       %s / %s (%.1f%%)\n",
-           format_bytes(vm.mem),
-           format_bytes(vm.maxmem),
+           format_bytes(vm.mem, buf1, sizeof(buf1)),
+           format_bytes(vm.maxmem, buf2, sizeof(buf2)),
            vm.maxmem > 0 ? (vm.mem * 100.0 / vm.maxmem) : 0);
     printf("  磁盘:       %s / %s\n",
-           format_bytes(vm.disk),
-           format_bytes(vm.maxdisk));
+           format_bytes(vm.disk, buf1, sizeof(buf1)),
+           format_bytes(vm.maxdisk, buf2, sizeof(buf2)));
     
     printf("\n\033[36m存储信息:\033[0m\n");
     printf("  存储位置:   %s\n", vm.storage);
@@ -250,21 +250,24 @@ int vm_destroy(int vmid, bool force) {
 int vm_clone(int vmid, int newid, const char *name) {
     printf("正在克隆 VM %d 到 %d...\n", vmid, newid);
     
+    // 克隆请求必须发往源 VM 所在节点
+    char node[64];
+    api_resolve_node(vmid, node, sizeof(node));
+    
     // 构建 API 端点
     char endpoint[512];
+    snprintf(endpoint, sizeof(endpoint), 
+            "/api2/json/nodes/%s/qemu/%d/clone", node, vmid);
+    
+    cJSON *body = cJSON_CreateObject();
+    cJSON_AddNumberToObject(body, "newid", newid);
     if (name) {
-        snprintf(endpoint, sizeof(endpoint), 
-                "/api2/json/nodes/%s/qemu/%d/clone?newid=%d&name=%s",
-                "pve", vmid, newid, name);
-    } else {
-        snprintf(endpoint, sizeof(endpoint), 
-                "/api2/json/nodes/%s/qemu/%d/clone?newid=%d",
-                "pve", vmid, newid);
+        cJSON_AddStringToObject(body, "name", name);
     }
     
     // 调用 API（clone 使用 POST）
-    extern cJSON* api_post(const char *endpoint, cJSON *data);
-    cJSON *response = api_post(endpoint, NULL);
+    cJSON *response = api_post(endpoint, body);
+    cJSON_Delete(body);
     
     if (!response) {
         fprintf(stderr, "错误：无法克隆 VM %d\n", vmid);
@@ -0,0 +1,214 @@
+/*
+ * 等待 VM 状态
+ * 每轮用一次 /cluster/resources 请求检查所有目标的运行状态，agent-ready 时
+ * 再并发 ping 已运行的 VM；轮询间隔自适应退避，有进展时重置
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WAIT_INTERVAL_MIN 0.5       // 初始轮询间隔（秒）
+#define WAIT_INTERVAL_MAX 5.0
+#define WAIT_INTERVAL_GROWTH 1.5    // 无进展时间隔的增长倍数
+
+// 单个 VM 的等待状态
+typedef struct {
+    int vmid;
+    char name[128];
+    char node[64];
+    char status[32];        // 最近一次观察到的状态
+    bool found;
+    bool reached;
+    bool agent_ok;          // 本轮 agent ping 结果
+    double elapsed;         // 达到目标状态的耗时
+} WaitJob;
+
+typedef struct {
+    WaitJob *jobs;
+    int *ping;              // 本轮需要 ping 的 job 下标
+} WaitRun;
+
+static const char *state_names[] = {
+    [WAIT_RUNNING] = "running",
+    [WAIT_STOPPED] = "stopped",
+    [WAIT_AGENT_READY] = "agent-ready"
+};
+
+static int cmp_vmid(const void *key, const void *elem) {
+    int vmid = *(const int *)key;
+    const VMInfo *vm = elem;
+    return (vmid > vm->vmid) - (vmid < vm->vmid);
+}
+
+static void ping_worker(int index, void *arg) {
+    WaitRun *run = (WaitRun *)arg;
+    WaitJob *job = &run->jobs[run->ping[index]];
+    job->agent_ok = (api_agent_ping(job->vmid, job->node) == 0);
+}
+
+// 执行一轮检查，返回本轮新达到目标状态的 VM 数
+static int poll_once(WaitRun *run, int count, const WaitOptions *opts, double start) {
+    VMInfo *vms = NULL;
+    int vm_count = 0;
+    if (api_get_cluster_vms(&vms, &vm_count) != 0) {
+        // 单轮失败（网络抖动、节点切换）不终止等待，下一轮重试
+        if (g_debug) {
+            fprintf(stderr, "获取集群资源失败: %s\n", api_last_error());
+        }
+        return 0;
+    }
+    
+    int pings = 0;
+    for (int i = 0; i < count; i++) {
+        WaitJob *job = &run->jobs[i];
+        if (job->reached) continue;
+        
+        VMInfo *vm = bsearch(&job->vmid, vms, (size_t)vm_count, sizeof(VMInfo), cmp_vmid);
+        job->found = (vm != NULL);
+        if (!vm) continue;
+        
+        snprintf(job->name, sizeof(job->name), "%s", vm->name);
+        snprintf(job->node, sizeof(job->node), "%s", vm->node);
+        snprintf(job->status, sizeof(job->status), "%s", vm->status);
+        
+        if (strcmp(vm->status, "running") == 0 && opts->state == WAIT_AGENT_READY) {
+            run->ping[pings++] = i;
+        }
+    }
+    free(vms);
+    
+    // agent ping 各自等待 guest 响应，并发执行
+    pool_run(pings, g_parallel, ping_worker, run);
+    
+    double now = now_monotonic();
+    int progress = 0;
+    for (int i = 0; i < count; i++) {
+        WaitJob *job = &run->jobs[i];
+        if (job->reached || !job->found) continue;
+        
+        bool ok;
+        switch (opts->state) {
+            case WAIT_RUNNING:
+                ok = strcmp(job->status, "running") == 0;
+                break;
+            case WAIT_STOPPED:
+                ok = strcmp(job->status, "stopped") == 0;
+                break;
+            default:
+                ok = job->agent_ok;
+                break;
+        }
+        
+        if (ok) {
+            job->reached = true;
+            job->elapsed = now - start;
+            progress++;
+        }
+        job->agent_ok = false;
+    }
+    
+    return progress;
+}
+
+static void sleep_seconds(double sec) {
+    if (sec <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)sec;
+    ts.tv_nsec = (long)((sec - (double)ts.tv_sec) * 1e9);
+    // 被信号打断时继续睡完剩余时间
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static void print_report(const WaitJob *jobs, int count, bool timed_out) {
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "NODE", false },
+        { "STATUS", false },
+        { "TIME", true },
+    };
+    Table table;
+    table_init(&table, columns, 5);
+    
+    for (int i = 0; i < count; i++) {
+        const WaitJob *job = &jobs[i];
+        table_cell(&table, "%d", job->vmid);
+        table_cell(&table, "%s", job->found ? job->name : "N/A");
+        table_cell(&table, "%s", job->found ? job->node : "N/A");
+        table_cell(&table, "%s", job->found ? job->status : "不存在");
+        if (job->reached) {
+            table_cell(&table, "%.1fs", job->elapsed);
+        } else {
+            table_cell(&table, "%s", timed_out ? "超时" : "-");
+        }
+    }
+    
+    fflush(stdout);
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+}
+
+int wait_run(const int *vmids, int count, const WaitOptions *opts) {
+    if (!vmids || count <= 0 || !opts) return -1;
+    
+    WaitRun run;
+    run.jobs = calloc((size_t)count, sizeof(WaitJob));
+    run.ping = calloc((size_t)count, sizeof(int));
+    if (!run.jobs || !run.ping) {
+        free(run.jobs);
+        free(run.ping);
+        return -1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        run.jobs[i].vmid = vmids[i];
+    }
+    
+    double start = now_monotonic();
+    double deadline = start + (opts->timeout > 0 ? opts->timeout : 0);
+    double interval = WAIT_INTERVAL_MIN;
+    int reached = 0;
+    bool satisfied = false;
+    
+    for (;;) {
+        int progress = poll_once(&run, count, opts, start);
+        reached += progress;
+        
+        if (g_debug) {
+            fprintf(stderr, "已达到 %s: %d/%d (%.1fs)\n", state_names[opts->state],
+                    reached, count, now_monotonic() - start);
+        }
+        
+        satisfied = opts->any ? reached > 0 : reached == count;
+        double remaining = deadline - now_monotonic();
+        if (satisfied || remaining <= 0) break;
+        
+        // 有 VM 刚完成状态变化时，其余 VM 往往也快了，回到最短间隔
+        if (progress > 0) {
+            interval = WAIT_INTERVAL_MIN;
+        } else if (interval < WAIT_INTERVAL_MAX) {
+            interval *= WAIT_INTERVAL_GROWTH;
+            if (interval > WAIT_INTERVAL_MAX) interval = WAIT_INTERVAL_MAX;
+        }
+        sleep_seconds(interval < remaining ? interval : remaining);
+    }
+    
+    print_report(run.jobs, count, !satisfied);
+    
+    double total = now_monotonic() - start;
+    if (satisfied) {
+        printf("\n\033[32m✓\033[0m %d/%d 个 VM 已达到 %s (%.1fs)\n",
+               reached, count, state_names[opts->state], total);
+    } else {
+        fprintf(stderr, "\n\033[31m✗\033[0m 等待超时 (%ds)：%d/%d 个 VM 已达到 %s\n",
+                opts->timeout, reached, count, state_names[opts->state]);
+    }
+    
+    free(run.jobs);
+    free(run.ping);
+    return satisfied ? 0 : 1;
+}
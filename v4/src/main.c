@@ -7,11 +7,16 @@
 
 // 全局变量
 Config g_config = {0};
+Config g_clusters[MAX_CLUSTERS];
+int g_cluster_count = 0;
 ExecutionMode g_exec_mode = MODE_AUTO;
 UIMode g_ui_mode = UI_CLI;
 bool g_verbose = false;
 bool g_debug = false;
 bool g_tui_mode = false;
+int g_parallel = DEFAULT_PARALLEL;
+int g_cache_ttl = 0;
+bool g_hedge = false;
 
 static void print_version(void) {
     printf("%s version %s\n\n", PROGRAM_NAME, VERSION);
@@ -28,13 +33,18 @@ static void print_help(void) {
     printf("  --cli              使用 CLI 模式 (默认)\n");
     printf("  --tui              使用 TUI 模式 (交互式界面)\n");
     printf("  --config FILE      指定配置文件\n");
-    printf("  --mode MODE        强制模式 (local/remote)\n");
+    printf("  --mode MODE        强制模式 (local: 读取本机 /etc/pve 的集群状态, remote: 只用 API)\n");
+    printf("  --cluster LIST     目标集群 (all 或逗号分隔的集群名称)\n");
+    printf("  -j, --parallel N   并发请求数上限 (默认 %d，实际并发按集群的响应延迟自动调整)\n", DEFAULT_PARALLEL);
+    printf("  --cache-ttl SEC    list/status 的响应缓存秒数 (默认 0 不缓存，也可用 VMANAGER_CACHE_TTL)\n");
+    printf("  --hedge            GET 超过同类请求的 p95 未返回时向其他节点再发一次 (也可用 VMANAGER_HEDGE=1)\n");
     printf("  -v, --verbose      详细输出\n");
     printf("  -d, --debug        调试模式\n");
     printf("  -h, --help         显示帮助信息\n");
     printf("  --version          显示版本信息\n\n");
     printf("命令：\n");
     printf("  list                    列出所有 VM\n");
+    printf("  list --watch SEC        持续刷新并高亮变化的 VM\n");
     printf("  status VMID             查看 VM 状态\n");
     printf("  start VMID...           启动 VM (支持批量和范围)\n");
     printf("  stop VMID...            停止 VM (支持批量和范围)\n");
@@ -42,7 +52,16 @@ static void print_help(void) {
     printf("  suspend VMID...         暂停 VM (支持批量和范围)\n");
     printf("  resume VMID...          恢复 VM (支持批量和范围)\n");
     printf("  destroy VMID [-f]       删除 VM\n");
-    printf("  clone VMID NEWID        克隆 VM\n\n");
+    printf("  clone VMID NEWID        克隆 VM\n");
+    printf("  clone VMID --count N    批量克隆 (--start-id X --name-pattern web-%%d)\n");
+    printf("  snapshot ACTION VMID... 快照管理 (create/list/rollback/delete/prune)\n");
+    printf("  backup VMID...          vzdump 备份 (按存储和节点限制并发)\n");
+    printf("  migrate VMID... --to N  在线迁移 VM (--evacuate NODE 清空节点)\n");
+    printf("  rebalance [--apply]     按节点负载生成并执行迁移计划\n");
+    printf("  set VMID... KEY=VALUE   批量修改配置 (memory/cores/balloon/tags/onboot 等)\n");
+    printf("  wait VMID... --state S  等待 VM 达到状态 (running/stopped/agent-ready)\n");
+    printf("  batch [-f FILE|-]       逐行执行命令，每条输出一行 JSON 结果\n");
+    printf("  shell                   交互式命令行 (Tab 补全 VMID/名称，复用连接和 VM 清单)\n\n");
     printf("批量操作格式：\n");
     printf("  单个:   111\n");
     printf("  多个:   111 112 113\n");
@@ -59,6 +78,20 @@ static void print_help(void) {
     printf("  %s stop 111,112,113\n", PROGRAM_NAME);
     printf("  %s destroy 111 -f\n", PROGRAM_NAME);
     printf("  %s clone 111 112 --name new-vm\n", PROGRAM_NAME);
+    printf("  %s clone 9000 --count 50 --start-id 200 --name-pattern web-%%d\n", PROGRAM_NAME);
+    printf("  %s snapshot create 111-120 --name before-upgrade\n", PROGRAM_NAME);
+    printf("  %s snapshot prune 111-120 --keep-last 3 --keep-daily 7\n", PROGRAM_NAME);
+    printf("  %s backup 100-199 --storage pbs --per-storage 3\n", PROGRAM_NAME);
+    printf("  %s migrate --evacuate pve1 --per-target 3 --bwlimit 200\n", PROGRAM_NAME);
+    printf("  %s rebalance --timeframe day --max-moves 5\n", PROGRAM_NAME);
+    printf("  %s set 111-120 memory=8192 cores=4\n", PROGRAM_NAME);
+    printf("  %s wait 111-120 --state agent-ready --timeout 300\n", PROGRAM_NAME);
+    printf("  %s batch -f commands.txt\n", PROGRAM_NAME);
+    printf("  %s shell\n", PROGRAM_NAME);
+    printf("  %s --cluster all list\n", PROGRAM_NAME);
+    printf("  %s --cluster prod-a,prod-b stop 111-115\n", PROGRAM_NAME);
+    printf("  %s list --watch 2\n", PROGRAM_NAME);
+    printf("  %s --cache-ttl 10 list        # 供 shell 提示符/补全频繁调用\n", PROGRAM_NAME);
     printf("  %s --tui\n", PROGRAM_NAME);
 }
 
@@ -68,6 +101,10 @@ int main(int argc, char *argv[]) {
         {"tui",     no_argument,       0, 't'},
         {"config",  required_argument, 0, 'C'},
         {"mode",    required_argument, 0, 'm'},
+        {"cluster", required_argument, 0, 'K'},
+        {"parallel", required_argument, 0, 'j'},
+        {"cache-ttl", required_argument, 0, 'T'},
+        {"hedge",   no_argument,       0, 'H'},
         {"verbose", no_argument,       0, 'v'},
         {"debug",   no_argument,       0, 'd'},
         {"help",    no_argument,       0, 'h'},
@@ -78,9 +115,20 @@ int main(int argc, char *argv[]) {
     int opt;
     int option_index = 0;
     char config_file[512] = {0};
+    const char *cluster_spec = NULL;
+    
+    // 环境变量提供缓存时间的默认值，命令行选项优先
+    const char *cache_env = getenv("VMANAGER_CACHE_TTL");
+    if (cache_env) {
+        g_cache_ttl = atoi(cache_env);
+    }
+    const char *hedge_env = getenv("VMANAGER_HEDGE");
+    if (hedge_env && strcmp(hedge_env, "1") == 0) {
+        g_hedge = true;
+    }
     
     // 使用 + 前缀让 getopt 在遇到第一个非选项参数时停止
-    while ((opt = getopt_long(argc, argv, "+ctC:m:vdhV", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "+ctC:m:K:j:T:HvdhV", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'c':
                 g_ui_mode = UI_CLI;
@@ -98,6 +146,21 @@ int main(int argc, char *argv[]) {
                     g_exec_mode = MODE_REMOTE;
                 }
                 break;
+            case 'K':
+                cluster_spec = optarg;
+                break;
+            case 'j':
+                g_parallel = atoi(optarg);
+                if (g_parallel < 1) {
+                    g_parallel = 1;
+                }
+                break;
+            case 'T':
+                g_cache_ttl = atoi(optarg);
+                break;
+            case 'H':
+                g_hedge = true;
+                break;
             case 'v':
                 // verbose mode
                 break;
@@ -121,7 +184,28 @@ int main(int argc, char *argv[]) {
         snprintf(config_file, sizeof(config_file), "%s/.vmanager.conf", getenv("HOME"));
     }
     
-    if (config_load(&g_config, config_file) != 0) {
+    // 加载集群配置
+    Config clusters[MAX_CLUSTERS];
+    int cluster_total = config_load_clusters(config_file, clusters, MAX_CLUSTERS);
+    
+    if (cluster_spec) {
+        if (cluster_total <= 0) {
+            fprintf(stderr, "错误：配置文件中没有可用的集群\n");
+            return 1;
+        }
+        g_cluster_count = cluster_select(cluster_spec, clusters, cluster_total,
+                                         g_clusters, MAX_CLUSTERS);
+        if (g_cluster_count <= 0) {
+            return 1;
+        }
+        // 第一个集群作为默认配置；只选中一个集群时与单集群用法完全相同
+        g_config = g_clusters[0];
+    } else if (config_load(&g_config, config_file) == 0) {
+        // 使用 [server]/[auth] 配置
+    } else if (cluster_total > 0) {
+        // 只配置了 [cluster NAME] 时使用第一个集群
+        g_config = clusters[0];
+    } else {
         fprintf(stderr, "警告：无法加载配置文件，使用配置向导\n");
         if (config_wizard(&g_config) != 0) {
             fprintf(stderr, "错误：配置失败\n");
@@ -138,7 +222,10 @@ int main(int argc, char *argv[]) {
     int ret = 0;
     
     // 选择 UI 模式
-    if (g_ui_mode == UI_TUI) {
+    if (g_ui_mode == UI_TUI && g_cluster_count > 1) {
+        fprintf(stderr, "错误：TUI 模式暂不支持多集群，请使用 --cluster NAME 指定单个集群\n");
+        ret = 1;
+    } else if (g_ui_mode == UI_TUI) {
         g_tui_mode = true;  // 设置 TUI 模式标志
         ret = tui_main();
     } else {
@@ -0,0 +1,425 @@
+/*
+ * batch 命令
+ * 从文件或标准输入逐行读取命令（语法与命令行相同），在同一个进程和 API 会话中执行，
+ * 每条命令输出一行 JSON 结果；相邻且 VMID 不重叠的电源操作合并为一组并发执行
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define BATCH_MAX_ARGS 256
+#define BATCH_GROUP_MAX 64          // 一组最多合并的命令数
+
+// 按行读取输入；自己管理缓冲区，才能知道下一行是否已经到达
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t cap;
+    bool eof;
+} LineReader;
+
+typedef struct {
+    int line;               // 输入中的行号
+    char *text;             // 命令原文（去掉首尾空白）
+    const char *action;     // 电源操作；NULL 表示通过 cli_main 执行
+    const char *label;
+    int first_op;           // 在组内 ops 中的起始下标
+    int op_count;
+    int rc;
+    double ms;
+    char *out;
+    char *err;
+} BatchCommand;
+
+// 组内单个 VM 的电源操作
+typedef struct {
+    int vmid;
+    const char *action;
+    int ret;
+    char error[256];
+    double ms;
+} BatchOp;
+
+typedef struct {
+    BatchCommand commands[BATCH_GROUP_MAX];
+    int count;
+    BatchOp *ops;
+    int op_count;
+} BatchGroup;
+
+typedef struct {
+    int total;
+    int failed;
+} BatchStats;
+
+// 读取一行（不含换行符），输入结束返回 NULL；返回的指针在下次调用前有效
+static char* reader_next(LineReader *r, size_t *consumed) {
+    for (;;) {
+        char *nl = r->data ? memchr(r->data, '\n', r->len) : NULL;
+        if (nl) {
+            *nl = '\0';
+            *consumed = (size_t)(nl - r->data) + 1;
+            return r->data;
+        }
+        if (r->eof) {
+            if (r->len == 0) return NULL;
+            // 最后一行没有换行符
+            if (r->len == r->cap) {
+                char *data = realloc(r->data, r->cap + 1);
+                if (!data) return NULL;
+                r->data = data;
+                r->cap++;
+            }
+            r->data[r->len] = '\0';
+            *consumed = r->len;
+            return r->data;
+        }
+        
+        if (r->cap - r->len < 4096) {
+            size_t cap = r->cap ? r->cap * 2 : 8192;
+            char *data = realloc(r->data, cap);
+            if (!data) return NULL;
+            r->data = data;
+            r->cap = cap;
+        }
+        ssize_t n = read(r->fd, r->data + r->len, r->cap - r->len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            r->eof = true;
+        } else {
+            r->len += (size_t)n;
+        }
+    }
+}
+
+static void reader_consume(LineReader *r, size_t consumed) {
+    if (consumed == 0) return;
+    memmove(r->data, r->data + consumed, r->len - consumed);
+    r->len -= consumed;
+}
+
+// 缓冲区中已有完整的一行，或者输入端已经写入了数据
+static bool reader_ready(const LineReader *r) {
+    if (r->eof || (r->data && memchr(r->data, '\n', r->len))) return true;
+    
+    struct pollfd pfd = { .fd = r->fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+// 读取临时文件内容并去掉颜色转义序列
+static char* read_capture(FILE *fp) {
+    long size = ftell(fp);
+    if (size < 0) size = 0;
+    char *buf = malloc((size_t)size + 1);
+    if (!buf) return NULL;
+    
+    rewind(fp);
+    size_t n = fread(buf, 1, (size_t)size, fp);
+    
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (buf[i] == '\033' && i + 1 < n && buf[i + 1] == '[') {
+            i += 2;
+            while (i < n && !(buf[i] >= '@' && buf[i] <= '~')) i++;
+            continue;
+        }
+        buf[j++] = buf[i];
+    }
+    buf[j] = '\0';
+    return buf;
+}
+
+// 通过 cli_main 执行一条命令，捕获标准输出和标准错误；
+// 标准输入指向 /dev/null，确认提示直接取消而不会读走后续命令
+static void run_captured(BatchCommand *cmd, int argc, char *argv[]) {
+    FILE *out = tmpfile();
+    FILE *err = tmpfile();
+    int devnull = open("/dev/null", O_RDONLY);
+    if (!out || !err || devnull < 0) {
+        cmd->rc = 1;
+        cmd->err = strdup("无法创建临时文件");
+        if (out) fclose(out);
+        if (err) fclose(err);
+        if (devnull >= 0) close(devnull);
+        return;
+    }
+    
+    fflush(stdout);
+    fflush(stderr);
+    int saved_in = dup(STDIN_FILENO);
+    int saved_out = dup(STDOUT_FILENO);
+    int saved_err = dup(STDERR_FILENO);
+    dup2(devnull, STDIN_FILENO);
+    dup2(fileno(out), STDOUT_FILENO);
+    dup2(fileno(err), STDERR_FILENO);
+    close(devnull);
+    
+    double start = now_monotonic();
+    cmd->rc = cli_main(argc, argv);
+    cmd->ms = (now_monotonic() - start) * 1000.0;
+    
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_in, STDIN_FILENO);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(saved_in);
+    close(saved_out);
+    close(saved_err);
+    clearerr(stdin);
+    
+    cmd->out = read_capture(out);
+    cmd->err = read_capture(err);
+    fclose(out);
+    fclose(err);
+}
+
+static void emit(BatchCommand *cmd, BatchStats *stats) {
+    cJSON *record = cJSON_CreateObject();
+    cJSON_AddNumberToObject(record, "line", cmd->line);
+    cJSON_AddStringToObject(record, "command", cmd->text);
+    cJSON_AddNumberToObject(record, "exit", cmd->rc);
+    cJSON_AddNumberToObject(record, "ms", (double)(long)(cmd->ms * 10.0 + 0.5) / 10.0);
+    cJSON_AddStringToObject(record, "stdout", cmd->out ? cmd->out : "");
+    cJSON_AddStringToObject(record, "stderr", cmd->err ? cmd->err : "");
+    
+    char *json = cJSON_PrintUnformatted(record);
+    if (json) {
+        printf("%s\n", json);
+        free(json);
+    }
+    fflush(stdout);
+    cJSON_Delete(record);
+    
+    stats->total++;
+    if (cmd->rc != 0) stats->failed++;
+    
+    free(cmd->text);
+    free(cmd->out);
+    free(cmd->err);
+    cmd->text = cmd->out = cmd->err = NULL;
+}
+
+static void power_worker(int index, void *arg) {
+    BatchOp *op = &((BatchGroup *)arg)->ops[index];
+    double start = now_monotonic();
+    op->ret = api_vm_action(op->vmid, op->action) == 0 ? 0 : -1;
+    if (op->ret != 0) {
+        snprintf(op->error, sizeof(op->error), "%s", api_last_error());
+    }
+    op->ms = (now_monotonic() - start) * 1000.0;
+}
+
+// 并发执行组内所有 VM 的操作，再按输入顺序输出每条命令的结果
+static void flush_group(BatchGroup *group, BatchStats *stats) {
+    if (group->count == 0) return;
+    
+    pool_run(group->op_count, g_parallel, power_worker, group);
+    
+    for (int c = 0; c < group->count; c++) {
+        BatchCommand *cmd = &group->commands[c];
+        char *out = NULL, *err = NULL;
+        size_t out_len = 0, err_len = 0;
+        FILE *fo = open_memstream(&out, &out_len);
+        FILE *fe = open_memstream(&err, &err_len);
+        
+        int success = 0, failed = 0;
+        for (int i = cmd->first_op; i < cmd->first_op + cmd->op_count; i++) {
+            BatchOp *op = &group->ops[i];
+            if (op->ms > cmd->ms) cmd->ms = op->ms;
+            if (op->ret == 0) {
+                success++;
+                if (fo) fprintf(fo, "✓ VM %d %s成功\n", op->vmid, cmd->label);
+            } else {
+                failed++;
+                if (fe) fprintf(fe, "✗ VM %d %s失败%s%s\n", op->vmid, cmd->label,
+                                op->error[0] ? ": " : "", op->error);
+            }
+        }
+        if (fo && success + failed > 1) {
+            fprintf(fo, "\n%s 总计: %d 成功, %d 失败\n", cmd->label, success, failed);
+        }
+        if (fo) fclose(fo);
+        if (fe) fclose(fe);
+        
+        cmd->out = out;
+        cmd->err = err;
+        cmd->rc = failed > 0 ? 1 : 0;
+        emit(cmd, stats);
+    }
+    
+    group->count = 0;
+    group->op_count = 0;
+}
+
+// 识别可以合并的电源操作并展开 VMID；参数不合法时交给 cli_main 报错
+static const char* power_action(int argc, char *argv[], const char **label, int *vmids, int *count) {
+    if (g_cluster_count > 1 || argc < 2) return NULL;
+    
+    // destroy 需要确认，不合并
+    const VMAction *vm_action = cli_vm_action(argv[0]);
+    if (!vm_action || strcmp(vm_action->action, "destroy") == 0) return NULL;
+    const char *action = vm_action->action;
+    *label = vm_action->label;
+    
+    *count = 0;
+    for (int i = 1; i < argc; i++) {
+        int temp[MAX_VMIDS];
+        int n = 0;
+        if (!isdigit((unsigned char)argv[i][0]) || parse_vmid_range(argv[i], temp, &n) != 0 ||
+            n == 0 || *count + n > MAX_VMIDS) {
+            return NULL;
+        }
+        memcpy(vmids + *count, temp, (size_t)n * sizeof(int));
+        *count += n;
+    }
+    return action;
+}
+
+// VMID 与组内已有操作重叠时，两条命令的先后顺序有意义，不能并发
+static bool group_conflicts(const BatchGroup *group, const int *vmids, int count) {
+    for (int i = 0; i < group->op_count; i++) {
+        for (int j = 0; j < count; j++) {
+            if (group->ops[i].vmid == vmids[j]) return true;
+        }
+    }
+    return false;
+}
+
+static bool has_arg(int argc, char *argv[], const char *name) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+int batch_main(int argc, char *argv[]) {
+    const char *file = "-";
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--file") == 0) && i + 1 < argc) {
+            file = argv[++i];
+        } else if (strcmp(argv[i], "-") == 0) {
+            file = "-";
+        } else {
+            fprintf(stderr, "用法: %s batch [-f FILE|-]\n", PROGRAM_NAME);
+            return 1;
+        }
+    }
+    
+    LineReader reader = { .fd = STDIN_FILENO };
+    if (strcmp(file, "-") != 0) {
+        reader.fd = open(file, O_RDONLY);
+        if (reader.fd < 0) {
+            fprintf(stderr, "错误：无法打开 %s: %s\n", file, strerror(errno));
+            return 1;
+        }
+    }
+    
+    BatchGroup *group = calloc(1, sizeof(BatchGroup));
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (group) group->ops = calloc(MAX_VMIDS, sizeof(BatchOp));
+    if (!group || !group->ops || !vmids) {
+        if (group) free(group->ops);
+        free(group);
+        free(vmids);
+        if (reader.fd != STDIN_FILENO) close(reader.fd);
+        return 1;
+    }
+    
+    BatchStats stats = {0};
+    double start = now_monotonic();
+    int line_no = 0;
+    size_t consumed = 0;
+    
+    for (;;) {
+        // 上一行的参数直接指向读缓冲区，执行完才能移走
+        reader_consume(&reader, consumed);
+        consumed = 0;
+        
+        // 下一行还没到达时先执行已合并的命令，交互式驱动方不会因此卡住
+        if (group->count > 0 && !reader_ready(&reader)) {
+            flush_group(group, &stats);
+        }
+        
+        char *line = reader_next(&reader, &consumed);
+        if (!line) break;
+        line_no++;
+        
+        // 去掉首尾空白后的原文用于结果记录
+        char *text = line;
+        while (*text == ' ' || *text == '\t') text++;
+        size_t text_len = strlen(text);
+        while (text_len > 0 && (text[text_len - 1] == ' ' || text[text_len - 1] == '\t' ||
+                                text[text_len - 1] == '\r')) {
+            text[--text_len] = '\0';
+        }
+        
+        BatchCommand cmd = { .line = line_no, .text = strdup(text) };
+        char *args[BATCH_MAX_ARGS + 1];
+        int nargs = split_args(text, args, BATCH_MAX_ARGS);
+        
+        if (nargs == 0) {
+            free(cmd.text);
+            continue;
+        }
+        if (nargs < 0) {
+            flush_group(group, &stats);
+            cmd.rc = 1;
+            cmd.err = strdup("错误：引号不匹配或参数过多\n");
+            emit(&cmd, &stats);
+            continue;
+        }
+        
+        int count = 0;
+        cmd.action = power_action(nargs, args, &cmd.label, vmids, &count);
+        if (cmd.action) {
+            if (group->count >= BATCH_GROUP_MAX || group->op_count + count > MAX_VMIDS ||
+                group_conflicts(group, vmids, count)) {
+                flush_group(group, &stats);
+            }
+            cmd.first_op = group->op_count;
+            cmd.op_count = count;
+            for (int i = 0; i < count; i++) {
+                BatchOp *op = &group->ops[group->op_count++];
+                memset(op, 0, sizeof(*op));
+                op->vmid = vmids[i];
+                op->action = cmd.action;
+            }
+            group->commands[group->count++] = cmd;
+            continue;
+        }
+        
+        // 其他命令的结果可能依赖前面的操作，先执行完已合并的组
+        flush_group(group, &stats);
+        
+        if (strcmp(args[0], "batch") == 0) {
+            cmd.rc = 1;
+            cmd.err = strdup("错误：batch 不能嵌套\n");
+        } else if (strcmp(args[0], "list") == 0 && has_arg(nargs, args, "--watch")) {
+            cmd.rc = 1;
+            cmd.err = strdup("错误：batch 中不支持 list --watch\n");
+        } else {
+            run_captured(&cmd, nargs, args);
+        }
+        emit(&cmd, &stats);
+    }
+    flush_group(group, &stats);
+    
+    RetryStats retry;
+    api_retry_stats(&retry);
+    fprintf(stderr, "batch: %d 条命令, %d 失败, 重试 %ld 次 (%.1fs)\n",
+            stats.total, stats.failed, retry.retries, now_monotonic() - start);
+    
+    free(reader.data);
+    if (reader.fd != STDIN_FILENO) close(reader.fd);
+    free(group->ops);
+    free(group);
+    free(vmids);
+    return stats.failed > 0 ? 1 : 0;
+}
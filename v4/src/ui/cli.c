@@ -5,6 +5,8 @@
 
 #include "../../include/vmanager.h"
 #include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
 
 // 批量执行 VM 操作的辅助函数
 static int batch_vm_operation(int argc, char *argv[], int (*operation)(int), const char *op_name) {
@@ -70,6 +72,673 @@ static int batch_vm_operation(int argc, char *argv[], int (*operation)(int), con
     return (failed > 0) ? 1 : 0;
 }
 
+// 解析一个 VMID 参数（单个、范围或逗号分隔）并去重追加到 vmids
+static int append_vmids(const char *arg, int *vmids, int *total) {
+    int temp[MAX_VMIDS];
+    int count = 0;
+    
+    if (!isdigit((unsigned char)arg[0])) {
+        fprintf(stderr, "错误：无效的 VMID: %s\n", arg);
+        return -1;
+    }
+    if (parse_vmid_range(arg, temp, &count) != 0) {
+        fprintf(stderr, "错误：VMID 数量超过上限 %d: %s\n", MAX_VMIDS, arg);
+        return -1;
+    }
+    if (count == 0) {
+        fprintf(stderr, "错误：无效的 VMID: %s\n", arg);
+        return -1;
+    }
+    
+    for (int j = 0; j < count; j++) {
+        bool dup = false;
+        for (int k = 0; k < *total; k++) {
+            if (vmids[k] == temp[j]) {
+                dup = true;
+                break;
+            }
+        }
+        if (dup) continue;
+        if (*total >= MAX_VMIDS) {
+            fprintf(stderr, "错误：VMID 数量超过上限 %d: %s\n", MAX_VMIDS, arg);
+            return -1;
+        }
+        vmids[(*total)++] = temp[j];
+    }
+    
+    return 0;
+}
+
+// 读取选项的参数值
+static const char* option_value(int argc, char *argv[], int *i) {
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "错误：选项 %s 需要参数\n", argv[*i]);
+        return NULL;
+    }
+    return argv[++(*i)];
+}
+
+// 确认提示，返回 true 表示继续
+static bool confirm_prompt(void) {
+    printf("确认继续？(y/n): ");
+    
+    char confirm[10];
+    if (fgets(confirm, sizeof(confirm), stdin)) {
+        confirm[strcspn(confirm, "\n")] = '\0';
+        if (strcasecmp(confirm, "y") == 0 || strcasecmp(confirm, "yes") == 0) {
+            return true;
+        }
+    }
+    
+    printf("操作已取消\n");
+    return false;
+}
+
+// snapshot 命令
+static int cli_snapshot(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "用法: %s snapshot create|list|rollback|delete|prune VMID... [OPTIONS]\n", PROGRAM_NAME);
+        fprintf(stderr, "示例: %s snapshot create 100-150 --name before-upgrade\n", PROGRAM_NAME);
+        fprintf(stderr, "      %s snapshot prune 100-150 --keep-last 3 --keep-daily 7\n", PROGRAM_NAME);
+        return 1;
+    }
+    
+    SnapshotOptions opts = {0};
+    snprintf(opts.prefix, sizeof(opts.prefix), "auto-");
+    opts.per_storage = 4;
+    opts.timeout = 600;
+    
+    const char *action = argv[1];
+    if (strcmp(action, "create") == 0) {
+        opts.action = SNAP_CREATE;
+    } else if (strcmp(action, "list") == 0) {
+        opts.action = SNAP_LIST;
+    } else if (strcmp(action, "rollback") == 0) {
+        opts.action = SNAP_ROLLBACK;
+    } else if (strcmp(action, "delete") == 0) {
+        opts.action = SNAP_DELETE;
+    } else if (strcmp(action, "prune") == 0) {
+        opts.action = SNAP_PRUNE;
+    } else {
+        fprintf(stderr, "错误：未知的快照操作: %s\n", action);
+        return 1;
+    }
+    
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (!vmids) return 1;
+    int total = 0;
+    bool force = false;
+    
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        
+        if (arg[0] != '-') {
+            if (append_vmids(arg, vmids, &total) != 0) goto fail;
+        } else if (strcmp(arg, "--name") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.name, sizeof(opts.name), "%s", val);
+        } else if (strcmp(arg, "--description") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.description, sizeof(opts.description), "%s", val);
+        } else if (strcmp(arg, "--prefix") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.prefix, sizeof(opts.prefix), "%s", val);
+        } else if (strcmp(arg, "--keep-last") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.keep_last = atoi(val);
+        } else if (strcmp(arg, "--keep-daily") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.keep_daily = atoi(val);
+        } else if (strcmp(arg, "--per-storage") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.per_storage = atoi(val);
+        } else if (strcmp(arg, "--timeout") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.timeout = atoi(val);
+        } else if (strcmp(arg, "--vmstate") == 0) {
+            opts.vmstate = true;
+        } else if (strcmp(arg, "--dry-run") == 0) {
+            opts.dry_run = true;
+        } else if (strcmp(arg, "-f") == 0 || strcmp(arg, "--force") == 0) {
+            force = true;
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            goto fail;
+        }
+    }
+    
+    if (total == 0) {
+        fprintf(stderr, "错误：未指定有效的 VMID\n");
+        goto fail;
+    }
+    
+    if ((opts.action == SNAP_ROLLBACK || opts.action == SNAP_DELETE) && opts.name[0] == '\0') {
+        fprintf(stderr, "错误：%s 需要 --name 指定快照名\n", action);
+        goto fail;
+    }
+    
+    // 回滚会丢弃当前状态，需要确认
+    if (opts.action == SNAP_ROLLBACK && !force) {
+        printf("\033[33m警告：%d 个 VM 将回滚到快照 %s，当前状态将丢失！\033[0m\n",
+               total, opts.name);
+        if (!confirm_prompt()) {
+            free(vmids);
+            return 0;
+        }
+    }
+    
+    int ret = snapshot_run(vmids, total, &opts);
+    free(vmids);
+    return (ret != 0) ? 1 : 0;
+
+fail:
+    free(vmids);
+    return 1;
+}
+
+// backup 命令
+static int cli_backup(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法: %s backup VMID... [--storage S] [OPTIONS]\n", PROGRAM_NAME);
+        fprintf(stderr, "选项: --mode snapshot|suspend|stop --compress zstd|lzo|gzip|0 --per-storage N --per-node N\n");
+        fprintf(stderr, "      --bwlimit MiB/s --timeout SEC --dry-run\n");
+        return 1;
+    }
+    
+    BackupOptions opts = {0};
+    snprintf(opts.mode, sizeof(opts.mode), "snapshot");
+    snprintf(opts.compress, sizeof(opts.compress), "zstd");
+    opts.per_storage = 2;
+    opts.per_node = 1;
+    opts.timeout = 4 * 3600;
+    
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (!vmids) return 1;
+    int total = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        
+        if (arg[0] != '-') {
+            if (append_vmids(arg, vmids, &total) != 0) goto fail;
+        } else if (strcmp(arg, "--storage") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.storage, sizeof(opts.storage), "%s", val);
+        } else if (strcmp(arg, "--mode") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            if (strcmp(val, "snapshot") != 0 && strcmp(val, "suspend") != 0 && strcmp(val, "stop") != 0) {
+                fprintf(stderr, "错误：--mode 只能是 snapshot、suspend 或 stop\n");
+                goto fail;
+            }
+            snprintf(opts.mode, sizeof(opts.mode), "%s", val);
+        } else if (strcmp(arg, "--compress") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.compress, sizeof(opts.compress), "%s", val);
+        } else if (strcmp(arg, "--per-storage") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.per_storage = atoi(val);
+        } else if (strcmp(arg, "--per-node") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.per_node = atoi(val);
+        } else if (strcmp(arg, "--bwlimit") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.bwlimit = atoi(val) * 1024;        // PVE 的 bwlimit 单位为 KiB/s
+        } else if (strcmp(arg, "--timeout") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.timeout = atoi(val);
+        } else if (strcmp(arg, "--dry-run") == 0) {
+            opts.dry_run = true;
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            goto fail;
+        }
+    }
+    
+    if (total == 0) {
+        fprintf(stderr, "错误：未指定有效的 VMID\n");
+        goto fail;
+    }
+    
+    int ret = backup_run(vmids, total, &opts);
+    free(vmids);
+    return (ret != 0) ? 1 : 0;
+
+fail:
+    free(vmids);
+    return 1;
+}
+
+// migrate 命令
+static int cli_migrate(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "用法: %s migrate VMID... --to NODE [OPTIONS]\n", PROGRAM_NAME);
+        fprintf(stderr, "      %s migrate --evacuate NODE [--to NODE] [OPTIONS]\n", PROGRAM_NAME);
+        fprintf(stderr, "选项: --per-source N --per-target N --bwlimit MiB/s --with-local-disks --timeout SEC --dry-run\n");
+        return 1;
+    }
+    
+    MigrateOptions opts = {0};
+    opts.per_source = 2;
+    opts.per_target = 2;
+    opts.timeout = 3600;
+    
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (!vmids) return 1;
+    int total = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        
+        if (arg[0] != '-') {
+            if (append_vmids(arg, vmids, &total) != 0) goto fail;
+        } else if (strcmp(arg, "--to") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.target, sizeof(opts.target), "%s", val);
+        } else if (strcmp(arg, "--evacuate") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            snprintf(opts.evacuate, sizeof(opts.evacuate), "%s", val);
+        } else if (strcmp(arg, "--per-source") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.per_source = atoi(val);
+        } else if (strcmp(arg, "--per-target") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.per_target = atoi(val);
+        } else if (strcmp(arg, "--bwlimit") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.bwlimit = atoi(val) * 1024;        // PVE 的 bwlimit 单位为 KiB/s
+        } else if (strcmp(arg, "--with-local-disks") == 0) {
+            opts.with_local_disks = true;
+        } else if (strcmp(arg, "--timeout") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.timeout = atoi(val);
+        } else if (strcmp(arg, "--dry-run") == 0) {
+            opts.dry_run = true;
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            goto fail;
+        }
+    }
+    
+    if (opts.evacuate[0] && total > 0) {
+        fprintf(stderr, "错误：--evacuate 迁移节点上的所有 VM，不能同时指定 VMID\n");
+        goto fail;
+    }
+    if (!opts.evacuate[0] && total == 0) {
+        fprintf(stderr, "错误：未指定有效的 VMID\n");
+        goto fail;
+    }
+    if (!opts.evacuate[0] && !opts.target[0]) {
+        fprintf(stderr, "错误：需要 --to 指定目标节点\n");
+        goto fail;
+    }
+    
+    int ret = migrate_run(vmids, total, &opts);
+    free(vmids);
+    return (ret != 0) ? 1 : 0;
+
+fail:
+    free(vmids);
+    return 1;
+}
+
+// rebalance 命令
+static int cli_rebalance(int argc, char *argv[]) {
+    RebalanceOptions opts = {0};
+    opts.max_moves = 10;
+    opts.mem_limit = 85;
+    snprintf(opts.timeframe, sizeof(opts.timeframe), "hour");
+    opts.migrate.per_source = 2;
+    opts.migrate.per_target = 2;
+    opts.migrate.timeout = 3600;
+    
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        
+        if (strcmp(arg, "--plan") == 0) {
+            opts.apply = false;
+        } else if (strcmp(arg, "--apply") == 0) {
+            opts.apply = true;
+        } else if (strcmp(arg, "--max-moves") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.max_moves = atoi(val);
+        } else if (strcmp(arg, "--mem-limit") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.mem_limit = atoi(val);
+        } else if (strcmp(arg, "--timeframe") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            if (strcmp(val, "hour") != 0 && strcmp(val, "day") != 0 && strcmp(val, "week") != 0) {
+                fprintf(stderr, "错误：--timeframe 只能是 hour、day 或 week\n");
+                return 1;
+            }
+            snprintf(opts.timeframe, sizeof(opts.timeframe), "%s", val);
+        } else if (strcmp(arg, "--per-source") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.migrate.per_source = atoi(val);
+        } else if (strcmp(arg, "--per-target") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.migrate.per_target = atoi(val);
+        } else if (strcmp(arg, "--bwlimit") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.migrate.bwlimit = atoi(val) * 1024;
+        } else if (strcmp(arg, "--timeout") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.migrate.timeout = atoi(val);
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            fprintf(stderr, "用法: %s rebalance [--plan|--apply] [--max-moves N] [--timeframe hour|day|week]\n", PROGRAM_NAME);
+            return 1;
+        }
+    }
+    
+    if (opts.max_moves <= 0) {
+        fprintf(stderr, "错误：--max-moves 必须大于 0\n");
+        return 1;
+    }
+    
+    return rebalance_run(&opts) != 0 ? 1 : 0;
+}
+
+// 配置项名：小写字母开头，只含小写字母、数字、- 和 _；digest/delete 由 set 自己填写
+static bool valid_config_key(const char *key) {
+    if (!islower((unsigned char)key[0])) return false;
+    for (const char *p = key; *p; p++) {
+        if (!islower((unsigned char)*p) && !isdigit((unsigned char)*p) && *p != '-' && *p != '_') {
+            return false;
+        }
+    }
+    return strcmp(key, "digest") != 0 && strcmp(key, "delete") != 0;
+}
+
+// 追加一个配置修改项，value 为 NULL 表示删除
+static int append_change(SetOptions *opts, const char *key, size_t key_len, const char *value) {
+    if (opts->count >= SET_MAX_CHANGES) {
+        fprintf(stderr, "错误：一次最多修改 %d 个配置项\n", SET_MAX_CHANGES);
+        return -1;
+    }
+    
+    ConfigChange *c = &opts->changes[opts->count];
+    if (key_len >= sizeof(c->key) || (value && strlen(value) >= sizeof(c->value))) {
+        fprintf(stderr, "错误：配置项过长: %.*s\n", (int)key_len, key);
+        return -1;
+    }
+    memcpy(c->key, key, key_len);
+    c->key[key_len] = '\0';
+    if (!valid_config_key(c->key)) {
+        fprintf(stderr, "错误：无效的配置项: %s\n", c->key);
+        return -1;
+    }
+    
+    for (int i = 0; i < opts->count; i++) {
+        if (strcmp(opts->changes[i].key, c->key) == 0) {
+            fprintf(stderr, "错误：配置项重复: %s\n", c->key);
+            return -1;
+        }
+    }
+    
+    c->remove = (value == NULL);
+    snprintf(c->value, sizeof(c->value), "%s", value ? value : "");
+    opts->count++;
+    return 0;
+}
+
+// set 命令
+static int cli_set(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "用法: %s set VMID... KEY=VALUE... [--delete KEY] [--dry-run]\n", PROGRAM_NAME);
+        fprintf(stderr, "示例: %s set 100-150 memory=8192 cores=4 onboot=1\n", PROGRAM_NAME);
+        fprintf(stderr, "      %s set 100-150 tags=prod --delete balloon --dry-run\n", PROGRAM_NAME);
+        return 1;
+    }
+    
+    SetOptions *opts = calloc(1, sizeof(SetOptions));
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (!opts || !vmids) {
+        free(opts);
+        free(vmids);
+        return 1;
+    }
+    int total = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        const char *eq = strchr(arg, '=');
+        
+        if (arg[0] != '-' && eq) {
+            if (append_change(opts, arg, (size_t)(eq - arg), eq + 1) != 0) goto fail;
+        } else if (arg[0] != '-') {
+            if (append_vmids(arg, vmids, &total) != 0) goto fail;
+        } else if (strcmp(arg, "--delete") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            if (append_change(opts, val, strlen(val), NULL) != 0) goto fail;
+        } else if (strcmp(arg, "--dry-run") == 0) {
+            opts->dry_run = true;
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            goto fail;
+        }
+    }
+    
+    if (total == 0) {
+        fprintf(stderr, "错误：未指定有效的 VMID\n");
+        goto fail;
+    }
+    if (opts->count == 0) {
+        fprintf(stderr, "错误：未指定要修改的配置项 (KEY=VALUE)\n");
+        goto fail;
+    }
+    
+    int ret = set_run(vmids, total, opts);
+    free(opts);
+    free(vmids);
+    return (ret != 0) ? 1 : 0;
+
+fail:
+    free(opts);
+    free(vmids);
+    return 1;
+}
+
+// wait 命令
+static int cli_wait(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "用法: %s wait VMID... --state running|stopped|agent-ready [--timeout SEC] [--any]\n", PROGRAM_NAME);
+        fprintf(stderr, "示例: %s wait 100-150 --state agent-ready --timeout 300\n", PROGRAM_NAME);
+        return 1;
+    }
+    
+    WaitOptions opts = {0};
+    opts.state = WAIT_RUNNING;
+    opts.timeout = 300;
+    
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (!vmids) return 1;
+    int total = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        
+        if (arg[0] != '-') {
+            if (append_vmids(arg, vmids, &total) != 0) goto fail;
+        } else if (strcmp(arg, "--state") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            if (strcmp(val, "running") == 0) {
+                opts.state = WAIT_RUNNING;
+            } else if (strcmp(val, "stopped") == 0) {
+                opts.state = WAIT_STOPPED;
+            } else if (strcmp(val, "agent-ready") == 0) {
+                opts.state = WAIT_AGENT_READY;
+            } else {
+                fprintf(stderr, "错误：未知的状态: %s（可选 running、stopped、agent-ready）\n", val);
+                goto fail;
+            }
+        } else if (strcmp(arg, "--timeout") == 0) {
+            if (!(val = option_value(argc, argv, &i))) goto fail;
+            opts.timeout = atoi(val);
+            if (opts.timeout <= 0) {
+                fprintf(stderr, "错误：无效的超时: %s\n", val);
+                goto fail;
+            }
+        } else if (strcmp(arg, "--any") == 0) {
+            opts.any = true;
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            goto fail;
+        }
+    }
+    
+    if (total == 0) {
+        fprintf(stderr, "错误：未指定有效的 VMID\n");
+        goto fail;
+    }
+    
+    int ret = wait_run(vmids, total, &opts);
+    free(vmids);
+    return (ret != 0) ? 1 : 0;
+
+fail:
+    free(vmids);
+    return 1;
+}
+
+// 批量 clone 命令
+static int cli_clone_many(int argc, char *argv[]) {
+    CloneOptions opts = {0};
+    opts.source = is_number(argv[1]) ? atoi(argv[1]) : 0;
+    opts.per_storage = 2;
+    opts.timeout = 3600;
+    
+    if (opts.source <= 0) {
+        fprintf(stderr, "错误：无效的 VMID: %s\n", argv[1]);
+        return 1;
+    }
+    
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = NULL;
+        
+        if (strcmp(arg, "--count") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.count = atoi(val);
+        } else if (strcmp(arg, "--start-id") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.start_id = atoi(val);
+        } else if (strcmp(arg, "--name-pattern") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            snprintf(opts.name_pattern, sizeof(opts.name_pattern), "%s", val);
+        } else if (strcmp(arg, "--storage") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            snprintf(opts.storage, sizeof(opts.storage), "%s", val);
+        } else if (strcmp(arg, "--target") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            snprintf(opts.target, sizeof(opts.target), "%s", val);
+        } else if (strcmp(arg, "--per-storage") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.per_storage = atoi(val);
+        } else if (strcmp(arg, "--timeout") == 0) {
+            if (!(val = option_value(argc, argv, &i))) return 1;
+            opts.timeout = atoi(val);
+        } else if (strcmp(arg, "--linked") == 0) {
+            opts.mode = CLONE_LINKED;
+        } else if (strcmp(arg, "--full") == 0) {
+            opts.mode = CLONE_FULL;
+        } else {
+            fprintf(stderr, "错误：未知选项: %s\n", arg);
+            return 1;
+        }
+    }
+    
+    if (opts.count <= 0 || opts.count > MAX_VMIDS) {
+        fprintf(stderr, "错误：--count 必须在 1-%d 之间\n", MAX_VMIDS);
+        return 1;
+    }
+    
+    return (clone_run(&opts) != 0) ? 1 : 0;
+}
+
+static const VMAction vm_actions[] = {
+    { "start",   "start",   "启动" },
+    { "stop",    "stop",    "停止" },
+    { "reboot",  "reboot",  "重启" },
+    { "restart", "reboot",  "重启" },
+    { "suspend", "suspend", "暂停" },
+    { "resume",  "resume",  "恢复" },
+    { "destroy", "destroy", "销毁" },
+};
+
+// 查找命令对应的 VM 操作，不是这类命令时返回 NULL
+const VMAction* cli_vm_action(const char *command) {
+    for (size_t i = 0; i < sizeof(vm_actions) / sizeof(vm_actions[0]); i++) {
+        if (strcmp(command, vm_actions[i].command) == 0) {
+            return &vm_actions[i];
+        }
+    }
+    return NULL;
+}
+
+// 多集群模式：命令并发发往 --cluster 选中的所有集群
+static int cli_multi_cluster(int argc, char *argv[]) {
+    const char *command = argv[0];
+    
+    if (strcmp(command, "list") == 0) {
+        return (cluster_list(g_clusters, g_cluster_count) != 0) ? 1 : 0;
+    }
+    
+    const VMAction *vm_action = cli_vm_action(command);
+    const char *action = vm_action ? vm_action->action : NULL;
+    const char *label = vm_action ? vm_action->label : NULL;
+    
+    if (!action && strcmp(command, "status") != 0) {
+        fprintf(stderr, "错误：命令 %s 不支持多集群，请使用 --cluster NAME 指定单个集群\n", command);
+        return 1;
+    }
+    
+    int *vmids = malloc(MAX_VMIDS * sizeof(int));
+    if (!vmids) return 1;
+    
+    int total = 0;
+    bool force = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (append_vmids(argv[i], vmids, &total) != 0) {
+            free(vmids);
+            return 1;
+        }
+    }
+    
+    if (total == 0) {
+        fprintf(stderr, "用法: %s --cluster LIST %s VMID...\n", PROGRAM_NAME, command);
+        free(vmids);
+        return 1;
+    }
+    
+    // 删除操作涉及多个集群，必须确认
+    if (action && strcmp(action, "destroy") == 0 && !force) {
+        printf("\033[33m警告：此操作将在以下集群中永久删除 %d 个 VMID 对应的 VM！\033[0m\n", total);
+        printf("集群列表：");
+        for (int i = 0; i < g_cluster_count; i++) {
+            printf("%s%s", g_clusters[i].name, (i < g_cluster_count - 1) ? ", " : "\n");
+        }
+        if (!confirm_prompt()) {
+            free(vmids);
+            return 0;
+        }
+    }
+    
+    int ret = action
+        ? cluster_action(g_clusters, g_cluster_count, vmids, total, action, label)
+        : cluster_status(g_clusters, g_cluster_count, vmids, total);
+    
+    free(vmids);
+    return (ret != 0) ? 1 : 0;
+}
+
 // CLI 主函数
 int cli_main(int argc, char *argv[]) {
     if (argc < 1) {
@@ -80,18 +749,46 @@ int cli_main(int argc, char *argv[]) {
     
     const char *command = argv[0];
     
+    // batch 的每一行再交给 cli_main，多集群时同样逐行分发
+    if (strcmp(command, "batch") == 0) {
+        return batch_main(argc, argv);
+    }
+    
+    if (strcmp(command, "shell") == 0) {
+        return shell_main(argc, argv);
+    }
+    
+    if (g_cluster_count > 1) {
+        return cli_multi_cluster(argc, argv);
+    }
+    
     // list 命令
     if (strcmp(command, "list") == 0) {
         bool verbose = false;
+        double watch = 0;
         
-        // 检查 -v 或 --verbose 选项
+        // 检查 -v/--verbose 和 --watch INTERVAL 选项
         for (int i = 1; i < argc; i++) {
             if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
                 verbose = true;
-                break;
+            } else if (strcmp(argv[i], "--watch") == 0) {
+                // 缺少间隔与无效间隔同样报错，不退回一次性列表
+                const char *interval = i + 1 < argc ? argv[++i] : "";
+                watch = atof(interval);
+                if (watch <= 0) {
+                    fprintf(stderr, "错误：无效的刷新间隔: %s\n", interval);
+                    return 1;
+                }
             }
         }
         
+        if (watch > 0) {
+            if (verbose) {
+                fprintf(stderr, "错误：--watch 不支持 -v（详细信息需要逐个 VM 请求）\n");
+                return 1;
+            }
+            return watch_vm_list(watch) == 0 ? 0 : 1;
+        }
         return vm_list(verbose);
     }
     
@@ -235,15 +932,9 @@ int cli_main(int argc, char *argv[]) {
             for (int i = 0; i < total_count; i++) {
                 printf("%d%s", vmids[i], (i < total_count - 1) ? ", " : "\n");
             }
-            printf("确认继续？(y/n): ");
-            
-            char confirm[10];
-            if (fgets(confirm, sizeof(confirm), stdin)) {
-                confirm[strcspn(confirm, "\n")] = '\0';
-                if (strcasecmp(confirm, "y") != 0 && strcasecmp(confirm, "yes") != 0) {
-                    printf("操作已取消\n");
-                    return 0;
-                }
+            // 输入结束（EOF）同样视为取消
+            if (!confirm_prompt()) {
+                return 0;
             }
         }
         
@@ -264,8 +955,16 @@ int cli_main(int argc, char *argv[]) {
     
     // clone 命令
     if (strcmp(command, "clone") == 0) {
+        // 批量模式: clone TEMPLATE --count N ...
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--count") == 0) {
+                return cli_clone_many(argc, argv);
+            }
+        }
+        
         if (argc < 3) {
             fprintf(stderr, "用法: %s clone VMID NEWID [--name NAME]\n", PROGRAM_NAME);
+            fprintf(stderr, "      %s clone TEMPLATE --count N [--start-id X] [--name-pattern web-%%d]\n", PROGRAM_NAME);
             return 1;
         }
         
@@ -285,6 +984,36 @@ int cli_main(int argc, char *argv[]) {
         return vm_clone(vmid, newid, name);
     }
     
+    // snapshot 命令
+    if (strcmp(command, "snapshot") == 0) {
+        return cli_snapshot(argc, argv);
+    }
+    
+    // backup 命令
+    if (strcmp(command, "backup") == 0) {
+        return cli_backup(argc, argv);
+    }
+    
+    // migrate 命令
+    if (strcmp(command, "migrate") == 0) {
+        return cli_migrate(argc, argv);
+    }
+    
+    // rebalance 命令
+    if (strcmp(command, "rebalance") == 0) {
+        return cli_rebalance(argc, argv);
+    }
+    
+    // set 命令
+    if (strcmp(command, "set") == 0) {
+        return cli_set(argc, argv);
+    }
+    
+    // wait 命令
+    if (strcmp(command, "wait") == 0) {
+        return cli_wait(argc, argv);
+    }
+    
     // 未知命令
     fprintf(stderr, "错误：未知命令: %s\n", command);
     fprintf(stderr, "使用 --help 查看帮助信息\n");
@@ -298,42 +1027,38 @@ void cli_print_vm_list(VMInfo *vms, int count, bool verbose) {
         return;
     }
     
-    // 打印表头
-    printf("\033[1m");
-    if (verbose) {
-        printf("%-6s %-20s %-10s %-6s %-10s %-10s %-10s %-15s\n",
-               "VMID", "NAME", "STATUS", "CPU%", "MEM", "DISK", "UPTIME", "IP");
-        printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
-    } else {
-        printf("%-6s %-20s %-10s %-6s %-10s\n",
-               "VMID", "NAME", "STATUS", "CPU%", "MEM");
-        printf("────────────────────────────────────────────────────────────\n");
-    }
-    printf("\033[0m");
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+        { "DISK", true },
+        { "UPTIME", true },
+        { "IP", false },
+    };
+    Table table;
+    table_init(&table, columns, verbose ? 8 : 5);
     
-    // 打印每个 VM
+    char buf[FORMAT_LEN];
     for (int i = 0; i < count; i++) {
         VMInfo *vm = &vms[i];
-        
+        table_cell(&table, "%d", vm->vmid);
+        table_cell(&table, "%s", vm->name);
+        table_cell(&table, "%s", vm->status);
+        table_cell(&table, "%.1f%%", vm->cpu_percent);
+        table_cell(&table, "%s", format_bytes(vm->mem, buf, sizeof(buf)));
         if (verbose) {
-            printf("%-6d %-20s %-10s %5.1f%% %-10s %-10s %-10s %-15s\n",
-                   vm->vmid,
-                   vm->name,
-                   vm->status,
-                   vm->cpu_percent,
-                   format_bytes(vm->mem),
-                   format_bytes(vm->disk),
-                   format_uptime(vm->uptime),
-                   vm->ip_address[0] ? vm->ip_address : "N/A");
-        } else {
-            printf("%-6d %-20s %-10s %5.1f%% %-10s\n",
-                   vm->vmid,
-                   vm->name,
-                   vm->status,
-                   vm->cpu_percent,
-                   format_bytes(vm->mem));
+            table_cell(&table, "%s", format_bytes(vm->disk, buf, sizeof(buf)));
+            table_cell(&table, "%s", format_uptime(vm->uptime, buf, sizeof(buf)));
+            table_cell(&table, "%s", vm->ip_address[0] ? vm->ip_address : "N/A");
         }
     }
+    
+    if (table_write(&table, STDOUT_FILENO) != 0) {
+        fprintf(stderr, "错误：无法输出 VM 列表\n");
+    }
+    table_free(&table);
 }
 
 // 打印 VM 状态 (供其他模块使用)
@@ -347,22 +1072,23 @@ void cli_print_vm_status(VMInfo *vm) {
     printf("VM %d 详细信息\n", vm->vmid);
     printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n\n");
     
+    char buf1[FORMAT_LEN], buf2[FORMAT_LEN];
     printf("\033[36m基本信息:\033[0m\n");
     printf("  VMID:     %d\n", vm->vmid);
     printf("  名称:     %s\n", vm->name);
     printf("  状态:     %s\n", vm->status);
-    printf("  运行时间: %s\n", format_uptime(vm->uptime));
+    printf("  运行时间: %s\n", format_uptime(vm->uptime, buf1, sizeof(buf1)));
     
     printf("\n\033[36m资源配置:\033[0m\n");
     printf("  CPU:      %d 核\n", vm->cpus);
     printf("  CPU 使用: %.2f%%\n", vm->cpu_percent);
     printf("  内存:     %s / %s (%.1f%%)\n",
-           format_bytes(vm->mem),
-           format_bytes(vm->maxmem),
+           format_bytes(vm->mem, buf1, sizeof(buf1)),
+           format_bytes(vm->maxmem, buf2, sizeof(buf2)),
            vm->maxmem > 0 ? (vm->mem * 100.0 / vm->maxmem) : 0);
     printf("  磁盘:     %s / %s\n",
-           format_bytes(vm->disk),
-           format_bytes(vm->maxdisk));
+           format_bytes(vm->disk, buf1, sizeof(buf1)),
+           format_bytes(vm->maxdisk, buf2, sizeof(buf2)));
     
     if (vm->ip_address[0]) {
         printf("\n\033[36m网络信息:\033[0m\n");
@@ -0,0 +1,653 @@
+/*
+ * shell 命令
+ * 交互式命令行：整个会话复用同一个 API 连接，启动时用一次 /cluster/resources 请求
+ * 建立内存中的 VM 清单，Tab 补全和名称→VMID 解析都只查清单；
+ * list 直接显示清单，修改类命令之后或带 --fresh 时才重新获取
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+#include <errno.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define SHELL_LINE_MAX 4096
+#define SHELL_MAX_ARGS 256
+#define SHELL_HISTORY_MAX 200
+#define SHELL_SHOW_MAX 100          // 候选超过时只显示前面一部分
+
+static const char *shell_commands[] = {
+    "list", "status", "start", "stop", "reboot", "restart", "suspend", "resume",
+    "destroy", "clone", "snapshot", "backup", "migrate", "rebalance", "set", "wait",
+    "batch", "help", "exit", "quit",
+};
+
+static const char *snapshot_actions[] = {
+    "create", "list", "rollback", "delete", "prune",
+};
+
+// 不修改 VM 的命令，执行后清单仍然有效
+static const char *readonly_commands[] = {
+    "list", "status", "wait", "help",
+};
+
+// 补全表项：VMID 字符串或名称，按 strcasecmp 排序
+typedef struct {
+    const char *text;
+    int vm;
+} ShellEntry;
+
+// 内存中的 VM 清单
+typedef struct {
+    VMInfo *vms;
+    int count;
+    char *ids;              // 每个 VM 12 字节的 VMID 字符串
+    ShellEntry *entries;
+    int entry_count;
+    double loaded_at;
+    bool loaded;
+    bool stale;             // 执行过修改类命令，list 时重新获取
+} Inventory;
+
+typedef struct {
+    char *lines[SHELL_HISTORY_MAX];
+    int count;
+} History;
+
+typedef struct {
+    char buf[SHELL_LINE_MAX];
+    size_t len;
+    size_t pos;
+    const char *prompt;
+} LineState;
+
+static struct termios orig_termios;
+
+static int cmp_entry(const void *a, const void *b) {
+    const ShellEntry *x = a, *y = b;
+    int c = strcasecmp(x->text, y->text);
+    return c ? c : strcmp(x->text, y->text);
+}
+
+static void inventory_free(Inventory *inv) {
+    free(inv->vms);
+    free(inv->ids);
+    free(inv->entries);
+    memset(inv, 0, sizeof(*inv));
+}
+
+static int inventory_load(Inventory *inv) {
+    VMInfo *vms = NULL;
+    int count = 0;
+    if (api_get_cluster_vms(&vms, &count) != 0) {
+        fprintf(stderr, "错误：无法获取集群资源: %s\n", api_last_error());
+        return -1;
+    }
+    
+    char *ids = malloc((size_t)count * 12 + 1);
+    ShellEntry *entries = malloc(((size_t)count * 2 + 1) * sizeof(ShellEntry));
+    if (!ids || !entries) {
+        free(ids);
+        free(entries);
+        free(vms);
+        return -1;
+    }
+    
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        char *id = ids + (size_t)i * 12;
+        snprintf(id, 12, "%d", vms[i].vmid);
+        entries[n++] = (ShellEntry){ id, i };
+        if (vms[i].name[0]) {
+            entries[n++] = (ShellEntry){ vms[i].name, i };
+        }
+    }
+    qsort(entries, (size_t)n, sizeof(ShellEntry), cmp_entry);
+    
+    inventory_free(inv);
+    inv->vms = vms;
+    inv->count = count;
+    inv->ids = ids;
+    inv->entries = entries;
+    inv->entry_count = n;
+    inv->loaded_at = now_monotonic();
+    inv->loaded = true;
+    return 0;
+}
+
+// 前缀（不区分大小写）匹配的表项区间 [*start, 返回值)
+static int inventory_prefix(const Inventory *inv, const char *prefix, int *start) {
+    size_t len = strlen(prefix);
+    int lo = 0, hi = inv->entry_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncasecmp(inv->entries[mid].text, prefix, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *start = lo;
+    
+    int end = lo;
+    while (end < inv->entry_count && strncasecmp(inv->entries[end].text, prefix, len) == 0) end++;
+    return end;
+}
+
+// 按名称查找 VMID：0 表示不存在，-1 表示有多个同名 VM
+static int inventory_resolve(const Inventory *inv, const char *name) {
+    int start;
+    int end = inventory_prefix(inv, name, &start);
+    
+    int vmid = 0;
+    for (int i = start; i < end; i++) {
+        const VMInfo *vm = &inv->vms[inv->entries[i].vm];
+        if (strcmp(inv->entries[i].text, name) != 0 || strcmp(vm->name, name) != 0) continue;
+        if (vmid != 0 && vmid != vm->vmid) return -1;
+        vmid = vm->vmid;
+    }
+    return vmid;
+}
+
+static void inventory_print(const Inventory *inv) {
+    if (inv->count == 0) {
+        printf("没有找到虚拟机\n");
+        return;
+    }
+    
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "NODE", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+    };
+    Table table;
+    table_init(&table, columns, 6);
+    
+    char mem[FORMAT_LEN];
+    for (int i = 0; i < inv->count; i++) {
+        const VMInfo *vm = &inv->vms[i];
+        table_cell(&table, "%d", vm->vmid);
+        table_cell(&table, "%s", vm->name);
+        table_cell(&table, "%s", vm->node);
+        table_cell(&table, "%s", vm->status);
+        table_cell(&table, "%.1f%%", vm->cpu_percent);
+        table_cell(&table, "%s", format_bytes(vm->mem, mem, sizeof(mem)));
+    }
+    
+    fflush(stdout);
+    table_write(&table, STDOUT_FILENO);
+    table_free(&table);
+    
+    printf("\n共 %d 个虚拟机 (清单获取于 %.0fs 前，--fresh 重新获取)\n",
+           inv->count, now_monotonic() - inv->loaded_at);
+}
+
+static void history_add(History *h, const char *line) {
+    if (!line[0]) return;
+    if (h->count > 0 && strcmp(h->lines[h->count - 1], line) == 0) return;
+    
+    if (h->count == SHELL_HISTORY_MAX) {
+        free(h->lines[0]);
+        memmove(h->lines, h->lines + 1, (SHELL_HISTORY_MAX - 1) * sizeof(char *));
+        h->count--;
+    }
+    h->lines[h->count] = strdup(line);
+    if (h->lines[h->count]) h->count++;
+}
+
+static void history_free(History *h) {
+    for (int i = 0; i < h->count; i++) {
+        free(h->lines[i]);
+    }
+    h->count = 0;
+}
+
+static int raw_enable(void) {
+    if (tcgetattr(STDIN_FILENO, &orig_termios) != 0) return -1;
+    
+    struct termios raw = orig_termios;
+    raw.c_iflag &= ~(tcflag_t)(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_lflag &= ~(tcflag_t)(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    return tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+static void raw_disable(void) {
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
+}
+
+static int terminal_columns(void) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+    return 80;
+}
+
+// 重绘当前行，光标移回编辑位置（按显示宽度计算，中文名称占两列）
+static void refresh_line(const LineState *ls) {
+    char out[SHELL_LINE_MAX * 2];
+    int n = snprintf(out, sizeof(out), "\r%s%.*s\033[K", ls->prompt, (int)ls->len, ls->buf);
+    
+    int back = str_display_width(ls->buf + ls->pos);
+    if (back > 0 && n > 0 && (size_t)n < sizeof(out)) {
+        n += snprintf(out + n, sizeof(out) - (size_t)n, "\033[%dD", back);
+    }
+    if (n > 0) write_all(STDOUT_FILENO, out, (size_t)n < sizeof(out) ? (size_t)n : sizeof(out) - 1);
+}
+
+static void line_set(LineState *ls, const char *text) {
+    snprintf(ls->buf, sizeof(ls->buf), "%s", text);
+    ls->len = ls->pos = strlen(ls->buf);
+}
+
+static void line_insert(LineState *ls, const char *text, size_t len) {
+    if (ls->len + len >= sizeof(ls->buf)) return;
+    memmove(ls->buf + ls->pos + len, ls->buf + ls->pos, ls->len - ls->pos + 1);
+    memcpy(ls->buf + ls->pos, text, len);
+    ls->len += len;
+    ls->pos += len;
+}
+
+// 光标前一个 UTF-8 字符的起始位置
+static size_t prev_char(const LineState *ls, size_t pos) {
+    if (pos == 0) return 0;
+    pos--;
+    while (pos > 0 && ((unsigned char)ls->buf[pos] & 0xC0) == 0x80) pos--;
+    return pos;
+}
+
+static size_t next_char(const LineState *ls, size_t pos) {
+    if (pos >= ls->len) return ls->len;
+    pos++;
+    while (pos < ls->len && ((unsigned char)ls->buf[pos] & 0xC0) == 0x80) pos++;
+    return pos;
+}
+
+static void line_delete(LineState *ls, size_t from, size_t to) {
+    memmove(ls->buf + from, ls->buf + to, ls->len - to + 1);
+    ls->len -= to - from;
+    ls->pos = from;
+}
+
+// 分行列出候选，超过 SHELL_SHOW_MAX 个时只显示前面的部分
+static void show_candidates(const char **cands, int count) {
+    int width = 0;
+    int shown = count < SHELL_SHOW_MAX ? count : SHELL_SHOW_MAX;
+    for (int i = 0; i < shown; i++) {
+        int w = str_display_width(cands[i]);
+        if (w > width) width = w;
+    }
+    width += 2;
+    int per_row = terminal_columns() / width;
+    if (per_row < 1) per_row = 1;
+    
+    printf("\n");
+    for (int i = 0; i < shown; i++) {
+        printf("%s%*s", cands[i], width - str_display_width(cands[i]), "");
+        if ((i + 1) % per_row == 0 || i == shown - 1) printf("\n");
+    }
+    if (count > shown) {
+        printf("... 共 %d 个匹配\n", count);
+    }
+    fflush(stdout);
+}
+
+// Tab 补全：第一个词补全命令，snapshot 的第二个词补全子命令，其余补全 VMID 和名称；
+// 唯一匹配时补全并加空格，多个匹配时补到公共前缀，连按两次 Tab 列出候选
+static void complete(LineState *ls, const Inventory *inv, bool list) {
+    size_t start = ls->pos;
+    while (start > 0 && ls->buf[start - 1] != ' ') start--;
+    
+    char word[256];
+    size_t wlen = ls->pos - start;
+    if (wlen >= sizeof(word)) return;
+    memcpy(word, ls->buf + start, wlen);
+    word[wlen] = '\0';
+    
+    // 光标之前的完整词数
+    int index = 0;
+    char first[64] = "";
+    for (size_t i = 0; i < start; ) {
+        while (i < start && ls->buf[i] == ' ') i++;
+        if (i >= start) break;
+        size_t j = i;
+        while (j < start && ls->buf[j] != ' ') j++;
+        if (index == 0) snprintf(first, sizeof(first), "%.*s", (int)(j - i), ls->buf + i);
+        index++;
+        i = j;
+    }
+    if (word[0] == '-') return;
+    
+    const char **cands = NULL;
+    int count = 0;
+    if (index == 0 || (index == 1 && strcmp(first, "snapshot") == 0)) {
+        const char **table = index == 0 ? shell_commands : snapshot_actions;
+        size_t n = index == 0 ? sizeof(shell_commands) / sizeof(shell_commands[0])
+                              : sizeof(snapshot_actions) / sizeof(snapshot_actions[0]);
+        cands = malloc(n * sizeof(char *));
+        if (!cands) return;
+        for (size_t i = 0; i < n; i++) {
+            if (strncmp(table[i], word, wlen) == 0) cands[count++] = table[i];
+        }
+    } else {
+        int from;
+        int to = inventory_prefix(inv, word, &from);
+        cands = malloc(((size_t)(to - from) + 1) * sizeof(char *));
+        if (!cands) return;
+        for (int i = from; i < to; i++) {
+            // 同名 VM 只列一次
+            const char *text = inv->entries[i].text;
+            if (count > 0 && strcmp(cands[count - 1], text) == 0) continue;
+            cands[count++] = text;
+        }
+    }
+    
+    if (count == 0) {
+        write_all(STDOUT_FILENO, "\a", 1);
+        free(cands);
+        return;
+    }
+    
+    // 公共前缀（不区分大小写），不截断多字节字符
+    size_t common = strlen(cands[0]);
+    for (int i = 1; i < count; i++) {
+        size_t k = 0;
+        while (k < common && cands[i][k] &&
+               tolower((unsigned char)cands[i][k]) == tolower((unsigned char)cands[0][k])) k++;
+        common = k;
+    }
+    while (common > 0 && ((unsigned char)cands[0][common] & 0xC0) == 0x80) common--;
+    
+    if (count == 1 || common > wlen) {
+        line_delete(ls, start, ls->pos);
+        line_insert(ls, cands[0], common);
+        if (count == 1) line_insert(ls, " ", 1);
+    } else if (list) {
+        show_candidates(cands, count);
+    } else {
+        write_all(STDOUT_FILENO, "\a", 1);
+    }
+    free(cands);
+}
+
+// 读取一个按键，方向键等转义序列转换为控制字符
+enum {
+    KEY_CTRL_A = 1, KEY_CTRL_B = 2, KEY_CTRL_C = 3, KEY_CTRL_D = 4, KEY_CTRL_E = 5,
+    KEY_CTRL_F = 6, KEY_BACKSPACE_H = 8, KEY_TAB = 9, KEY_CTRL_K = 11, KEY_ENTER = 13,
+    KEY_CTRL_N = 14, KEY_CTRL_P = 16, KEY_CTRL_U = 21, KEY_CTRL_W = 23, KEY_ESC = 27,
+    KEY_BACKSPACE = 127, KEY_DELETE = 1000,
+};
+
+static int read_key(unsigned char *c) {
+    for (;;) {
+        ssize_t n = read(STDIN_FILENO, c, 1);
+        if (n == 1) break;
+        if (n < 0 && errno == EINTR) continue;
+        return -1;
+    }
+    if (*c != KEY_ESC) return *c;
+    
+    unsigned char seq[3];
+    if (read(STDIN_FILENO, &seq[0], 1) != 1 || read(STDIN_FILENO, &seq[1], 1) != 1) return KEY_ESC;
+    if (seq[0] != '[' && seq[0] != 'O') return KEY_ESC;
+    
+    switch (seq[1]) {
+        case 'A': return KEY_CTRL_P;
+        case 'B': return KEY_CTRL_N;
+        case 'C': return KEY_CTRL_F;
+        case 'D': return KEY_CTRL_B;
+        case 'H': return KEY_CTRL_A;
+        case 'F': return KEY_CTRL_E;
+        case '3':
+            if (read(STDIN_FILENO, &seq[2], 1) == 1 && seq[2] == '~') return KEY_DELETE;
+            return KEY_ESC;
+        default: return KEY_ESC;
+    }
+}
+
+// 终端中编辑一行；返回 0 表示输入了一行，-1 表示 EOF（空行上的 Ctrl-D）
+static int edit_line(LineState *ls, const History *history, const Inventory *inv) {
+    ls->len = ls->pos = 0;
+    ls->buf[0] = '\0';
+    int hist = history->count;
+    char saved[SHELL_LINE_MAX] = "";
+    bool last_tab = false;
+    
+    if (raw_enable() != 0) return -1;
+    refresh_line(ls);
+    
+    int ret = 0;
+    for (;;) {
+        unsigned char c;
+        int key = read_key(&c);
+        if (key < 0) {
+            ret = -1;
+            break;
+        }
+        
+        bool tab = false;
+        switch (key) {
+            case KEY_ENTER:
+            case '\n':
+                goto done;
+            case KEY_CTRL_C:
+                write_all(STDOUT_FILENO, "^C\n", 3);
+                ls->len = ls->pos = 0;
+                ls->buf[0] = '\0';
+                break;
+            case KEY_CTRL_D:
+                if (ls->len == 0) {
+                    ret = -1;
+                    goto done;
+                }
+                if (ls->pos < ls->len) line_delete(ls, ls->pos, next_char(ls, ls->pos));
+                break;
+            case KEY_DELETE:
+                if (ls->pos < ls->len) line_delete(ls, ls->pos, next_char(ls, ls->pos));
+                break;
+            case KEY_BACKSPACE:
+            case KEY_BACKSPACE_H:
+                if (ls->pos > 0) line_delete(ls, prev_char(ls, ls->pos), ls->pos);
+                break;
+            case KEY_TAB:
+                complete(ls, inv, last_tab);
+                tab = true;
+                break;
+            case KEY_CTRL_A:
+                ls->pos = 0;
+                break;
+            case KEY_CTRL_E:
+                ls->pos = ls->len;
+                break;
+            case KEY_CTRL_B:
+                ls->pos = prev_char(ls, ls->pos);
+                break;
+            case KEY_CTRL_F:
+                ls->pos = next_char(ls, ls->pos);
+                break;
+            case KEY_CTRL_K:
+                ls->len = ls->pos;
+                ls->buf[ls->len] = '\0';
+                break;
+            case KEY_CTRL_U:
+                line_delete(ls, 0, ls->pos);
+                break;
+            case KEY_CTRL_W: {
+                size_t from = ls->pos;
+                while (from > 0 && ls->buf[from - 1] == ' ') from--;
+                while (from > 0 && ls->buf[from - 1] != ' ') from--;
+                line_delete(ls, from, ls->pos);
+                break;
+            }
+            case KEY_CTRL_P:
+            case KEY_CTRL_N:
+                if (key == KEY_CTRL_P && hist > 0) {
+                    if (hist == history->count) snprintf(saved, sizeof(saved), "%s", ls->buf);
+                    line_set(ls, history->lines[--hist]);
+                } else if (key == KEY_CTRL_N && hist < history->count) {
+                    hist++;
+                    line_set(ls, hist == history->count ? saved : history->lines[hist]);
+                }
+                break;
+            case KEY_ESC:
+                break;
+            default:
+                if (c >= 0x20) line_insert(ls, (const char *)&c, 1);
+                break;
+        }
+        last_tab = tab;
+        refresh_line(ls);
+    }
+
+done:
+    raw_disable();
+    write_all(STDOUT_FILENO, "\n", 1);
+    return ret;
+}
+
+static bool is_readonly(const char *command) {
+    for (size_t i = 0; i < sizeof(readonly_commands) / sizeof(readonly_commands[0]); i++) {
+        if (strcmp(command, readonly_commands[i]) == 0) return true;
+    }
+    return false;
+}
+
+// 把参数中的 VM 名称替换为 VMID；选项的值和 snapshot 的子命令不替换
+static int resolve_names(const Inventory *inv, int argc, char *argv[], char ids[][12]) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (i == 1 && strcmp(argv[0], "snapshot") == 0) continue;
+        if (arg[0] == '-' || isdigit((unsigned char)arg[0]) || strchr(arg, '=')) continue;
+        if (argv[i - 1][0] == '-') continue;
+        
+        int vmid = inventory_resolve(inv, arg);
+        if (vmid < 0) {
+            fprintf(stderr, "错误：有多个名为 %s 的 VM，请使用 VMID\n", arg);
+            return -1;
+        }
+        if (vmid > 0) {
+            snprintf(ids[i], sizeof(ids[i]), "%d", vmid);
+            argv[i] = ids[i];
+        }
+    }
+    return 0;
+}
+
+static void print_shell_help(void) {
+    printf("命令与命令行用法相同，例如：start web-01 web-02、snapshot create 100-110\n");
+    printf("  参数中的 VM 名称会解析为 VMID，Tab 补全命令、VMID 和名称\n");
+    printf("  list               显示内存中的 VM 清单（集群所有节点）\n");
+    printf("  --fresh            加在任何命令后，先重新获取清单\n");
+    printf("  help               显示本帮助\n");
+    printf("  exit, quit, Ctrl-D 退出\n");
+}
+
+// 执行一行输入，返回 1 表示退出 shell
+static int run_line(char *line, Inventory *inv, bool use_inventory) {
+    char *argv[SHELL_MAX_ARGS + 1];
+    int argc = split_args(line, argv, SHELL_MAX_ARGS);
+    if (argc < 0) {
+        fprintf(stderr, "错误：引号不匹配或参数过多\n");
+        return 0;
+    }
+    
+    // 去掉 --fresh
+    bool fresh = false;
+    int n = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--fresh") == 0) {
+            fresh = true;
+        } else {
+            argv[n++] = argv[i];
+        }
+    }
+    argc = n;
+    argv[argc] = NULL;
+    if (argc == 0) {
+        if (fresh && use_inventory && inventory_load(inv) == 0) {
+            printf("清单已更新: %d 个虚拟机\n", inv->count);
+        }
+        return 0;
+    }
+    
+    const char *command = argv[0];
+    if (strcmp(command, "exit") == 0 || strcmp(command, "quit") == 0) return 1;
+    if (strcmp(command, "help") == 0) {
+        print_shell_help();
+        return 0;
+    }
+    if (strcmp(command, "shell") == 0) {
+        fprintf(stderr, "错误：已在 shell 中\n");
+        return 0;
+    }
+    
+    if (use_inventory && (fresh || !inv->loaded || (inv->stale && strcmp(command, "list") == 0))) {
+        if (inventory_load(inv) != 0 && strcmp(command, "list") == 0) return 0;
+    }
+    
+    if (use_inventory && strcmp(command, "list") == 0 && argc == 1) {
+        inventory_print(inv);
+        return 0;
+    }
+    
+    char ids[SHELL_MAX_ARGS][12];
+    if (use_inventory && resolve_names(inv, argc, argv, ids) != 0) return 0;
+    
+    // --fresh 时跳过磁盘响应缓存
+    int cache_ttl = g_cache_ttl;
+    if (fresh) g_cache_ttl = 0;
+    cli_main(argc, argv);
+    g_cache_ttl = cache_ttl;
+    fflush(stdout);
+    
+    if (!is_readonly(command)) inv->stale = true;
+    return 0;
+}
+
+int shell_main(int argc, char *argv[]) {
+    if (argc > 1) {
+        fprintf(stderr, "错误：未知参数: %s\n", argv[1]);
+        fprintf(stderr, "用法: %s shell\n", PROGRAM_NAME);
+        return 1;
+    }
+    
+    // 多集群时 VM 清单没有统一的 VMID 空间，命令直接分发到各集群
+    bool use_inventory = g_cluster_count <= 1;
+    bool interactive = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+    
+    Inventory inv = {0};
+    if (use_inventory) {
+        double start = now_monotonic();
+        if (inventory_load(&inv) == 0 && interactive) {
+            printf("已加载 %d 个虚拟机 (%.2fs)，Tab 补全，help 查看帮助\n",
+                   inv.count, now_monotonic() - start);
+        }
+    }
+    
+    char prompt[128];
+    snprintf(prompt, sizeof(prompt), "%s> ", g_config.name[0] ? g_config.name : PROGRAM_NAME);
+    
+    LineState ls = { .prompt = prompt };
+    History history = {0};
+    for (;;) {
+        if (interactive) {
+            if (edit_line(&ls, &history, &inv) != 0) break;
+        } else {
+            if (!fgets(ls.buf, sizeof(ls.buf), stdin)) break;
+            ls.buf[strcspn(ls.buf, "\n")] = '\0';
+        }
+        history_add(&history, ls.buf);
+        
+        if (run_line(ls.buf, &inv, use_inventory) != 0) break;
+    }
+    
+    history_free(&history);
+    inventory_free(&inv);
+    return 0;
+}
@@ -20,6 +20,51 @@ static int selected_index = 0;
 static int scroll_offset = 0;
 static bool running = true;
 static time_t last_refresh = 0;
+static time_t last_full_refresh = 0;
+static time_t last_event_poll = 0;
+static EventFeed tui_feed;
+static VMHistory *tui_history = NULL;   // 与 tui_vm_list 一一对应（同样按 VMID 排序）
+
+// 树形视图：集群 → 节点 → 资源池/标签 → VM
+typedef enum {
+    GROUP_POOL,
+    GROUP_TAG,
+    GROUP_NONE
+} GroupMode;
+
+#define TREE_KEY_LEN 192
+
+typedef enum {
+    ROW_CLUSTER,
+    ROW_NODE,
+    ROW_GROUP,
+    ROW_VM
+} RowType;
+
+typedef struct {
+    RowType type;
+    int depth;
+    int vm;                 // ROW_VM: tui_vm_list 下标
+    int total;              // 分组行：可见 VM 数
+    int running;
+    char key[TREE_KEY_LEN]; // 分组行：折叠状态的键
+} TreeRow;
+
+static int *tui_order = NULL;           // 按 节点/分组/VMID 排序的 VM 下标
+static TreeRow *tui_rows = NULL;
+static int row_count = 0;
+static int row_cap = 0;
+static GroupMode group_mode = GROUP_POOL;
+static char (*collapsed_keys)[TREE_KEY_LEN] = NULL;
+static int collapsed_count = 0;
+
+// 增量搜索
+static SearchIndex tui_index;
+static int *search_results = NULL;
+static int search_count = 0;
+static unsigned char *search_hit = NULL;    // 每个 VM 是否匹配当前查询
+static char search_text[64] = "";
+static bool search_typing = false;
 
 // 颜色对
 #define COLOR_HEADER 1
@@ -33,6 +78,11 @@ static time_t last_refresh = 0;
 #define HELP_HEIGHT 3
 #define STATUS_HEIGHT 8
 
+// 刷新间隔（秒）
+#define EVENT_POLL_INTERVAL 2     // 轮询集群任务/日志，定向刷新变化的 VM
+#define METRICS_INTERVAL 30       // 单次列表请求更新 CPU/内存等指标
+#define FULL_REFRESH_INTERVAL 300 // 兜底全量刷新（网桥、IP 等）
+
 // 初始化 ncurses
 void tui_init(void) {
     initscr();              // 初始化屏幕
@@ -40,6 +90,7 @@ void tui_init(void) {
     noecho();               // 不显示输入
     keypad(stdscr, TRUE);   // 启用功能键
     curs_set(0);            // 隐藏光标
+    set_escdelay(25);       // Esc 退出搜索时不等待转义序列
     
     // 初始化颜色
     if (has_colors()) {
@@ -65,6 +116,16 @@ void tui_cleanup(void) {
         free(tui_vm_list);
         tui_vm_list = NULL;
     }
+    event_feed_free(&tui_feed);
+    free(tui_history);
+    tui_history = NULL;
+    search_index_free(&tui_index);
+    free(search_results);
+    free(search_hit);
+    free(tui_order);
+    free(tui_rows);
+    free(collapsed_keys);
+    confwatch_stop();
     
     endwin();
 }
@@ -91,6 +152,321 @@ static void create_windows(void) {
     status_win = newwin(list_height, max_x - list_width, HEADER_HEIGHT, list_width);
 }
 
+// VM 所属的资源池/标签分组
+static const char* vm_group(const VMInfo *vm, char *buf, size_t len) {
+    if (group_mode == GROUP_POOL) {
+        snprintf(buf, len, "%s", vm->pool[0] ? vm->pool : "(no pool)");
+    } else if (group_mode == GROUP_TAG) {
+        size_t n = strcspn(vm->tags, ";, ");
+        if (n == 0) {
+            snprintf(buf, len, "(no tag)");
+        } else {
+            snprintf(buf, len, "%.*s", (int)n, vm->tags);
+        }
+    } else {
+        buf[0] = '\0';
+    }
+    return buf;
+}
+
+static int cmp_tree_order(const void *a, const void *b) {
+    const VMInfo *x = &tui_vm_list[*(const int *)a];
+    const VMInfo *y = &tui_vm_list[*(const int *)b];
+    
+    int c = strcmp(x->node, y->node);
+    if (c != 0) return c;
+    
+    char gx[128], gy[128];
+    c = strcmp(vm_group(x, gx, sizeof(gx)), vm_group(y, gy, sizeof(gy)));
+    if (c != 0) return c;
+    
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+static bool is_collapsed(const char *key) {
+    for (int i = 0; i < collapsed_count; i++) {
+        if (strcmp(collapsed_keys[i], key) == 0) return true;
+    }
+    return false;
+}
+
+static void toggle_collapsed(const char *key) {
+    for (int i = 0; i < collapsed_count; i++) {
+        if (strcmp(collapsed_keys[i], key) == 0) {
+            memcpy(collapsed_keys[i], collapsed_keys[collapsed_count - 1], TREE_KEY_LEN);
+            collapsed_count--;
+            return;
+        }
+    }
+    
+    char (*keys)[TREE_KEY_LEN] = realloc(collapsed_keys, (size_t)(collapsed_count + 1) * TREE_KEY_LEN);
+    if (!keys) return;
+    collapsed_keys = keys;
+    snprintf(collapsed_keys[collapsed_count++], TREE_KEY_LEN, "%s", key);
+}
+
+static bool vm_visible(int vm) {
+    return search_text[0] == '\0' || (search_hit && search_hit[vm]);
+}
+
+// 统计 tui_order[from, to) 中可见和运行中的 VM
+static int count_visible(int from, int to, int *running) {
+    int total = 0;
+    *running = 0;
+    for (int i = from; i < to; i++) {
+        int vm = tui_order[i];
+        if (!vm_visible(vm)) continue;
+        total++;
+        if (strcmp(tui_vm_list[vm].status, "running") == 0) (*running)++;
+    }
+    return total;
+}
+
+static void add_tree_row(RowType type, int depth, int vm, int total, int running, const char *key) {
+    if (row_count >= row_cap) return;
+    TreeRow *row = &tui_rows[row_count++];
+    row->type = type;
+    row->depth = depth;
+    row->vm = vm;
+    row->total = total;
+    row->running = running;
+    snprintf(row->key, sizeof(row->key), "%s", key ? key : "");
+}
+
+// 分组行的显示名称（键中最后一个 '/' 之后的部分）
+static const char* row_label(const TreeRow *row) {
+    const char *slash = strrchr(row->key, '/');
+    return slash ? slash + 1 : row->key;
+}
+
+// 按当前折叠状态和搜索结果生成可见行，并尽量保持原来的选中项
+static void build_tree(void) {
+    int selected_vmid = 0;
+    char selected_key[TREE_KEY_LEN] = "";
+    if (selected_index >= 0 && selected_index < row_count) {
+        TreeRow *row = &tui_rows[selected_index];
+        if (row->type == ROW_VM) {
+            selected_vmid = tui_vm_list[row->vm].vmid;
+        } else {
+            snprintf(selected_key, sizeof(selected_key), "%s", row->key);
+        }
+    }
+    
+    // 最多：集群行 + 每个 VM 各占一个节点行、一个分组行和自身一行
+    row_count = 0;
+    int cap = 1 + 3 * vm_count;
+    TreeRow *rows = realloc(tui_rows, (size_t)cap * sizeof(TreeRow));
+    if (!rows) return;
+    tui_rows = rows;
+    row_cap = cap;
+    
+    // 搜索时自动展开所有包含结果的分组
+    bool filtering = search_text[0] != '\0';
+    char key[TREE_KEY_LEN];
+    int running;
+    
+    int total = count_visible(0, vm_count, &running);
+    snprintf(key, sizeof(key), "cluster/%.180s", g_config.name[0] ? g_config.name : g_config.host);
+    add_tree_row(ROW_CLUSTER, 0, -1, total, running, key);
+    bool cluster_open = filtering || !is_collapsed(key);
+    
+    for (int i = 0; cluster_open && i < vm_count; ) {
+        // 同一节点的连续区间
+        const char *node = tui_vm_list[tui_order[i]].node;
+        int node_end = i;
+        while (node_end < vm_count && strcmp(tui_vm_list[tui_order[node_end]].node, node) == 0) {
+            node_end++;
+        }
+        
+        int node_total = count_visible(i, node_end, &running);
+        if (node_total == 0 && filtering) {
+            i = node_end;
+            continue;
+        }
+        
+        char node_key[TREE_KEY_LEN];
+        snprintf(node_key, sizeof(node_key), "node/%s", node[0] ? node : "(unknown)");
+        add_tree_row(ROW_NODE, 1, -1, node_total, running, node_key);
+        
+        if (!filtering && is_collapsed(node_key)) {
+            i = node_end;
+            continue;
+        }
+        
+        while (i < node_end) {
+            char group[128], other[128];
+            vm_group(&tui_vm_list[tui_order[i]], group, sizeof(group));
+            int group_end = i;
+            while (group_end < node_end &&
+                   strcmp(vm_group(&tui_vm_list[tui_order[group_end]], other, sizeof(other)), group) == 0) {
+                group_end++;
+            }
+            
+            int depth = 2;
+            bool open = true;
+            if (group_mode != GROUP_NONE) {
+                int group_total = count_visible(i, group_end, &running);
+                if (group_total == 0 && filtering) {
+                    i = group_end;
+                    continue;
+                }
+                snprintf(key, sizeof(key), "%.70s/%.120s", node_key, group);
+                add_tree_row(ROW_GROUP, 2, -1, group_total, running, key);
+                open = filtering || !is_collapsed(key);
+                depth = 3;
+            }
+            
+            for (int k = i; open && k < group_end; k++) {
+                if (vm_visible(tui_order[k])) {
+                    add_tree_row(ROW_VM, depth, tui_order[k], 0, 0, NULL);
+                }
+            }
+            i = group_end;
+        }
+    }
+    
+    // 恢复选中项；原选中项已不可见时，搜索状态下选中第一个 VM
+    int restored = -1;
+    for (int i = 0; i < row_count; i++) {
+        TreeRow *row = &tui_rows[i];
+        if ((row->type == ROW_VM && tui_vm_list[row->vm].vmid == selected_vmid) ||
+            (row->type != ROW_VM && selected_key[0] && strcmp(row->key, selected_key) == 0)) {
+            restored = i;
+            break;
+        }
+    }
+    if (restored < 0 && filtering) {
+        for (int i = 0; i < row_count; i++) {
+            if (tui_rows[i].type == ROW_VM) {
+                restored = i;
+                break;
+            }
+        }
+    }
+    if (restored >= 0) {
+        selected_index = restored;
+    }
+    if (selected_index >= row_count) selected_index = row_count - 1;
+    if (selected_index < 0) selected_index = 0;
+    if (scroll_offset > selected_index) scroll_offset = selected_index;
+}
+
+// 调整滚动位置，保证选中行可见
+static void ensure_visible(void) {
+    int max_y = 0, max_x = 0;
+    if (list_win) getmaxyx(list_win, max_y, max_x);
+    (void)max_x;
+    int visible_lines = max_y - 4;
+    if (visible_lines < 1) visible_lines = 1;
+    
+    if (selected_index < scroll_offset) {
+        scroll_offset = selected_index;
+    } else if (selected_index >= scroll_offset + visible_lines) {
+        scroll_offset = selected_index - visible_lines + 1;
+    }
+}
+
+// 执行搜索：refine 为 true 表示查询只是在上一次基础上追加了字符
+static void run_search(bool refine) {
+    if (!search_hit || !search_results) return;
+    
+    // 只清除上一次命中的 VM，不扫描整个列表
+    for (int i = 0; i < search_count; i++) {
+        search_hit[search_results[i]] = 0;
+    }
+    
+    if (search_text[0] == '\0') {
+        search_count = 0;
+    } else if (refine) {
+        search_count = search_refine(&tui_index, search_text, search_results, search_count, search_results);
+    } else {
+        search_count = search_query(&tui_index, search_text, search_results);
+    }
+    
+    for (int i = 0; i < search_count; i++) {
+        search_hit[search_results[i]] = 1;
+    }
+}
+
+// VM 列表变化后重建排序、搜索索引和树
+static void rebuild_view(bool names_changed) {
+    free(tui_order);
+    tui_order = malloc((size_t)(vm_count > 0 ? vm_count : 1) * sizeof(int));
+    if (!tui_order) {
+        row_count = 0;
+        return;
+    }
+    for (int i = 0; i < vm_count; i++) {
+        tui_order[i] = i;
+    }
+    qsort(tui_order, (size_t)vm_count, sizeof(int), cmp_tree_order);
+    
+    if (names_changed) {
+        search_index_free(&tui_index);
+        search_index_build(&tui_index, tui_vm_list, vm_count);
+        
+        free(search_results);
+        free(search_hit);
+        search_results = malloc((size_t)(vm_count > 0 ? vm_count : 1) * sizeof(int));
+        search_hit = calloc((size_t)(vm_count > 0 ? vm_count : 1), 1);
+        search_count = 0;
+        run_search(false);
+    }
+    
+    build_tree();
+}
+
+// 当前选中的 VM（选中分组行时为 NULL）
+static VMInfo* selected_vm(void) {
+    if (selected_index < 0 || selected_index >= row_count) return NULL;
+    TreeRow *row = &tui_rows[selected_index];
+    return row->type == ROW_VM ? &tui_vm_list[row->vm] : NULL;
+}
+
+// 迷你图字符：TUI 链接的是窄字符 ncurses，方块字符无法正确显示，使用 ASCII 分级
+static const char spark_levels[] = "_.:-=+*#";
+#define SPARK_LEVELS ((int)sizeof(spark_levels) - 1)
+#define LIST_SPARK_WIDTH 12
+
+// 样本值在 [0, scale] 中的级别，非零值至少为 1 级，避免少量活动被显示为空闲
+static int spark_level(float value, float scale, int levels) {
+    if (scale <= 0 || value <= 0) return 0;
+    int level = (int)(value / scale * (float)(levels - 1) + 0.5f);
+    if (level < 1) level = 1;
+    return level < levels ? level : levels - 1;
+}
+
+// 样本的显示刻度：百分比固定为 100，速率取窗口内最大值
+static float spark_scale(MetricKind kind, const float *values, int count) {
+    if (kind == METRIC_CPU || kind == METRIC_MEM) return 100.0f;
+    
+    float max = 0;
+    for (int i = 0; i < count; i++) {
+        if (values[i] > max) max = values[i];
+    }
+    return max;
+}
+
+// 将最近 width 个样本格式化为迷你图，样本不足时左侧留空
+static void format_sparkline(char *buf, int width, const VMHistory *h, MetricKind kind) {
+    float values[HISTORY_SAMPLES];
+    if (width > HISTORY_SAMPLES) width = HISTORY_SAMPLES;
+    int count = h ? history_values(h, kind, values, width) : 0;
+    float scale = spark_scale(kind, values, count);
+    
+    int pad = width - count;
+    memset(buf, ' ', (size_t)pad);
+    for (int i = 0; i < count; i++) {
+        buf[pad + i] = spark_levels[spark_level(values[i], scale, SPARK_LEVELS)];
+    }
+    buf[width] = '\0';
+}
+
+// VM 对应的指标历史
+static VMHistory* vm_history(const VMInfo *vm) {
+    return tui_history ? &tui_history[vm - tui_vm_list] : NULL;
+}
+
 // 绘制标题栏
 static void draw_header(void) {
     if (!header_win) return;
@@ -118,6 +494,12 @@ static void draw_header(void) {
     mvwprintw(header_win, 1, 2, "Total VMs: %d | Running: %d | Stopped: %d",
               vm_count, running_count, vm_count - running_count);
     
+    // 搜索状态
+    if (search_typing || search_text[0]) {
+        mvwprintw(header_win, 2, 2, "Search: /%s%s  (%d matches)",
+                  search_text, search_typing ? "_" : "", search_count);
+    }
+    
     wrefresh(header_win);
 }
 
@@ -131,41 +513,66 @@ static void draw_vm_list(void) {
     
     int max_y, max_x;
     getmaxyx(list_win, max_y, max_x);
+    int width = max_x - 3;
     
     // 表头
     wattron(list_win, A_BOLD);
-    mvwprintw(list_win, 1, 2, "%-6s %-20s %-10s %6s %10s",
-              "VMID", "NAME", "STATUS", "CPU%", "MEMORY");
+    mvwprintw(list_win, 1, 2, "%-6s %-20s %-10s %6s %10s  %s",
+              "VMID", "NAME", "STATUS", "CPU%", "MEMORY", "CPU HISTORY");
     wattroff(list_win, A_BOLD);
     
-    // VM 列表
+    // 可见行
     int visible_lines = max_y - 4;
-    
-    for (int i = 0; i < vm_count && i < visible_lines; i++) {
-        int vm_index = scroll_offset + i;
-        if (vm_index >= vm_count) break;
+    bool filtering = search_text[0] != '\0';
+    char line[256];
+    char spark[LIST_SPARK_WIDTH + 1];
+    char mem[FORMAT_LEN];
+    
+    for (int i = 0; i < visible_lines; i++) {
+        int row_index = scroll_offset + i;
+        if (row_index >= row_count) break;
         
-        VMInfo *vm = &tui_vm_list[vm_index];
+        TreeRow *row = &tui_rows[row_index];
         int y = i + 2;
+        int indent = row->depth * 2;
         
         // 选中高亮
-        if (vm_index == selected_index) {
+        if (row_index == selected_index) {
             wattron(list_win, COLOR_PAIR(COLOR_SELECTED) | A_BOLD);
         }
         
-        // 状态颜色
-        if (strcmp(vm->status, "running") == 0) {
-            wattron(list_win, COLOR_PAIR(COLOR_RUNNING));
+        if (row->type == ROW_VM) {
+            VMInfo *vm = &tui_vm_list[row->vm];
+            
+            // 状态颜色
+            if (row_index != selected_index) {
+                if (strcmp(vm->status, "running") == 0) {
+                    wattron(list_win, COLOR_PAIR(COLOR_RUNNING));
+                } else {
+                    wattron(list_win, COLOR_PAIR(COLOR_STOPPED));
+                }
+            }
+            
+            format_sparkline(spark, LIST_SPARK_WIDTH, vm_history(vm), METRIC_CPU);
+            snprintf(line, sizeof(line), "%*s%-6d %-20s %-10s %5.1f%% %10s  %s",
+                     indent, "",
+                     vm->vmid,
+                     vm->name,
+                     vm->status,
+                     vm->cpu_percent,
+                     format_bytes(vm->mem, mem, sizeof(mem)),
+                     spark);
         } else {
-            wattron(list_win, COLOR_PAIR(COLOR_STOPPED));
+            bool open = filtering || !is_collapsed(row->key);
+            if (row_index != selected_index) {
+                wattron(list_win, A_BOLD);
+            }
+            snprintf(line, sizeof(line), "%*s[%c] %s  (%d/%d running)",
+                     indent, "", open ? '-' : '+', row_label(row), row->running, row->total);
         }
         
-        mvwprintw(list_win, y, 2, "%-6d %-20s %-10s %5.1f%% %10s",
-                  vm->vmid,
-                  vm->name,
-                  vm->status,
-                  vm->cpu_percent,
-                  format_bytes(vm->mem));
+        // 超出窗口宽度的部分截断，避免换行覆盖边框
+        mvwaddnstr(list_win, y, 2, line, width > 0 ? width : 0);
         
         wattroff(list_win, COLOR_PAIR(COLOR_SELECTED) | A_BOLD);
         wattroff(list_win, COLOR_PAIR(COLOR_RUNNING));
@@ -173,40 +580,132 @@ static void draw_vm_list(void) {
     }
     
     // 滚动指示器
-    if (vm_count > visible_lines) {
+    if (row_count > visible_lines) {
         mvwprintw(list_win, max_y - 1, max_x - 15, "[%d/%d]",
-                  selected_index + 1, vm_count);
+                  selected_index + 1, row_count);
     }
     
     wrefresh(list_win);
 }
 
+// 详情面板的历史图：CPU 为多行柱状图，内存/磁盘/网络为单行迷你图
+#define CHART_HEIGHT 4
+
+static void draw_history(const VMHistory *h, int y, int max_y, int max_x) {
+    // 左侧 10 列刻度/标签，右侧 10 列当前值
+    int width = max_x - 4 - 10 - 10;
+    if (width > HISTORY_SAMPLES) width = HISTORY_SAMPLES;
+    if (!h || width < 8 || y + CHART_HEIGHT + 4 >= max_y - 1) return;
+    
+    mvwprintw(status_win, y++, 2, "History (last %d min):", width * HISTORY_STEP / 60);
+    
+    // CPU：每行分两级，'#' 为满格，'.' 为半格
+    float values[HISTORY_SAMPLES];
+    int count = history_values(h, METRIC_CPU, values, width);
+    int pad = width - count;
+    char line[HISTORY_SAMPLES + 1];
+    char rate[FORMAT_LEN];
+    for (int row = CHART_HEIGHT - 1; row >= 0; row--) {
+        memset(line, ' ', (size_t)width);
+        for (int i = 0; i < count; i++) {
+            int level = spark_level(values[i], 100.0f, CHART_HEIGHT * 2 + 1);
+            if (level >= row * 2 + 2) {
+                line[pad + i] = '#';
+            } else if (level == row * 2 + 1) {
+                line[pad + i] = '.';
+            }
+        }
+        line[width] = '\0';
+        
+        const char *axis = "         ";
+        if (row == CHART_HEIGHT - 1) axis = "CPU  100%";
+        if (row == 0) axis = "       0%";
+        mvwprintw(status_win, y++, 2, "%s|%s", axis, line);
+    }
+    
+    static const struct {
+        MetricKind kind;
+        const char *label;
+    } lines[] = {
+        { METRIC_MEM,  "Mem" },
+        { METRIC_DISK, "Disk" },
+        { METRIC_NET,  "Net" },
+    };
+    for (size_t k = 0; k < sizeof(lines) / sizeof(lines[0]); k++) {
+        format_sparkline(line, width, h, lines[k].kind);
+        count = history_values(h, lines[k].kind, values, 1);
+        float latest = count > 0 ? values[0] : 0;
+        
+        if (lines[k].kind == METRIC_MEM) {
+            mvwprintw(status_win, y++, 2, "%-9s|%s %.0f%%", lines[k].label, line, latest);
+        } else {
+            mvwprintw(status_win, y++, 2, "%-9s|%s %s/s", lines[k].label, line,
+                      format_bytes((uint64_t)latest, rate, sizeof(rate)));
+        }
+    }
+}
+
 // 绘制 VM 详情
 static void draw_vm_status(void) {
-    if (!status_win || vm_count == 0) return;
+    if (!status_win || row_count == 0) return;
     
     werase(status_win);
     box(status_win, 0, 0);
     mvwprintw(status_win, 0, 2, " VM Details ");
     
-    VMInfo *vm = &tui_vm_list[selected_index];
-    
     int y = 2;
+    VMInfo *vm = selected_vm();
+    if (!vm) {
+        TreeRow *row = &tui_rows[selected_index];
+        static const char *kinds[] = { "Cluster", "Node", "Group", "VM" };
+        mvwprintw(status_win, y++, 2, "%s: %s", kinds[row->type], row_label(row));
+        y++;
+        mvwprintw(status_win, y++, 2, "VMs: %d", row->total);
+        mvwprintw(status_win, y++, 2, "Running: %d", row->running);
+        mvwprintw(status_win, y++, 2, "Stopped: %d", row->total - row->running);
+        wrefresh(status_win);
+        return;
+    }
+    
+    // 网桥、IP 等详情只为选中的 VM 加载
+    if (vm->config_file[0] == '\0') {
+        if (api_get_vm_config_details(vm->vmid, vm, 0) != 0) {
+            snprintf(vm->config_file, sizeof(vm->config_file), "N/A");
+        }
+        if (strcmp(vm->status, "running") == 0) {
+            api_get_vm_ip(vm->vmid, vm, 0);
+        }
+    }
+    
+    // 首次查看时用 rrddata 补齐最近一小时的历史
+    VMHistory *history = vm_history(vm);
+    if (history && !history->seeded) {
+        history_seed(history, vm);
+    }
+    
     mvwprintw(status_win, y++, 2, "VMID: %d", vm->vmid);
     mvwprintw(status_win, y++, 2, "Name: %s", vm->name);
     mvwprintw(status_win, y++, 2, "Status: %s", vm->status);
+    mvwprintw(status_win, y++, 2, "Node: %s", vm->node);
+    if (vm->pool[0]) {
+        mvwprintw(status_win, y++, 2, "Pool: %s", vm->pool);
+    }
+    if (vm->tags[0]) {
+        mvwprintw(status_win, y++, 2, "Tags: %s", vm->tags);
+    }
     y++;
     
     mvwprintw(status_win, y++, 2, "CPU: %d cores (%.1f%%)",
               vm->cpus, vm->cpu_percent);
+    char used[FORMAT_LEN], total[FORMAT_LEN];
     mvwprintw(status_win, y++, 2, "Memory: %s / %s",
-              format_bytes(vm->mem), format_bytes(vm->maxmem));
+              format_bytes(vm->mem, used, sizeof(used)), format_bytes(vm->maxmem, total, sizeof(total)));
     mvwprintw(status_win, y++, 2, "Disk: %s / %s",
-              format_bytes(vm->disk), format_bytes(vm->maxdisk));
+              format_bytes(vm->disk, used, sizeof(used)), format_bytes(vm->maxdisk, total, sizeof(total)));
     y++;
     
     if (strcmp(vm->status, "running") == 0) {
-        mvwprintw(status_win, y++, 2, "Uptime: %s", format_uptime(vm->uptime));
+        mvwprintw(status_win, y++, 2, "Uptime: %s", format_uptime(vm->uptime, used, sizeof(used)));
     }
     y++;
     
@@ -217,6 +716,11 @@ static void draw_vm_status(void) {
     
     mvwprintw(status_win, y++, 2, "Storage:");
     mvwprintw(status_win, y++, 2, "  %s", vm->storage);
+    y++;
+    
+    int max_y, max_x;
+    getmaxyx(status_win, max_y, max_x);
+    draw_history(history, y, max_y, max_x);
     
     wrefresh(status_win);
 }
@@ -228,9 +732,14 @@ static void draw_help(void) {
     werase(help_win);
     wbkgd(help_win, COLOR_PAIR(COLOR_HELP));
     
-    mvwprintw(help_win, 0, 2, "Navigation: Up/Down Select | Left/Right Page | Home/End Jump");
-    mvwprintw(help_win, 1, 2, "Actions: S Start | T Stop | R Reboot | D Destroy");
-    mvwprintw(help_win, 2, 2, "Other: F5 Refresh | Q Quit");
+    if (search_typing) {
+        mvwprintw(help_win, 0, 2, "Search: type to filter by name or VMID | Backspace Delete");
+        mvwprintw(help_win, 1, 2, "Enter Keep filter | Esc Clear filter | Up/Down Select");
+    } else {
+        mvwprintw(help_win, 0, 2, "Navigation: Up/Down Select | Left/Right Page | Home/End Jump | Enter Fold");
+        mvwprintw(help_win, 1, 2, "Actions: S Start | T Stop | R Reboot | D Destroy");
+        mvwprintw(help_win, 2, 2, "Other: / Search | G Group by pool/tag/none | F5 Refresh | Q Quit");
+    }
     
     // 在右侧添加版权信息（两行）
     int max_x;
@@ -253,27 +762,163 @@ static void refresh_all(void) {
     draw_help();
 }
 
-// 加载 VM 列表
-static int load_tui_vm_list(void) {
-    if (tui_vm_list) {
-        free(tui_vm_list);
-        tui_vm_list = NULL;
+// 获取 VM 列表：优先一次请求获取整个集群，失败时回退到配置的节点
+static int fetch_vm_list(VMInfo **vms, int *count) {
+    if (api_get_cluster_vms(vms, count) == 0) {
+        return 0;
+    }
+    return api_get_vm_list(vms, count, 0);
+}
+
+static int cmp_vmid(const void *a, const void *b) {
+    const VMInfo *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+// 按新列表（已按 VMID 排序）重排历史：保留仍存在的 VM，新 VM 从空历史开始
+// 只在 VM 集合变化时分配，采样本身不分配内存
+static void sync_history(const VMInfo *list, int count) {
+    VMHistory *fresh = malloc((size_t)(count > 0 ? count : 1) * sizeof(VMHistory));
+    if (!fresh) {
+        free(tui_history);
+        tui_history = NULL;
+        return;
     }
     
-    int ret = api_get_vm_list(&tui_vm_list, &vm_count);
-    if (ret != 0) {
+    int j = 0;
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++) {
+        while (tui_history && j < vm_count && tui_history[j].vmid < list[i].vmid) j++;
+        if (tui_history && j < vm_count && tui_history[j].vmid == list[i].vmid) {
+            fresh[i] = tui_history[j];
+        } else {
+            history_init(&fresh[i], list[i].vmid);
+        }
+        history_sample(&fresh[i], &list[i], now);
+    }
+    
+    free(tui_history);
+    tui_history = fresh;
+}
+
+// 加载 VM 列表（网桥、IP 等详情在选中时再加载）
+static int load_tui_vm_list(void) {
+    VMInfo *list = NULL;
+    int count = 0;
+    
+    if (fetch_vm_list(&list, &count) != 0) {
         return -1;
     }
+    qsort(list, (size_t)count, sizeof(VMInfo), cmp_vmid);
     
-    // 获取详细信息
-    for (int i = 0; i < vm_count; i++) {
-        api_get_vm_config_details(tui_vm_list[i].vmid, &tui_vm_list[i]);
-        if (strcmp(tui_vm_list[i].status, "running") == 0) {
-            api_get_vm_ip(tui_vm_list[i].vmid, &tui_vm_list[i]);
+    sync_history(list, count);
+    free(tui_vm_list);
+    tui_vm_list = list;
+    vm_count = count;
+    
+    rebuild_view(true);
+    return 0;
+}
+
+static int find_tui_vm(int vmid) {
+    VMInfo key = { .vmid = vmid };
+    VMInfo *vm = bsearch(&key, tui_vm_list, (size_t)vm_count, sizeof(VMInfo), cmp_vmid);
+    return vm ? (int)(vm - tui_vm_list) : -1;
+}
+
+// 定向刷新指定的 VM；不在当前列表中的 VM 触发全量刷新
+static void refresh_tui_vms(const int *vmids, int count) {
+    bool names_changed = false;
+    
+    for (int i = 0; i < count; i++) {
+        int index = find_tui_vm(vmids[i]);
+        if (index < 0) {
+            load_tui_vm_list();
+            return;
+        }
+        
+        VMInfo vm = {0};
+        if (api_get_vm_status(vmids[i], &vm, 0) == 0) {
+            VMInfo *old = &tui_vm_list[index];
+            // 资源池不在配置里；标签随配置重新读取（qmconfig 修改标签后立即重新分组），
+            // 读不到配置时保留原来的
+            memcpy(vm.pool, old->pool, sizeof(vm.pool));
+            if (vm.config_file[0] == '\0') memcpy(vm.tags, old->tags, sizeof(vm.tags));
+            if (strcmp(vm.name, old->name) != 0) names_changed = true;
+            *old = vm;
         }
     }
     
-    return 0;
+    rebuild_view(names_changed);
+}
+
+// 用一次列表请求更新指标，保留网桥、IP 等详情；VM 集合变化时全量刷新
+static void refresh_tui_metrics(void) {
+    VMInfo *fresh = NULL;
+    int fresh_count = 0;
+    
+    if (fetch_vm_list(&fresh, &fresh_count) != 0) {
+        return;
+    }
+    qsort(fresh, (size_t)fresh_count, sizeof(VMInfo), cmp_vmid);
+    
+    bool same = (fresh_count == vm_count);
+    for (int i = 0; same && i < fresh_count; i++) {
+        if (fresh[i].vmid != tui_vm_list[i].vmid) {
+            same = false;
+        }
+    }
+    
+    if (!same) {
+        free(fresh);
+        load_tui_vm_list();
+        return;
+    }
+    
+    bool names_changed = false;
+    time_t now = time(NULL);
+    for (int i = 0; i < fresh_count; i++) {
+        VMInfo *vm = &tui_vm_list[i];
+        if (strcmp(vm->name, fresh[i].name) != 0) names_changed = true;
+        snprintf(vm->name, sizeof(vm->name), "%s", fresh[i].name);
+        snprintf(vm->status, sizeof(vm->status), "%s", fresh[i].status);
+        snprintf(vm->node, sizeof(vm->node), "%s", fresh[i].node);
+        snprintf(vm->pool, sizeof(vm->pool), "%s", fresh[i].pool);
+        snprintf(vm->tags, sizeof(vm->tags), "%s", fresh[i].tags);
+        vm->cpus = fresh[i].cpus;
+        vm->maxmem = fresh[i].maxmem;
+        vm->mem = fresh[i].mem;
+        vm->maxdisk = fresh[i].maxdisk;
+        vm->disk = fresh[i].disk;
+        vm->cpu_percent = fresh[i].cpu_percent;
+        vm->uptime = fresh[i].uptime;
+        vm->netin = fresh[i].netin;
+        vm->netout = fresh[i].netout;
+        vm->diskread = fresh[i].diskread;
+        vm->diskwrite = fresh[i].diskwrite;
+        
+        if (tui_history) {
+            history_sample(&tui_history[i], vm, now);
+        }
+    }
+    
+    free(fresh);
+    rebuild_view(names_changed);
+}
+
+// 轮询变更事件并只刷新受影响的 VM
+static void poll_tui_events(void) {
+    EventChanges changes;
+    if (event_feed_poll(&tui_feed, &changes) != 0 && !changes.full_refresh) {
+        return;
+    }
+    
+    if (changes.full_refresh) {
+        load_tui_vm_list();
+        last_full_refresh = time(NULL);
+    } else if (changes.count > 0) {
+        refresh_tui_vms(changes.vmids, changes.count);
+    }
 }
 
 // 显示消息对话框
@@ -368,7 +1013,76 @@ static void handle_key(int ch) {
     }
     int visible_lines = max_y - 4;
     
+    // 搜索输入：每次按键在上一次结果上增量过滤
+    if (search_typing) {
+        size_t len = strlen(search_text);
+        if (ch == 27) {
+            search_typing = false;
+            search_text[0] = '\0';
+            run_search(false);
+            build_tree();
+            ensure_visible();
+            return;
+        } else if (ch == '\n' || ch == KEY_ENTER) {
+            search_typing = false;
+            return;
+        } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+            if (len > 0) {
+                search_text[len - 1] = '\0';
+                run_search(false);
+                build_tree();
+                ensure_visible();
+            }
+            return;
+        } else if (ch >= 32 && ch < 256 && len + 1 < sizeof(search_text)) {
+            search_text[len] = (char)ch;
+            search_text[len + 1] = '\0';
+            run_search(true);
+            build_tree();
+            ensure_visible();
+            return;
+        }
+    }
+    
     switch (ch) {
+        case '/':
+            // 开始新的搜索
+            search_typing = true;
+            search_text[0] = '\0';
+            run_search(false);
+            build_tree();
+            break;
+            
+        case 27:
+            // 清除搜索过滤
+            if (search_text[0]) {
+                search_text[0] = '\0';
+                run_search(false);
+                build_tree();
+                ensure_visible();
+            }
+            break;
+            
+        case '\n':
+        case KEY_ENTER:
+        case ' ':
+            // 展开/折叠分组
+            if (row_count > 0 && tui_rows[selected_index].type != ROW_VM && !search_text[0]) {
+                toggle_collapsed(tui_rows[selected_index].key);
+                build_tree();
+                ensure_visible();
+            }
+            break;
+            
+        case 'g':
+        case 'G':
+            // 切换分组方式：资源池 → 标签 → 不分组
+            group_mode = (group_mode == GROUP_POOL) ? GROUP_TAG :
+                         (group_mode == GROUP_TAG) ? GROUP_NONE : GROUP_POOL;
+            rebuild_view(false);
+            ensure_visible();
+            break;
+            
         case KEY_UP:
             if (selected_index > 0) {
                 selected_index--;
@@ -379,7 +1093,7 @@ static void handle_key(int ch) {
             break;
             
         case KEY_DOWN:
-            if (selected_index < vm_count - 1) {
+            if (selected_index < row_count - 1) {
                 selected_index++;
                 if (selected_index >= scroll_offset + visible_lines) {
                     scroll_offset = selected_index - visible_lines + 1;
@@ -402,10 +1116,10 @@ static void handle_key(int ch) {
         case KEY_RIGHT:
         case KEY_NPAGE:  // Page Down
             // 向下翻页
-            if (selected_index < vm_count - 1) {
+            if (selected_index < row_count - 1) {
                 selected_index += visible_lines;
-                if (selected_index >= vm_count) {
-                    selected_index = vm_count - 1;
+                if (selected_index >= row_count) {
+                    selected_index = row_count - 1;
                 }
                 if (selected_index >= scroll_offset + visible_lines) {
                     scroll_offset = selected_index - visible_lines + 1;
@@ -419,19 +1133,20 @@ static void handle_key(int ch) {
             break;
             
         case KEY_END:
-            selected_index = vm_count - 1;
-            scroll_offset = (vm_count > visible_lines) ? vm_count - visible_lines : 0;
+            selected_index = row_count - 1;
+            scroll_offset = (row_count > visible_lines) ? row_count - visible_lines : 0;
             break;
             
         case 's':
         case 'S':
             // 启动 VM
-            if (vm_count > 0) {
-                VMInfo *vm = &tui_vm_list[selected_index];
+            if (selected_vm()) {
+                VMInfo *vm = selected_vm();
                 if (show_confirm("Start VM", "Start this VM?")) {
                     if (vm_start(vm->vmid) == 0) {
                         show_message("Success", "VM started successfully");
-                        load_tui_vm_list();
+                        int vmid = vm->vmid;
+                        refresh_tui_vms(&vmid, 1);
                     } else {
                         show_message("Error", "Failed to start VM");
                     }
@@ -442,12 +1157,13 @@ static void handle_key(int ch) {
         case 't':
         case 'T':
             // 停止 VM
-            if (vm_count > 0) {
-                VMInfo *vm = &tui_vm_list[selected_index];
+            if (selected_vm()) {
+                VMInfo *vm = selected_vm();
                 if (show_confirm("Stop VM", "Stop this VM?")) {
                     if (vm_stop(vm->vmid) == 0) {
                         show_message("Success", "VM stopped successfully");
-                        load_tui_vm_list();
+                        int vmid = vm->vmid;
+                        refresh_tui_vms(&vmid, 1);
                     } else {
                         show_message("Error", "Failed to stop VM");
                     }
@@ -458,12 +1174,13 @@ static void handle_key(int ch) {
         case 'r':
         case 'R':
             // 重启 VM
-            if (vm_count > 0) {
-                VMInfo *vm = &tui_vm_list[selected_index];
+            if (selected_vm()) {
+                VMInfo *vm = selected_vm();
                 if (show_confirm("Reboot VM", "Reboot this VM?")) {
                     if (vm_restart(vm->vmid) == 0) {
                         show_message("Success", "VM rebooted successfully");
-                        load_tui_vm_list();
+                        int vmid = vm->vmid;
+                        refresh_tui_vms(&vmid, 1);
                     } else {
                         show_message("Error", "Failed to reboot VM");
                     }
@@ -474,15 +1191,12 @@ static void handle_key(int ch) {
         case 'd':
         case 'D':
             // 删除 VM
-            if (vm_count > 0) {
-                VMInfo *vm = &tui_vm_list[selected_index];
+            if (selected_vm()) {
+                VMInfo *vm = selected_vm();
                 if (show_confirm("Destroy VM", "DESTROY this VM? (Cannot undo!)")) {
                     if (vm_destroy(vm->vmid, true) == 0) {
                         show_message("Success", "VM destroyed successfully");
                         load_tui_vm_list();
-                        if (selected_index >= vm_count) {
-                            selected_index = vm_count - 1;
-                        }
                     } else {
                         show_message("Error", "Failed to destroy VM");
                     }
@@ -506,6 +1220,24 @@ static void handle_key(int ch) {
     }
 }
 
+// 本机的 VM 配置文件有变化：作废这些 VM 的详情，选中的 VM 在下次绘制时重新解析
+static bool poll_tui_confs(void) {
+    EventChanges changes;
+    if (confwatch_poll(&changes) != 0) return false;
+    
+    if (changes.full_refresh) {
+        for (int i = 0; i < vm_count; i++) {
+            tui_vm_list[i].config_file[0] = '\0';
+        }
+        return true;
+    }
+    for (int i = 0; i < changes.count; i++) {
+        int index = find_tui_vm(changes.vmids[i]);
+        if (index >= 0) tui_vm_list[index].config_file[0] = '\0';
+    }
+    return changes.count > 0;
+}
+
 // TUI 主循环
 int tui_main(void) {
     tui_init();
@@ -517,6 +1249,15 @@ int tui_main(void) {
         return 1;
     }
     
+    // 建立事件基线，之后只处理增量
+    event_feed_init(&tui_feed);
+    EventChanges baseline;
+    event_feed_poll(&tui_feed, &baseline);
+    last_refresh = last_full_refresh = last_event_poll = time(NULL);
+    
+    // 在 PVE 节点上监视 VM 配置文件，详情一直缓存到配置变化
+    confwatch_start(&g_config);
+    
     // 创建窗口
     create_windows();
     
@@ -535,12 +1276,23 @@ int tui_main(void) {
             refresh_all();
         }
         
-        // 自动刷新（每 30 秒）
+        // 自动刷新：事件驱动的定向刷新 + 低频指标更新 + 兜底全量刷新
         time_t now = time(NULL);
-        if (now - last_refresh >= 30) {
+        if (now - last_full_refresh >= FULL_REFRESH_INTERVAL) {
             load_tui_vm_list();
             refresh_all();
+            last_full_refresh = last_refresh = now;
+        } else if (now - last_refresh >= METRICS_INTERVAL) {
+            refresh_tui_metrics();
+            refresh_all();
             last_refresh = now;
+        } else if (now - last_event_poll >= EVENT_POLL_INTERVAL) {
+            poll_tui_events();
+            refresh_all();
+            last_event_poll = now;
+        }
+        if (poll_tui_confs()) {
+            draw_vm_status();
         }
     }
     
@@ -0,0 +1,419 @@
+/*
+ * list --watch
+ * 整个过程复用同一个 API 会话（连接和 TLS 会话保持），每个周期只请求一次 VM 列表，
+ * 按 VMID 与上一周期的快照比较；终端中只重绘内容或高亮状态变化的行，
+ * 输出不是终端时逐行打印变化。在 PVE 节点上还监视 VM 配置文件，配置修改同样算作变化
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WATCH_MIN_INTERVAL 0.5
+#define WATCH_TOP 3             // 表格从第 3 行开始：状态行 + 空行
+
+#define HL_ON "\033[1;33m"      // 本周期变化的行
+#define HL_OFF "\033[0m"
+
+static volatile sig_atomic_t watch_stop = 0;
+static volatile sig_atomic_t watch_resized = 0;
+
+static void on_stop(int sig) {
+    (void)sig;
+    watch_stop = 1;
+}
+
+static void on_resize(int sig) {
+    (void)sig;
+    watch_resized = 1;
+}
+
+// 输出缓冲：每个周期的全部转义序列和文本拼接后一次写出
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+static void out_append(OutBuf *out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void out_append(OutBuf *out, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = out->data ? vsnprintf(out->data + out->len, out->cap - out->len, fmt, ap) : -1;
+        va_end(ap);
+        
+        if (n >= 0 && (size_t)n < out->cap - out->len) {
+            out->len += (size_t)n;
+            return;
+        }
+        
+        size_t cap = out->cap ? out->cap * 2 : 8192;
+        while (n >= 0 && cap < out->len + (size_t)n + 1) cap *= 2;
+        char *data = realloc(out->data, cap);
+        if (!data) return;
+        out->data = data;
+        out->cap = cap;
+    }
+}
+
+// 上一次绘制到终端的内容
+typedef struct {
+    char **lines;           // 表格各行（含表头和分隔线）
+    bool *highlight;
+    int count;
+    int shown;              // 实际显示的行数（受终端高度限制）
+    int term_rows;
+    int term_cols;
+} Screen;
+
+static void screen_free(Screen *s) {
+    for (int i = 0; i < s->count; i++) {
+        free(s->lines[i]);
+    }
+    free(s->lines);
+    free(s->highlight);
+    memset(s, 0, sizeof(*s));
+}
+
+static int cmp_vmid(const void *a, const void *b) {
+    const VMInfo *x = a, *y = b;
+    return (x->vmid > y->vmid) - (x->vmid < y->vmid);
+}
+
+// 只比较显示出来的字段，CPU 按显示精度比较
+static bool vm_changed(const VMInfo *a, const VMInfo *b) {
+    char ma[FORMAT_LEN], mb[FORMAT_LEN];
+    return strcmp(a->name, b->name) != 0 ||
+           strcmp(a->status, b->status) != 0 ||
+           lround(a->cpu_percent * 10) != lround(b->cpu_percent * 10) ||
+           strcmp(format_bytes(a->mem, ma, sizeof(ma)), format_bytes(b->mem, mb, sizeof(mb))) != 0;
+}
+
+// 按 VMID 归并两个有序快照，标记新增或变化的 VM，返回变化数（含已删除的 VM）
+static int diff_snapshots(const VMInfo *prev, int prev_count, const VMInfo *cur, int count,
+                          bool *changed) {
+    int changes = 0;
+    int j = 0;
+    for (int i = 0; i < count; i++) {
+        while (j < prev_count && prev[j].vmid < cur[i].vmid) {
+            changes++;
+            j++;
+        }
+        bool existed = j < prev_count && prev[j].vmid == cur[i].vmid;
+        changed[i] = !existed || vm_changed(&prev[j], &cur[i]);
+        if (existed) j++;
+        if (changed[i]) changes++;
+    }
+    return changes + (prev_count - j);
+}
+
+static char* render_table(const VMInfo *vms, int count, size_t *len) {
+    static const TableColumn columns[] = {
+        { "VMID", false },
+        { "NAME", false },
+        { "STATUS", false },
+        { "CPU%", true },
+        { "MEM", true },
+    };
+    Table table;
+    table_init(&table, columns, 5);
+    
+    char mem[FORMAT_LEN];
+    for (int i = 0; i < count; i++) {
+        table_cell(&table, "%d", vms[i].vmid);
+        table_cell(&table, "%s", vms[i].name);
+        table_cell(&table, "%s", vms[i].status);
+        table_cell(&table, "%.1f%%", vms[i].cpu_percent);
+        table_cell(&table, "%s", format_bytes(vms[i].mem, mem, sizeof(mem)));
+    }
+    
+    char *buf = table_render(&table, len);
+    table_free(&table);
+    return buf;
+}
+
+// 拆成行并去掉表头的加粗转义（绘制时自行添加）
+static int split_lines(char *buf, size_t len, char ***lines) {
+    int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '\n') n++;
+    }
+    
+    *lines = malloc((size_t)(n > 0 ? n : 1) * sizeof(char *));
+    if (!*lines) return -1;
+    
+    int k = 0;
+    char *start = buf;
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] != '\n') continue;
+        buf[i] = '\0';
+        
+        const char *line = start;
+        while (strncmp(line, "\033[1m", 4) == 0 || strncmp(line, "\033[0m", 4) == 0) {
+            line += 4;
+        }
+        (*lines)[k++] = strdup(line);
+        start = buf + i + 1;
+    }
+    return k;
+}
+
+static void terminal_size(int *rows, int *cols) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+    } else {
+        *rows = 24;
+        *cols = 80;
+    }
+}
+
+static void draw_line(OutBuf *out, int y, const char *text, bool header, bool highlight) {
+    out_append(out, "\033[%d;1H%s%s%s\033[K", y, header ? "\033[1m" : highlight ? HL_ON : "",
+               text, (header || highlight) ? HL_OFF : "");
+}
+
+// 绘制一个周期：表头或行数或终端尺寸变化时整屏重绘，否则只重绘变化的行
+static void draw_screen(Screen *screen, char **lines, int count, const bool *changed,
+                        const char *status, OutBuf *out) {
+    int rows, cols;
+    terminal_size(&rows, &cols);
+    
+    bool *highlight = calloc((size_t)(count > 0 ? count : 1), sizeof(bool));
+    if (!highlight) {
+        for (int i = 0; i < count; i++) free(lines[i]);
+        free(lines);
+        return;
+    }
+    for (int i = 2; i < count; i++) {
+        highlight[i] = changed[i - 2];
+    }
+    
+    // 终端放不下时保留最后一行给提示
+    int avail = rows - WATCH_TOP + 1;
+    int shown = count <= avail ? count : (avail > 1 ? avail - 1 : 0);
+    
+    bool full = watch_resized || screen->lines == NULL || screen->count != count ||
+                screen->term_rows != rows || screen->term_cols != cols ||
+                strcmp(screen->lines[0], lines[0]) != 0 || strcmp(screen->lines[1], lines[1]) != 0;
+    watch_resized = 0;
+    
+    if (full) out_append(out, "\033[H\033[2J");
+    out_append(out, "\033[1;1H%s\033[K", status);
+    
+    for (int i = 0; i < shown; i++) {
+        if (!full && highlight[i] == screen->highlight[i] && strcmp(lines[i], screen->lines[i]) == 0) {
+            continue;
+        }
+        draw_line(out, WATCH_TOP + i, lines[i], i < 2, highlight[i]);
+    }
+    if (full && shown < count) {
+        out_append(out, "\033[%d;1H… 另有 %d 个虚拟机（终端高度不足）\033[K",
+                   WATCH_TOP + shown, count - shown);
+    }
+    
+    screen_free(screen);
+    screen->lines = lines;
+    screen->highlight = highlight;
+    screen->count = count;
+    screen->shown = shown;
+    screen->term_rows = rows;
+    screen->term_cols = cols;
+}
+
+// 非终端输出：打印变化的 VM 和已删除的 VM
+static void print_changes(const VMInfo *prev, int prev_count, const VMInfo *cur, int count,
+                          const bool *changed, const char *stamp) {
+    char mem[FORMAT_LEN];
+    int j = 0;
+    for (int i = 0; i < count; i++) {
+        while (j < prev_count && prev[j].vmid < cur[i].vmid) {
+            printf("%s %d %s 已删除\n", stamp, prev[j].vmid, prev[j].name);
+            j++;
+        }
+        bool existed = j < prev_count && prev[j].vmid == cur[i].vmid;
+        if (changed[i]) {
+            printf("%s %d %s %s %.1f%% %s%s\n", stamp, cur[i].vmid, cur[i].name, cur[i].status,
+                   cur[i].cpu_percent, format_bytes(cur[i].mem, mem, sizeof(mem)),
+                   existed ? "" : " (新增)");
+        }
+        if (existed) j++;
+    }
+    for (; j < prev_count; j++) {
+        printf("%s %d %s 已删除\n", stamp, prev[j].vmid, prev[j].name);
+    }
+    fflush(stdout);
+}
+
+// 本机上配置文件有变化的 VM（见 confwatch.c）：终端中标记为变化，返回新标记的行数；
+// 非终端输出时单独打印一行
+static int mark_conf_changes(const VMInfo *vms, int count, bool *changed, bool tty, const char *stamp) {
+    EventChanges confs;
+    if (confwatch_poll(&confs) != 0 || confs.full_refresh) return 0;
+    
+    int marked = 0;
+    for (int i = 0; i < count && confs.count > 0; i++) {
+        bool hit = false;
+        for (int k = 0; k < confs.count && !hit; k++) {
+            hit = confs.vmids[k] == vms[i].vmid;
+        }
+        if (!hit) continue;
+        if (!tty) {
+            printf("%s %d %s 配置已修改\n", stamp, vms[i].vmid, vms[i].name);
+        } else if (!changed[i]) {
+            changed[i] = true;
+            marked++;
+        }
+    }
+    if (!tty) fflush(stdout);
+    return marked;
+}
+
+// 睡到下一个周期；被信号打断时提前返回
+static void sleep_until(const struct timespec *deadline) {
+    while (!watch_stop) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double left = (double)(deadline->tv_sec - now.tv_sec) +
+                      (double)(deadline->tv_nsec - now.tv_nsec) / 1e9;
+        if (left <= 0) return;
+        
+        struct timespec ts = { (time_t)left, (long)((left - (double)(time_t)left) * 1e9) };
+        if (nanosleep(&ts, NULL) != 0 && errno == EINTR && watch_resized) return;
+    }
+}
+
+int watch_vm_list(double interval) {
+    if (interval < WATCH_MIN_INTERVAL) interval = WATCH_MIN_INTERVAL;
+    
+    bool tty = isatty(STDOUT_FILENO);
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = on_resize;
+    sigaction(SIGWINCH, &sa, NULL);
+    
+    if (tty) {
+        // 隐藏光标、关闭自动换行（过长的行截断，不打乱行号）
+        printf("\033[?25l\033[?7l");
+        fflush(stdout);
+    }
+    
+    // 在 PVE 节点上同时监视 VM 配置文件，配置修改也会显示出来
+    confwatch_start(&g_config);
+    
+    VMInfo *prev = NULL;
+    int prev_count = 0;
+    bool first = true;
+    Screen screen;
+    memset(&screen, 0, sizeof(screen));
+    OutBuf out = { 0 };
+    
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    
+    while (!watch_stop) {
+        time_t now = time(NULL);
+        char stamp[16];
+        strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&now));
+        
+        VMInfo *vms = NULL;
+        int count = 0;
+        if (api_get_vm_list(&vms, &count, 0) != 0) {
+            // 保留上一次的画面，下个周期重试
+            if (tty) {
+                out.len = 0;
+                out_append(&out, "\033[1;1H每 %.1fs 刷新 · %s · \033[31m获取失败：%s\033[0m\033[K",
+                           interval, stamp, api_last_error());
+                write_all(STDOUT_FILENO, out.data, out.len);
+            } else {
+                fprintf(stderr, "%s 获取 VM 列表失败：%s\n", stamp, api_last_error());
+            }
+        } else {
+            qsort(vms, (size_t)count, sizeof(VMInfo), cmp_vmid);
+            bool *changed = calloc((size_t)(count > 0 ? count : 1), sizeof(bool));
+            int changes = changed ? diff_snapshots(prev, prev_count, vms, count, changed) : 0;
+            if (changed && !first) {
+                changes += mark_conf_changes(vms, count, changed, tty, stamp);
+            }
+            
+            if (changed && tty) {
+                // 首屏不高亮
+                if (first) memset(changed, 0, (size_t)count * sizeof(bool));
+                
+                size_t len;
+                char *buf = render_table(vms, count, &len);
+                char **lines = NULL;
+                int nlines = buf ? split_lines(buf, len, &lines) : -1;
+                free(buf);
+                
+                if (nlines >= 2) {
+                    char status[256];
+                    snprintf(status, sizeof(status), "每 %.1fs 刷新 · %s · 共 %d 个虚拟机 · %d 个变化 · Ctrl-C 退出",
+                             interval, stamp, count, first ? 0 : changes);
+                    out.len = 0;
+                    draw_screen(&screen, lines, nlines, changed, status, &out);
+                    write_all(STDOUT_FILENO, out.data, out.len);
+                } else if (nlines >= 0) {
+                    for (int i = 0; i < nlines; i++) free(lines[i]);
+                    free(lines);
+                }
+            } else if (changed) {
+                if (first) {
+                    size_t len;
+                    char *buf = render_table(vms, count, &len);
+                    if (buf) write_all(STDOUT_FILENO, buf, len);
+                    free(buf);
+                } else if (changes > 0) {
+                    print_changes(prev, prev_count, vms, count, changed, stamp);
+                }
+            }
+            
+            free(changed);
+            free(prev);
+            prev = vms;
+            prev_count = count;
+            first = false;
+        }
+        
+        deadline.tv_sec += (time_t)interval;
+        deadline.tv_nsec += (long)((interval - floor(interval)) * 1e9);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        
+        // 请求比间隔还慢时不补跑错过的周期
+        struct timespec mono;
+        clock_gettime(CLOCK_MONOTONIC, &mono);
+        if (mono.tv_sec > deadline.tv_sec ||
+            (mono.tv_sec == deadline.tv_sec && mono.tv_nsec > deadline.tv_nsec)) {
+            deadline = mono;
+        }
+        sleep_until(&deadline);
+    }
+    
+    if (tty) {
+        // 光标移到最后一行下面，恢复光标和自动换行
+        printf("\033[%d;1H\n\033[?7h\033[?25h", WATCH_TOP + screen.shown);
+        fflush(stdout);
+    }
+    
+    screen_free(&screen);
+    free(out.data);
+    free(prev);
+    confwatch_stop();
+    return 0;
+}
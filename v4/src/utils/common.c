@@ -6,6 +6,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include "../../include/vmanager.h"
 #include <ctype.h>
+#include <time.h>
 
 // 检查字符串是否为数字
 bool is_number(const char *str) {
@@ -24,6 +25,7 @@ bool is_number(const char *str) {
 }
 
 // 解析 VMID 范围 (例如: "100-105" 或 "100,102,104" 或 "100-105,110")
+// 超过 MAX_VMIDS 个时返回 -1，不截断
 int parse_vmid_range(const char *range, int *vmids, int *count) {
     if (!range || !vmids || !count) {
         return -1;
@@ -35,8 +37,9 @@ int parse_vmid_range(const char *range, int *vmids, int *count) {
         return -1;
     }
     
+    bool overflow = false;
     char *token = strtok(range_copy, ",");
-    while (token && *count < MAX_VMIDS) {
+    while (token && !overflow) {
         // 去除空白
         while (*token == ' ' || *token == '\t') token++;
         
@@ -48,15 +51,23 @@ int parse_vmid_range(const char *range, int *vmids, int *count) {
             int end = atoi(dash + 1);
             
             if (start > 0 && end >= start) {
-                for (int i = start; i <= end && *count < MAX_VMIDS; i++) {
-                    vmids[(*count)++] = i;
+                if (end - start >= MAX_VMIDS - *count) {
+                    overflow = true;
+                } else {
+                    for (int i = start; i <= end; i++) {
+                        vmids[(*count)++] = i;
+                    }
                 }
             }
         } else {
             // 单个 VMID
             int vmid = atoi(token);
             if (vmid > 0) {
-                vmids[(*count)++] = vmid;
+                if (*count >= MAX_VMIDS) {
+                    overflow = true;
+                } else {
+                    vmids[(*count)++] = vmid;
+                }
             }
         }
         
@@ -64,36 +75,32 @@ int parse_vmid_range(const char *range, int *vmids, int *count) {
     }
     
     free(range_copy);
-    return 0;
+    return overflow ? -1 : 0;
 }
 
-// 格式化字节数 (返回静态缓冲区，非线程安全)
-char* format_bytes(uint64_t bytes) {
-    static char buffer[32];
-    
+// 格式化字节数，写入调用方的缓冲区并返回它
+char* format_bytes(uint64_t bytes, char *buffer, size_t len) {
     if (bytes == 0) {
-        snprintf(buffer, sizeof(buffer), "0 B");
+        snprintf(buffer, len, "0 B");
     } else if (bytes < 1024) {
-        snprintf(buffer, sizeof(buffer), "%lu B", (unsigned long)bytes);
+        snprintf(buffer, len, "%lu B", (unsigned long)bytes);
     } else if (bytes < 1024 * 1024) {
-        snprintf(buffer, sizeof(buffer), "%.2f KB", bytes / 1024.0);
+        snprintf(buffer, len, "%.2f KB", bytes / 1024.0);
     } else if (bytes < 1024 * 1024 * 1024) {
-        snprintf(buffer, sizeof(buffer), "%.2f MB", bytes / (1024.0 * 1024.0));
+        snprintf(buffer, len, "%.2f MB", bytes / (1024.0 * 1024.0));
     } else if (bytes < 1024ULL * 1024 * 1024 * 1024) {
-        snprintf(buffer, sizeof(buffer), "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+        snprintf(buffer, len, "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
     } else {
-        snprintf(buffer, sizeof(buffer), "%.2f TB", bytes / (1024.0 * 1024.0 * 1024.0 * 1024.0));
+        snprintf(buffer, len, "%.2f TB", bytes / (1024.0 * 1024.0 * 1024.0 * 1024.0));
     }
     
     return buffer;
 }
 
-// 格式化运行时间 (返回静态缓冲区，非线程安全)
-char* format_uptime(int seconds) {
-    static char buffer[64];
-    
+// 格式化运行时间，写入调用方的缓冲区并返回它
+char* format_uptime(int seconds, char *buffer, size_t len) {
     if (seconds < 0) {
-        snprintf(buffer, sizeof(buffer), "N/A");
+        snprintf(buffer, len, "N/A");
         return buffer;
     }
     
@@ -103,14 +110,89 @@ char* format_uptime(int seconds) {
     int secs = seconds % 60;
     
     if (days > 0) {
-        snprintf(buffer, sizeof(buffer), "%dd %dh %dm", days, hours, minutes);
+        snprintf(buffer, len, "%dd %dh %dm", days, hours, minutes);
     } else if (hours > 0) {
-        snprintf(buffer, sizeof(buffer), "%dh %dm", hours, minutes);
+        snprintf(buffer, len, "%dh %dm", hours, minutes);
     } else if (minutes > 0) {
-        snprintf(buffer, sizeof(buffer), "%dm %ds", minutes, secs);
+        snprintf(buffer, len, "%dm %ds", minutes, secs);
     } else {
-        snprintf(buffer, sizeof(buffer), "%ds", secs);
+        snprintf(buffer, len, "%ds", secs);
     }
     
     return buffer;
 }
+
+// 单调时钟（秒），用于统计耗时
+double now_monotonic(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define PROGRESS_WIDTH 30
+
+// 在 stderr 上绘制单行进度条（调用方负责判断是否为终端）
+void progress_draw(const char *label, int done, int failed, int total) {
+    int filled = total > 0 ? done * PROGRESS_WIDTH / total : 0;
+    
+    char bar[PROGRESS_WIDTH + 1];
+    for (int i = 0; i < PROGRESS_WIDTH; i++) {
+        bar[i] = (i < filled) ? '#' : '.';
+    }
+    bar[PROGRESS_WIDTH] = '\0';
+    
+    fprintf(stderr, "\r\033[K%s [%s] %d/%d", label, bar, done, total);
+    if (failed > 0) {
+        fprintf(stderr, " (\033[31m%d 失败\033[0m)", failed);
+    }
+    fflush(stderr);
+}
+
+// 按 shell 规则拆分参数：空白分隔，支持单引号、双引号和反斜杠转义，# 开始注释；
+// 结果写回 line 本身
+int split_args(char *line, char *argv[], int max) {
+    int argc = 0;
+    char *src = line, *dst = line;
+    
+    for (;;) {
+        while (*src == ' ' || *src == '\t' || *src == '\r') src++;
+        if (*src == '\0' || *src == '#') break;
+        if (argc >= max) return -1;
+        
+        argv[argc++] = dst;
+        char quote = 0;
+        while (*src) {
+            char c = *src;
+            if (quote) {
+                if (c == quote) {
+                    quote = 0;
+                    src++;
+                } else if (c == '\\' && quote == '"' && (src[1] == '"' || src[1] == '\\')) {
+                    *dst++ = src[1];
+                    src += 2;
+                } else {
+                    *dst++ = *src++;
+                }
+            } else if (c == '\'' || c == '"') {
+                quote = c;
+                src++;
+            } else if (c == '\\' && src[1]) {
+                *dst++ = src[1];
+                src += 2;
+            } else if (c == ' ' || c == '\t' || c == '\r') {
+                break;
+            } else {
+                *dst++ = *src++;
+            }
+        }
+        if (quote) return -1;
+        
+        bool end = (*src == '\0');
+        *dst++ = '\0';
+        if (end) break;
+        src++;
+    }
+    
+    argv[argc] = NULL;
+    return argc;
+}
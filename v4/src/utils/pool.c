@@ -0,0 +1,132 @@
+/*
+ * 并发执行工具
+ * 提供固定大小的工作线程池和按键（存储、节点等）分组的并发上限
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int jobs;
+    void (*fn)(int index, void *arg);
+    void *arg;
+} PoolState;
+
+static void* pool_worker(void *userp) {
+    PoolState *st = (PoolState *)userp;
+    
+    for (;;) {
+        pthread_mutex_lock(&st->lock);
+        int index = st->next++;
+        pthread_mutex_unlock(&st->lock);
+        
+        if (index >= st->jobs) break;
+        st->fn(index, st->arg);
+    }
+    
+    // 每个工作线程持有自己的 curl handle，退出前释放
+    api_thread_cleanup();
+    return NULL;
+}
+
+// 使用最多 workers 个线程执行 fn(0..jobs-1)，全部完成后返回
+int pool_run(int jobs, int workers, void (*fn)(int index, void *arg), void *arg) {
+    if (jobs <= 0 || !fn) return 0;
+    if (workers > jobs) workers = jobs;
+    
+    // 单线程时直接在调用线程中执行
+    if (workers <= 1) {
+        for (int i = 0; i < jobs; i++) {
+            fn(i, arg);
+        }
+        return 0;
+    }
+    
+    PoolState st = { .next = 0, .jobs = jobs, .fn = fn, .arg = arg };
+    pthread_mutex_init(&st.lock, NULL);
+    
+    pthread_t *threads = calloc((size_t)workers, sizeof(pthread_t));
+    if (!threads) {
+        pthread_mutex_destroy(&st.lock);
+        return -1;
+    }
+    
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, pool_worker, &st) != 0) break;
+        started++;
+    }
+    
+    // 线程创建失败时由调用线程兜底执行剩余任务
+    if (started == 0) {
+        for (int i = 0; i < jobs; i++) {
+            fn(i, arg);
+        }
+    }
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    free(threads);
+    pthread_mutex_destroy(&st.lock);
+    return 0;
+}
+
+void keyed_limit_init(KeyedLimit *kl, int max_per_key) {
+    memset(kl, 0, sizeof(*kl));
+    pthread_mutex_init(&kl->lock, NULL);
+    pthread_cond_init(&kl->cond, NULL);
+    kl->max_per_key = max_per_key;
+}
+
+void keyed_limit_destroy(KeyedLimit *kl) {
+    pthread_mutex_destroy(&kl->lock);
+    pthread_cond_destroy(&kl->cond);
+}
+
+// 查找或登记键（调用方持有锁）；槽位用尽时所有新键共享最后一个槽
+static int keyed_limit_slot(KeyedLimit *kl, const char *key) {
+    if (!key) key = "";
+    
+    for (int i = 0; i < kl->nkeys; i++) {
+        if (strcmp(kl->keys[i], key) == 0) return i;
+    }
+    
+    if (kl->nkeys >= LIMIT_MAX_KEYS) return LIMIT_MAX_KEYS - 1;
+    
+    int slot = kl->nkeys++;
+    snprintf(kl->keys[slot], sizeof(kl->keys[slot]), "%s", key);
+    kl->active[slot] = 0;
+    return slot;
+}
+
+void keyed_limit_acquire(KeyedLimit *kl, const char *key) {
+    pthread_mutex_lock(&kl->lock);
+    int slot = keyed_limit_slot(kl, key);
+    while (kl->max_per_key > 0 && kl->active[slot] >= kl->max_per_key) {
+        pthread_cond_wait(&kl->cond, &kl->lock);
+    }
+    kl->active[slot]++;
+    pthread_mutex_unlock(&kl->lock);
+}
+
+// 不等待的版本：该键已达上限时返回 false
+bool keyed_limit_try_acquire(KeyedLimit *kl, const char *key) {
+    pthread_mutex_lock(&kl->lock);
+    int slot = keyed_limit_slot(kl, key);
+    bool ok = kl->max_per_key <= 0 || kl->active[slot] < kl->max_per_key;
+    if (ok) kl->active[slot]++;
+    pthread_mutex_unlock(&kl->lock);
+    return ok;
+}
+
+void keyed_limit_release(KeyedLimit *kl, const char *key) {
+    pthread_mutex_lock(&kl->lock);
+    int slot = keyed_limit_slot(kl, key);
+    if (kl->active[slot] > 0) kl->active[slot]--;
+    pthread_cond_broadcast(&kl->cond);
+    pthread_mutex_unlock(&kl->lock);
+}
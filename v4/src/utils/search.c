@@ -0,0 +1,270 @@
+/*
+ * VM 搜索索引
+ * 加载列表时建立一次索引，之后每次按键只访问倒排表或上一次的结果，
+ * 不再逐行扫描整个 VM 列表
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <ctype.h>
+
+#define QUERY_MAX 64
+
+static void lower_copy(char *dst, const char *src, size_t len) {
+    size_t i = 0;
+    for (; src[i] && i + 1 < len; i++) {
+        dst[i] = (char)tolower((unsigned char)src[i]);
+    }
+    dst[i] = '\0';
+}
+
+static uint32_t trigram(const char *s) {
+    return ((uint32_t)(unsigned char)s[0] << 16) |
+           ((uint32_t)(unsigned char)s[1] << 8) |
+           (uint32_t)(unsigned char)s[2];
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_token(const void *a, const void *b) {
+    return strcmp(((const SearchToken *)a)->text, ((const SearchToken *)b)->text);
+}
+
+// 名称中的单词分隔符，web-01.prod 可按 web / 01 / prod 前缀查找
+static bool is_separator(char c) {
+    return c == '-' || c == '_' || c == '.' || c == ' ';
+}
+
+static void add_trigrams(uint64_t *pairs, size_t *n, const char *text, int vm) {
+    size_t len = strlen(text);
+    for (size_t i = 0; i + 3 <= len; i++) {
+        pairs[(*n)++] = ((uint64_t)trigram(text + i) << 32) | (uint32_t)vm;
+    }
+}
+
+void search_index_free(SearchIndex *idx) {
+    free(idx->arena);
+    free(idx->names);
+    free(idx->ids);
+    free(idx->tri_keys);
+    free(idx->tri_start);
+    free(idx->tri_postings);
+    free(idx->tokens);
+    free(idx->mark);
+    memset(idx, 0, sizeof(*idx));
+}
+
+int search_index_build(SearchIndex *idx, const VMInfo *vms, int count) {
+    memset(idx, 0, sizeof(*idx));
+    if (!vms || count <= 0) return 0;
+    
+    // 小写文本：名称 + VMID
+    size_t arena_size = 0;
+    size_t pair_count = 0;
+    size_t token_count = 0;
+    for (int i = 0; i < count; i++) {
+        size_t len = strlen(vms[i].name);
+        arena_size += len + 1 + 12;
+        pair_count += (len >= 3 ? len - 2 : 0) + 10;
+        token_count += 2;
+        for (size_t k = 1; k < len; k++) {
+            if (is_separator(vms[i].name[k - 1]) && !is_separator(vms[i].name[k])) {
+                token_count++;
+            }
+        }
+    }
+    
+    idx->count = count;
+    idx->arena = malloc(arena_size);
+    idx->names = calloc((size_t)count, sizeof(char *));
+    idx->ids = calloc((size_t)count, sizeof(char *));
+    idx->tokens = calloc(token_count, sizeof(SearchToken));
+    idx->mark = calloc((size_t)count, sizeof(unsigned));
+    uint64_t *pairs = malloc(pair_count * sizeof(uint64_t));
+    if (!idx->arena || !idx->names || !idx->ids || !idx->tokens || !idx->mark || !pairs) {
+        free(pairs);
+        search_index_free(idx);
+        return -1;
+    }
+    
+    char *p = idx->arena;
+    size_t np = 0;
+    int nt = 0;
+    for (int i = 0; i < count; i++) {
+        size_t len = strlen(vms[i].name);
+        lower_copy(p, vms[i].name, len + 1);
+        idx->names[i] = p;
+        p += len + 1;
+        
+        int n = snprintf(p, 12, "%d", vms[i].vmid);
+        idx->ids[i] = p;
+        p += n + 1;
+        
+        add_trigrams(pairs, &np, idx->names[i], i);
+        add_trigrams(pairs, &np, idx->ids[i], i);
+        
+        idx->tokens[nt++] = (SearchToken){ idx->ids[i], i };
+        idx->tokens[nt++] = (SearchToken){ idx->names[i], i };
+        for (size_t k = 1; k < len; k++) {
+            if (is_separator(idx->names[i][k - 1]) && !is_separator(idx->names[i][k])) {
+                idx->tokens[nt++] = (SearchToken){ idx->names[i] + k, i };
+            }
+        }
+    }
+    idx->token_count = nt;
+    qsort(idx->tokens, (size_t)nt, sizeof(SearchToken), cmp_token);
+    
+    // 三元组倒排表：(三元组, VM) 排序去重后按三元组分段
+    qsort(pairs, np, sizeof(uint64_t), cmp_u64);
+    size_t unique = 0, keys = 0;
+    for (size_t i = 0; i < np; i++) {
+        if (unique > 0 && pairs[unique - 1] == pairs[i]) continue;
+        if (unique == 0 || (pairs[unique - 1] >> 32) != (pairs[i] >> 32)) keys++;
+        pairs[unique++] = pairs[i];
+    }
+    
+    idx->tri_keys = malloc((keys > 0 ? keys : 1) * sizeof(uint32_t));
+    idx->tri_start = malloc((keys + 1) * sizeof(int));
+    idx->tri_postings = malloc((unique > 0 ? unique : 1) * sizeof(int));
+    if (!idx->tri_keys || !idx->tri_start || !idx->tri_postings) {
+        free(pairs);
+        search_index_free(idx);
+        return -1;
+    }
+    
+    int k = -1;
+    for (size_t i = 0; i < unique; i++) {
+        uint32_t key = (uint32_t)(pairs[i] >> 32);
+        if (k < 0 || idx->tri_keys[k] != key) {
+            k++;
+            idx->tri_keys[k] = key;
+            idx->tri_start[k] = (int)i;
+        }
+        idx->tri_postings[i] = (int)(uint32_t)pairs[i];
+    }
+    idx->tri_count = (int)keys;
+    idx->tri_start[keys] = (int)unique;
+    
+    free(pairs);
+    return 0;
+}
+
+// 开始新一轮结果收集（用代数标记去重，无需清零）
+static void next_generation(SearchIndex *idx) {
+    if (++idx->generation == 0) {
+        memset(idx->mark, 0, (size_t)idx->count * sizeof(unsigned));
+        idx->generation = 1;
+    }
+}
+
+static bool vm_matches(const SearchIndex *idx, int vm, const char *q) {
+    return strstr(idx->names[vm], q) || strstr(idx->ids[vm], q);
+}
+
+// 查找三元组的倒排表，不存在时返回 false
+static bool find_postings(const SearchIndex *idx, uint32_t key, int *start, int *end) {
+    int lo = 0, hi = idx->tri_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (idx->tri_keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo >= idx->tri_count || idx->tri_keys[lo] != key) return false;
+    
+    *start = idx->tri_start[lo];
+    *end = idx->tri_start[lo + 1];
+    return true;
+}
+
+// 短查询：VMID、名称或名称中单词的前缀
+static int prefix_query(SearchIndex *idx, const char *q, int *out) {
+    size_t len = strlen(q);
+    int lo = 0, hi = idx->token_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(idx->tokens[mid].text, q, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    
+    next_generation(idx);
+    int n = 0;
+    for (int i = lo; i < idx->token_count && strncmp(idx->tokens[i].text, q, len) == 0; i++) {
+        int vm = idx->tokens[i].vm;
+        if (idx->mark[vm] != idx->generation) {
+            idx->mark[vm] = idx->generation;
+            out[n++] = vm;
+        }
+    }
+    
+    qsort(out, (size_t)n, sizeof(int), cmp_int);
+    return n;
+}
+
+// 从头查询，结果为升序的 VM 下标，out 需能容纳 idx->count 个元素
+int search_query(SearchIndex *idx, const char *query, int *out) {
+    char q[QUERY_MAX];
+    lower_copy(q, query ? query : "", sizeof(q));
+    size_t len = strlen(q);
+    
+    if (len == 0) {
+        for (int i = 0; i < idx->count; i++) {
+            out[i] = i;
+        }
+        return idx->count;
+    }
+    if (idx->count == 0) return 0;
+    if (len < 3) return prefix_query(idx, q, out);
+    
+    // 只遍历最短的倒排表，再逐个校验完整子串
+    int best_start = 0, best_end = -1;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        int start, end;
+        if (!find_postings(idx, trigram(q + i), &start, &end)) return 0;
+        if (best_end < 0 || end - start < best_end - best_start) {
+            best_start = start;
+            best_end = end;
+        }
+    }
+    
+    int n = 0;
+    for (int i = best_start; i < best_end; i++) {
+        int vm = idx->tri_postings[i];
+        if (vm_matches(idx, vm, q)) {
+            out[n++] = vm;
+        }
+    }
+    return n;
+}
+
+// 在上一次结果上细化：query 是上一次查询追加字符后的结果
+int search_refine(SearchIndex *idx, const char *query, const int *prev, int prev_count, int *out) {
+    char q[QUERY_MAX];
+    lower_copy(q, query ? query : "", sizeof(q));
+    
+    // 三个字符以内是前缀语义，结果不是子串结果的超集，需要重新查询
+    if (strlen(q) <= 3 || !prev) {
+        return search_query(idx, q, out);
+    }
+    
+    int n = 0;
+    for (int i = 0; i < prev_count; i++) {
+        if (vm_matches(idx, prev[i], q)) {
+            out[n++] = prev[i];
+        }
+    }
+    return n;
+}
@@ -0,0 +1,272 @@
+/*
+ * 表格输出
+ * 单元格格式化到表格自己的缓冲区，列宽按内容的显示宽度计算（中文占两列），
+ * 整张表拼接后一次 write() 输出；不使用静态缓冲区，可在工作线程中使用
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "../../include/vmanager.h"
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define TABLE_GAP 1     // 列之间的空格数
+
+static const char separator[] = "─";    // 3 字节，显示宽度 1
+
+// 宽字符（CJK、全角符号等）的码点范围
+static bool is_wide(uint32_t cp) {
+    return (cp >= 0x1100 && cp <= 0x115F) ||
+           (cp >= 0x2E80 && cp <= 0x303E) ||
+           (cp >= 0x3041 && cp <= 0x33FF) ||
+           (cp >= 0x3400 && cp <= 0x4DBF) ||
+           (cp >= 0x4E00 && cp <= 0x9FFF) ||
+           (cp >= 0xA000 && cp <= 0xA4CF) ||
+           (cp >= 0xAC00 && cp <= 0xD7A3) ||
+           (cp >= 0xF900 && cp <= 0xFAFF) ||
+           (cp >= 0xFE30 && cp <= 0xFE4F) ||
+           (cp >= 0xFF00 && cp <= 0xFF60) ||
+           (cp >= 0xFFE0 && cp <= 0xFFE6) ||
+           (cp >= 0x1F300 && cp <= 0x1F64F) ||
+           (cp >= 0x1F900 && cp <= 0x1F9FF) ||
+           (cp >= 0x20000 && cp <= 0x3FFFD);
+}
+
+// 组合字符和零宽字符不占列
+static bool is_zero_width(uint32_t cp) {
+    return (cp >= 0x0300 && cp <= 0x036F) ||
+           (cp >= 0x200B && cp <= 0x200F) ||
+           (cp >= 0xFE00 && cp <= 0xFE0F) ||
+           cp == 0xFEFF;
+}
+
+// UTF-8 字符串的终端显示宽度；非法字节按一列计算
+int str_display_width(const char *s) {
+    const unsigned char *p = (const unsigned char *)s;
+    int width = 0;
+    
+    while (*p) {
+        uint32_t cp;
+        int len;
+        if (*p < 0x80) {
+            cp = *p;
+            len = 1;
+        } else if ((*p & 0xE0) == 0xC0) {
+            cp = *p & 0x1F;
+            len = 2;
+        } else if ((*p & 0xF0) == 0xE0) {
+            cp = *p & 0x0F;
+            len = 3;
+        } else if ((*p & 0xF8) == 0xF0) {
+            cp = *p & 0x07;
+            len = 4;
+        } else {
+            width++;
+            p++;
+            continue;
+        }
+        
+        int i = 1;
+        for (; i < len && (p[i] & 0xC0) == 0x80; i++) {
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        if (i < len) {
+            // 截断的多字节序列
+            width++;
+            p++;
+            continue;
+        }
+        p += len;
+        
+        if (is_zero_width(cp)) continue;
+        width += is_wide(cp) ? 2 : 1;
+    }
+    return width;
+}
+
+void table_init(Table *t, const TableColumn *cols, int ncols) {
+    memset(t, 0, sizeof(*t));
+    if (ncols > TABLE_MAX_COLUMNS) ncols = TABLE_MAX_COLUMNS;
+    
+    t->ncols = ncols;
+    for (int i = 0; i < ncols; i++) {
+        t->cols[i] = cols[i];
+        t->widths[i] = str_display_width(cols[i].title);
+    }
+}
+
+void table_free(Table *t) {
+    free(t->arena);
+    free(t->cells);
+    memset(t, 0, sizeof(*t));
+}
+
+static bool arena_reserve(Table *t, size_t extra) {
+    if (t->arena_len + extra <= t->arena_cap) return true;
+    
+    size_t cap = t->arena_cap ? t->arena_cap : 4096;
+    while (cap < t->arena_len + extra) cap *= 2;
+    char *arena = realloc(t->arena, cap);
+    if (!arena) return false;
+    
+    t->arena = arena;
+    t->arena_cap = cap;
+    return true;
+}
+
+// 按 printf 格式追加下一个单元格，填满一行后自动换到下一行
+int table_cell(Table *t, const char *fmt, ...) {
+    if (t->failed || t->ncols == 0) return -1;
+    
+    if (t->cell_count == t->cell_cap) {
+        int cap = t->cell_cap ? t->cell_cap * 2 : 256;
+        TableCell *cells = realloc(t->cells, (size_t)cap * sizeof(TableCell));
+        if (!cells) {
+            t->failed = true;
+            return -1;
+        }
+        t->cells = cells;
+        t->cell_cap = cap;
+    }
+    
+    // 先按剩余空间格式化，不够时扩容后重试
+    va_list ap;
+    va_start(ap, fmt);
+    int n = arena_reserve(t, 64) ?
+            vsnprintf(t->arena + t->arena_len, t->arena_cap - t->arena_len, fmt, ap) : -1;
+    va_end(ap);
+    if (n >= 0 && (size_t)n >= t->arena_cap - t->arena_len) {
+        if (arena_reserve(t, (size_t)n + 1)) {
+            va_start(ap, fmt);
+            vsnprintf(t->arena + t->arena_len, t->arena_cap - t->arena_len, fmt, ap);
+            va_end(ap);
+        } else {
+            n = -1;
+        }
+    }
+    if (n < 0) {
+        t->failed = true;
+        return -1;
+    }
+    
+    TableCell *cell = &t->cells[t->cell_count];
+    cell->offset = t->arena_len;
+    cell->len = n;
+    cell->width = str_display_width(t->arena + t->arena_len);
+    
+    int col = t->cell_count % t->ncols;
+    if (cell->width > t->widths[col]) {
+        t->widths[col] = cell->width;
+    }
+    
+    t->arena_len += (size_t)n + 1;
+    t->cell_count++;
+    return 0;
+}
+
+int table_rows(const Table *t) {
+    return t->ncols > 0 ? (t->cell_count + t->ncols - 1) / t->ncols : 0;
+}
+
+int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// 追加一个对齐后的单元格；最后一列左对齐时不补尾部空格
+static char* put_cell(char *p, const Table *t, int col, const char *text, int len, int width) {
+    int pad = t->widths[col] - width;
+    bool last = (col == t->ncols - 1);
+    
+    if (t->cols[col].align_right) {
+        memset(p, ' ', (size_t)pad);
+        p += pad;
+    }
+    memcpy(p, text, (size_t)len);
+    p += len;
+    if (!t->cols[col].align_right && !last) {
+        memset(p, ' ', (size_t)pad);
+        p += pad;
+    }
+    if (!last) {
+        memset(p, ' ', TABLE_GAP);
+        p += TABLE_GAP;
+    }
+    return p;
+}
+
+// 把表头、分隔线和所有行拼接到一个 malloc 的缓冲区，每行以 \n 结尾
+char* table_render(const Table *t, size_t *len) {
+    if (t->failed || t->ncols == 0) return NULL;
+    
+    int line_width = 0;
+    for (int i = 0; i < t->ncols; i++) {
+        line_width += t->widths[i] + (i > 0 ? TABLE_GAP : 0);
+    }
+    
+    // 每行的填充不超过 line_width；单元格文本总长不超过 arena_len
+    int rows = table_rows(t);
+    size_t header_len = 0;
+    for (int i = 0; i < t->ncols; i++) {
+        header_len += strlen(t->cols[i].title);
+    }
+    size_t size = 16 + header_len + (size_t)line_width * (sizeof(separator) - 1) +
+                  t->arena_len + (size_t)(rows + 1) * ((size_t)line_width + 2);
+    char *buf = malloc(size);
+    if (!buf) return NULL;
+    
+    char *p = buf;
+    memcpy(p, "\033[1m", 4);
+    p += 4;
+    for (int i = 0; i < t->ncols; i++) {
+        const char *title = t->cols[i].title;
+        p = put_cell(p, t, i, title, (int)strlen(title), str_display_width(title));
+    }
+    *p++ = '\n';
+    for (int i = 0; i < line_width; i++) {
+        memcpy(p, separator, sizeof(separator) - 1);
+        p += sizeof(separator) - 1;
+    }
+    *p++ = '\n';
+    memcpy(p, "\033[0m", 4);
+    p += 4;
+    
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < t->ncols; c++) {
+            int index = r * t->ncols + c;
+            if (index < t->cell_count) {
+                const TableCell *cell = &t->cells[index];
+                p = put_cell(p, t, c, t->arena + cell->offset, cell->len, cell->width);
+            } else {
+                p = put_cell(p, t, c, "", 0, 0);
+            }
+        }
+        *p++ = '\n';
+    }
+    
+    *len = (size_t)(p - buf);
+    return buf;
+}
+
+// 输出整张表，只调用一次 write()
+int table_write(Table *t, int fd) {
+    size_t len;
+    char *buf = table_render(t, &len);
+    if (!buf) return -1;
+    
+    // 与之前经 stdio 输出的内容保持顺序
+    if (fd == STDOUT_FILENO) fflush(stdout);
+    if (fd == STDERR_FILENO) fflush(stderr);
+    
+    int ret = write_all(fd, buf, len);
+    free(buf);
+    return ret;
+}